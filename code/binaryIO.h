@@ -0,0 +1,37 @@
+/**
+ * @file binaryIO.h
+ * @brief This file contains helper functions to read and write values of binary files (weight states, shards, ...).
+ */
+
+#ifndef BINARY_IO_H
+#define BINARY_IO_H
+
+#include <iostream>
+#include <string>
+#include <stdexcept>
+
+/// @brief Write a value in its binary representation
+/// @param output
+/// @param value
+template <typename T>
+inline void writeValue(std::ostream& output, T value)
+{
+    output.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+/// @brief Read a value from its binary representation
+/// @param input
+/// @param file name of the file (for error messages)
+/// @return
+template <typename T>
+inline T readValue(std::istream& input, const std::string& file)
+{
+    T value;
+    if (!input.read(reinterpret_cast<char*>(&value), sizeof(T)))
+    {
+        throw std::runtime_error("File '" + file + "' is truncated.");
+    }
+    return value;
+}
+
+#endif
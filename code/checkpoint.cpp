@@ -0,0 +1,174 @@
+/**
+ * @file checkpoint.cpp
+ * @brief This file contains the implementation of the Checkpoint class and of computing sequence weights with checkpoints.
+ *
+ * File layout (little-endian):
+ *   magic "NEFFCKPT", version (uint32), input hash (uint64),
+ *   depth, length, tile count, completed tile count (int32 each),
+ *   completed tiles (completed tile count x int32), number of homologs (depth x uint32)
+ */
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include "common.h"
+#include "neffCalculator.h"
+#include "partialWeights.h"
+#include "checkpoint.h"
+#include "binaryIO.h"
+
+using namespace std;
+
+static const char CHECKPOINT_MAGIC[8] = {'N', 'E', 'F', 'F', 'C', 'K', 'P', 'T'};
+static const uint32_t CHECKPOINT_VERSION = 1;
+
+void Checkpoint::write(const string& file) const
+{
+    string tempFile = file + ".tmp";
+    {
+        ofstream output(tempFile, ios::binary);
+        if (!output)
+        {
+            throw runtime_error("Failed to create file: " + tempFile);
+        }
+
+        output.write(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+        writeValue<uint32_t>(output, CHECKPOINT_VERSION);
+        writeValue<uint64_t>(output, inputHash);
+        writeValue<int32_t>(output, sequenceWeights.size());
+        writeValue<int32_t>(output, length);
+        writeValue<int32_t>(output, tileCount);
+        writeValue<int32_t>(output, completedTiles.size());
+
+        vector<int32_t> tiles(completedTiles.begin(), completedTiles.end());
+        output.write(reinterpret_cast<const char*>(tiles.data()), tiles.size() * sizeof(int32_t));
+        vector<uint32_t> weights(sequenceWeights.begin(), sequenceWeights.end());
+        output.write(reinterpret_cast<const char*>(weights.data()), weights.size() * sizeof(uint32_t));
+
+        if (!output)
+        {
+            throw runtime_error("Failed to write file: " + tempFile);
+        }
+    }
+    // a killed run leaves either the previous or the new checkpoint, never a partially written one
+    filesystem::rename(tempFile, file);
+}
+
+Checkpoint Checkpoint::read(const string& file)
+{
+    ifstream input(file, ios::binary);
+    if (!input)
+    {
+        throw runtime_error("Failed to open the checkpoint file '" + file + "'.");
+    }
+
+    char magic[sizeof(CHECKPOINT_MAGIC)];
+    if (!input.read(magic, sizeof(magic)) || memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) != 0)
+    {
+        throw runtime_error("'" + file + "' is not a checkpoint file.");
+    }
+    if (readValue<uint32_t>(input, file) != CHECKPOINT_VERSION)
+    {
+        throw runtime_error("Unsupported version of the checkpoint file '" + file + "'.");
+    }
+
+    Checkpoint checkpoint;
+    checkpoint.inputHash = readValue<uint64_t>(input, file);
+    int depth = readValue<int32_t>(input, file);
+    checkpoint.length = readValue<int32_t>(input, file);
+    checkpoint.tileCount = readValue<int32_t>(input, file);
+    int completedCount = readValue<int32_t>(input, file);
+
+    if (depth < 0 || completedCount < 0 || completedCount > checkpoint.tileCount)
+    {
+        throw runtime_error("Checkpoint file '" + file + "' is corrupted.");
+    }
+
+    vector<int32_t> tiles(completedCount);
+    vector<uint32_t> weights(depth);
+    if (!input.read(reinterpret_cast<char*>(tiles.data()), completedCount * sizeof(int32_t))
+        || !input.read(reinterpret_cast<char*>(weights.data()), depth * sizeof(uint32_t)))
+    {
+        throw runtime_error("File '" + file + "' is truncated.");
+    }
+    checkpoint.completedTiles.assign(tiles.begin(), tiles.end());
+    checkpoint.sequenceWeights.assign(weights.begin(), weights.end());
+
+    for (int tile : checkpoint.completedTiles)
+    {
+        if (tile < 0 || tile >= checkpoint.tileCount)
+        {
+            throw runtime_error("Checkpoint file '" + file + "' is corrupted.");
+        }
+    }
+
+    return checkpoint;
+}
+
+vector<int> computeWeightsWithCheckpoint(const vector<vector<int>>& sequences, float threshold, bool isSymmetric,
+                                         const string& standardLetters, NonStandardHandler nonStandardOption,
+                                         int threads, const string& checkpointFile, int checkpointInterval, bool resume)
+{
+    SimilarityCalculator similarityCalculator(sequences, threshold, isSymmetric, standardLetters, nonStandardOption);
+
+    int depth = sequences.size();
+    Checkpoint checkpoint;
+    checkpoint.inputHash = computeInputHash(sequences, threshold, isSymmetric, standardLetters, nonStandardOption);
+    checkpoint.length = sequences[0].size();
+    checkpoint.tileCount = getTileCount(depth);
+    checkpoint.sequenceWeights.assign(depth, 0);
+
+    if (resume && filesystem::exists(checkpointFile))
+    {
+        Checkpoint previous = Checkpoint::read(checkpointFile);
+        if (previous.inputHash != checkpoint.inputHash || previous.tileCount != checkpoint.tileCount
+            || previous.sequenceWeights.size() != depth)
+        {
+            throw runtime_error("Checkpoint '" + checkpointFile + "' is not computed for the given MSA and parameters.");
+        }
+        checkpoint = previous;
+        cerr << "Resuming from checkpoint '" << checkpointFile << "' (" << checkpoint.completedTiles.size()
+             << " of " << checkpoint.tileCount << " row tiles completed)" << endl;
+    }
+
+    // compare only pairs in the row tiles that are not completed yet
+    vector<bool> completed(checkpoint.tileCount, false);
+    for (int tile : checkpoint.completedTiles)
+    {
+        completed[tile] = true;
+    }
+    vector<int> tiles;
+    for (int tile = 0; tile < checkpoint.tileCount; tile++)
+    {
+        if (!completed[tile])
+        {
+            tiles.push_back(tile);
+        }
+    }
+
+    // progress of this run is added to the resumed checkpoint
+    auto writeCheckpoint = [&](const TileProgress& progress)
+    {
+        Checkpoint current = checkpoint;
+        current.completedTiles.insert(current.completedTiles.end(), progress.completedTiles.begin(), progress.completedTiles.end());
+        for (int i = 0; i < depth; i++)
+        {
+            current.sequenceWeights[i] += progress.sequenceWeights[i];
+        }
+        current.write(checkpointFile);
+    };
+
+    vector<int> sequenceWeights = checkpoint.sequenceWeights;
+    similarityCalculator.countHomologsInTiles(tiles, threads, sequenceWeights, writeCheckpoint, checkpointInterval);
+
+    for (int& weight : sequenceWeights)
+    {
+        weight++; // each sequence is a homolog of itself
+    }
+    return sequenceWeights;
+}
@@ -0,0 +1,52 @@
+/**
+ * @file checkpoint.h
+ * @brief This file contains the declaration of the Checkpoint class and of computing sequence weights with checkpoints.
+ *
+ * A checkpoint keeps the row tiles of the triangle of sequence pairs that are completely compared
+ * and the number of homologs of each sequence found within them, so that an interrupted computation
+ * can continue from the remaining tiles.
+ */
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include "common.h"
+
+class Checkpoint
+{
+public:
+    uint64_t inputHash; // hash of the encoded sequences and parameters the weights are computed for
+    int length;         // length of the encoded sequences
+    int tileCount;      // number of row tiles of the triangle of sequence pairs
+    std::vector<int> completedTiles;  // tiles whose pairs are all compared
+    std::vector<int> sequenceWeights; // number of homologs of each sequence found within completed tiles (excluding itself)
+
+    /// @brief Write the checkpoint in a binary file; the file is replaced atomically
+    /// @param file
+    void write(const std::string& file) const;
+
+    /// @brief Read a checkpoint from a binary file
+    /// @param file
+    /// @return
+    static Checkpoint read(const std::string& file);
+};
+
+/// @brief Compute sequence weights, periodically writing completed tiles and their number of homologs in a checkpoint file
+/// @param sequences
+/// @param threshold
+/// @param isSymmetric
+/// @param standardLetters
+/// @param nonStandardOption
+/// @param threads
+/// @param checkpointFile
+/// @param checkpointInterval seconds between writing two checkpoints
+/// @param resume continue from the tiles completed in the checkpoint file, when it exists
+/// @return inverse of sequence weights
+std::vector<int> computeWeightsWithCheckpoint(const std::vector<std::vector<int>>& sequences, float threshold, bool isSymmetric,
+                                              const std::string& standardLetters, NonStandardHandler nonStandardOption,
+                                              int threads, const std::string& checkpointFile, int checkpointInterval, bool resume);
+
+#endif
@@ -13,6 +13,9 @@
  *   --out_file=<output_file>         Path to the output MSA file
  *   --alphabet=<value>               Valid alphabet of MSA;  alphabet option (0: Protein, 1: RNA, 2: DNA) (default: 0)
  *   --check_validation=<true/false>  Perform validation on sequences (default: true)
+ *   --max_identity=<value>           Remove sequences at least this identical to a kept sequence (default: empty)
+ *   --min_coverage=<value>           Remove sequences covering less than this fraction of the query (default: empty)
+ *   --max_depth=<value>              Maximum number of kept sequences (default: inf)
  *
  * 
  *  For more comprehensive instructions, please refer to the documentation at https://maryam-haghani.github.io/NEFFy.
@@ -56,6 +59,23 @@ Options:
       If true, validates the sequences to ensure they contain only letters from the specified alphabet.
       (Default: true)
 
+  --max_identity=<value>
+      Filters redundant sequences by greedy clustering: in the order of the MSA, each sequence is kept (as the
+      representative of a cluster) only if its identity to all kept sequences is less than this value; a sequence at
+      least this identical to a kept sequence is removed. Identity is computed over the residues of the sequence, as
+      sequence weights of NEFF with --is_symmetric=false.
+      The query (first) sequence is always kept.
+      (Default: empty, meaning no filtering by identity)
+
+  --min_coverage=<value>
+      Removes sequences with residues at less than this fraction of the residues of the query (first) sequence;
+      residues in gap columns of the query do not count.
+      (Default: empty, meaning no filtering by coverage)
+
+  --max_depth=<value>
+      Maximum number of kept sequences (including the query sequence).
+      (Default: inf)
+
 Examples:
   Convert a protein MSA from FASTA to Clustal format:
     ./converter --in_file=msa.fasta --out_file=msa.clustal --alphabet=0
@@ -63,6 +83,9 @@ Examples:
   Convert an RNA MSA with validation:
     ./converter --in_file=msa.a3m --out_file=msa.sto --alphabet=1 --check_validation=true
 
+  Filter an MSA to sequences with at most 90% identity to each other, covering at least half of the query:
+    ./converter --in_file=msa.a3m --out_file=filtered.a3m --max_identity=0.9 --min_coverage=0.5 --max_depth=4096
+
 For more comprehensive instructions, please refer to the documentation at https://maryam-haghani.github.io/NEFFy.
 )";
 
@@ -71,13 +94,15 @@ For more comprehensive instructions, please refer to the documentation at https:
 #include <string>
 #include <unordered_map>
 #include <algorithm>
+#include <climits>
 #include "flagHandler.h"
 #include "msaReader.h"
 #include "msaWriter.h"
+#include "neffCalculator.h"
 
 using namespace std;
 
-unordered_map<string, FlagInfo> Flags =
+static unordered_map<string, FlagInfo> Flags =
 {
     {"in_file", {true, ""}},                // in_file path
     {"out_file", {true, ""}},               // out_file path
@@ -85,8 +110,99 @@ unordered_map<string, FlagInfo> Flags =
     {"out_format", {false, ""}},            // output file format
     {"alphabet", {false, "0"}},             // alphabet of MSA
     {"check_validation", {false, "true"}},  // whether to perform validation on sequences to include only alphabet letters
+    {"max_identity", {false, ""}},          // max identity of a kept sequence to other kept sequences
+    {"min_coverage", {false, ""}},          // min fraction of residues of the query sequence covered by a kept sequence
+    {"max_depth", {false, "inf"}},          // max number of kept sequences
+};
+
+// Options of filtering redundant sequences
+struct FilterOptions
+{
+    bool enabled;
+    float maxIdentity; // 1 when sequences are not filtered by identity
+    float minCoverage; // 0 when sequences are not filtered by coverage
+    int maxDepth;
 };
 
+/// @brief Filter redundant sequences by greedy clustering: each sequence is compared only against the kept sequences
+/// (representatives), stopping at the first one it is similar to, using the mismatch kernel of sequence weights
+/// @param sequences
+/// @param alphabet
+/// @param options
+/// @return kept sequences, in the order of the MSA
+vector<Sequence> filterSequences(const vector<Sequence>& sequences, Alphabet alphabet, const FilterOptions& options)
+{
+    if (sequences.empty())
+    {
+        return sequences;
+    }
+    for (const auto& sequence : sequences)
+    {
+        if (sequence.sequence.size() != sequences[0].sequence.size())
+        {
+            throw runtime_error("Sequences should be aligned (have the same length) to be filtered.");
+        }
+    }
+
+    string standardLetters = getStandardLetters(alphabet);
+    vector<vector<int>> sequences2num = processSequences(sequences, standardLetters, getNonStandardLetters(alphabet),
+                                                         AsStandard, 1);
+    SimilarityCalculator similarityCalculator(sequences2num, options.maxIdentity, false, standardLetters, AsStandard);
+
+    // coverage only counts residues aligned to residues of the query, not the ones in gaps of the query
+    vector<int> queryColumns;
+    for (int position = 0; position < sequences2num[0].size(); position++)
+    {
+        if (sequences2num[0][position] != 0)
+        {
+            queryColumns.push_back(position);
+        }
+    }
+
+    vector<int> representatives = {0};
+    for (int k = 1; k < sequences2num.size() && representatives.size() < options.maxDepth; k++)
+    {
+        if (options.minCoverage > 0)
+        {
+            int coveredResidues = 0;
+            for (int position : queryColumns)
+            {
+                coveredResidues += (sequences2num[k][position] != 0);
+            }
+            if (coveredResidues < options.minCoverage * queryColumns.size())
+            {
+                continue;
+            }
+        }
+        if (options.maxIdentity < 1)
+        {
+            bool redundant = false;
+            bool similarToRepresentative, similarToK;
+            for (int representative : representatives)
+            {
+                similarityCalculator.compare(representative, k, similarToRepresentative, similarToK);
+                if (similarToK)
+                {
+                    redundant = true;
+                    break;
+                }
+            }
+            if (redundant)
+            {
+                continue;
+            }
+        }
+        representatives.push_back(k);
+    }
+
+    vector<Sequence> filtered;
+    for (int representative : representatives)
+    {
+        filtered.push_back(sequences[representative]);
+    }
+    return filtered;
+}
+
 /// @brief Convert the format of the input MSA file to the format of the output MSA file.
 /// @param inFile
 /// @param outFile
@@ -94,62 +210,22 @@ unordered_map<string, FlagInfo> Flags =
 /// @param outFormat
 /// @param checkValidation
 /// @param alphabet
+/// @param filterOptions
+/// @param inputDepth number of sequences of the input file
 /// @return size
-int convert(string inFile, string outFile, string inFormat, string outFormat, bool checkValidation, Alphabet alphabet)
-{
-    MSAReader* msaReader;
-    if (inFormat == "a2m")
-        msaReader = new MSAReader_a2m(inFile, alphabet, checkValidation);
-    else if(inFormat == "a3m")
-        msaReader = new MSAReader_a3m(inFile, alphabet, checkValidation);
-    else if(std::find(FASTA_FORMATS.begin(), FASTA_FORMATS.end(), inFormat) != FASTA_FORMATS.end())
-        msaReader = new MSAReader_fasta(inFile, alphabet, checkValidation);
-    else if(inFormat == "sto")
-        msaReader = new MSAReader_sto(inFile, alphabet, checkValidation);
-    else if(inFormat == "clustal")
-        msaReader = new MSAReader_clustal(inFile, alphabet, checkValidation);
-    else if (inFormat == "aln")
-        msaReader = new MSAReader_aln(inFile, alphabet, checkValidation);
-    else if (inFormat == "pfam")
-        msaReader = new MSAReader_pfam(inFile, alphabet, checkValidation);
-
-    vector<Sequence> sequences = msaReader->read();
-
-    MSAWriter* msaWriter;
-    if (outFormat == "a2m")
-        msaWriter = new MSAWriter_a2m(sequences, outFile);
-    else if (outFormat == "a3m")
-        msaWriter = new MSAWriter_a3m(sequences, outFile);
-    else if (std::find(FASTA_FORMATS.begin(), FASTA_FORMATS.end(), outFormat) != FASTA_FORMATS.end())
-        msaWriter = new MSAWriter_fasta(sequences, outFile);
-    else if (outFormat == "sto")
-        msaWriter = new MSAWriter_sto(sequences, outFile);
-    else if (outFormat == "clustal")
-        msaWriter = new MSAWriter_clustal(sequences, outFile);
-    else if (outFormat == "aln")
-        msaWriter = new MSAWriter_aln(sequences, outFile);
-    else if (outFormat == "pfam")
-        msaWriter = new MSAWriter_pfam(sequences, outFile);
-
-    msaWriter->write();
-
-    return sequences.size();
-}
-
-/// @brief Get given alphabet by user
-/// @param flagHandler 
-/// @return 
-Alphabet getAlphabet(FlagHandler& flagHandler)
+int convert(string inFile, string outFile, string inFormat, string outFormat, bool checkValidation, Alphabet alphabet,
+            const FilterOptions& filterOptions, int& inputDepth)
 {
-    int intValue = flagHandler.getIntValue("alphabet");
-    Alphabet alphabet = static_cast<Alphabet>(intValue);
-
-    // value is within the valid range of the enum
-    if (alphabet < Alphabet::protein || alphabet > Alphabet::DNA) {
-        throw runtime_error("Invalid 'alphabet' value. It is outside the valid enum range.");
+    vector<Sequence> sequences = readMSA(inFile, inFormat, alphabet, checkValidation);
+    inputDepth = sequences.size();
+    if (filterOptions.enabled)
+    {
+        sequences = filterSequences(sequences, alphabet, filterOptions);
     }
 
-    return alphabet;
+    writeMSA(sequences, outFile, outFormat);
+
+    return sequences.size();
 }
 
 int main(int argc, char **argv)
@@ -185,13 +261,25 @@ int main(int argc, char **argv)
         string outFormat = getFormat(outFile, flagHandler.getFlagValue("out_format"), "out_file");
 
         // alphabet
-        alphabet = getAlphabet(flagHandler);
+        alphabet = flagHandler.getAlphabet();
 
         // check_validation
         bool checkValidation = flagHandler.getBooleanValue("check_validation");
 
-        int msaDepth = convert(inFile, outFile, inFormat, outFormat, checkValidation, alphabet);
+        // max_identity, min_coverage, max_depth
+        FilterOptions filterOptions;
+        filterOptions.maxIdentity = flagHandler.getFlagValue("max_identity").empty() ? 1 : flagHandler.getFloatValue("max_identity");
+        filterOptions.minCoverage = flagHandler.getFlagValue("min_coverage").empty() ? 0 : flagHandler.getFloatValue("min_coverage");
+        filterOptions.maxDepth = flagHandler.getNonZeroIntValue("max_depth");
+        filterOptions.enabled = filterOptions.maxIdentity < 1 || filterOptions.minCoverage > 0 || filterOptions.maxDepth != INT_MAX;
 
+        int inputDepth;
+        int msaDepth = convert(inFile, outFile, inFormat, outFormat, checkValidation, alphabet, filterOptions, inputDepth);
+
+        if (filterOptions.enabled)
+        {
+            cout << "Filtered " << inFile << " from " << inputDepth << " to " << msaDepth << " sequences." << endl;
+        }
         cout << "Converted " << inFile << " with " <<  msaDepth << " sequences from " << inFormat
         << " to " << outFormat << " and saved the output as " << outFile << "." << endl;
         
@@ -0,0 +1,307 @@
+/**
+ * @file distanceStore.cpp
+ * @brief This file contains the implementation of the DistanceStore class.
+ *
+ * File layout (little-endian):
+ *   magic "NEFFDIST", version (uint32),
+ *   is_symmetric, non-standard option, bytes per count, padding (uint8 each), max mismatches (uint32),
+ *   depth, length (int32 each), padding (4 bytes),
+ *   number of positions counted in mismatches of each sequence (depth x int32, asymmetric only),
+ *   mismatches of pairs (i, j) with i < j in row-major order (one count for symmetric,
+ *   counts of i'th and j'th sequences for asymmetric; uint8 or uint16 each)
+ */
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <filesystem>
+#include <stdexcept>
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "common.h"
+#include "neffCalculator.h"
+#include "distanceStore.h"
+#include "binaryIO.h"
+
+using namespace std;
+
+static const char DISTANCE_MAGIC[8] = {'N', 'E', 'F', 'F', 'D', 'I', 'S', 'T'};
+static const uint32_t DISTANCE_VERSION = 1;
+static const size_t HEADER_SIZE = 32;
+
+/// @brief Offset of the first pair (i, i+1) of the i'th row in the upper triangle
+static size_t rowOffset(int i, int depth)
+{
+    return (size_t)i * (2 * (size_t)depth - i - 1) / 2;
+}
+
+/// @brief Count mismatches of all pairs in row tiles distributed among threads, saturated at 'maxMismatches', and write
+/// the counts of each tile at its offset of the file, so that only the counts of one tile per thread are kept in memory
+template <typename T>
+static void writePairMismatches(ostream& output, size_t dataOffset, const SimilarityCalculator& similarityCalculator,
+                                int depth, bool isSymmetric, int maxMismatches, int threads)
+{
+    int countsPerPair = isSymmetric ? 1 : 2;
+    int tileCount = getTileCount(depth);
+    threads = max(1, min(threads, tileCount));
+    atomic<int> nextTile(0);
+    mutex outputLock;
+
+    auto countTiles = [&]()
+    {
+        vector<T> counts; // counts of the rows of a tile, which are contiguous in the upper triangle
+        int mismatch_i, mismatch_j;
+        int tile;
+        while ((tile = nextTile++) < tileCount)
+        {
+            int tileStart = tile * TILE_SIZE;
+            int tileEnd = min((tile + 1) * TILE_SIZE, depth);
+            counts.resize((rowOffset(tileEnd, depth) - rowOffset(tileStart, depth)) * countsPerPair);
+            T* row = counts.data();
+            for (int i = tileStart; i < tileEnd; i++)
+            {
+                for (int j = i+1; j < depth; j++)
+                {
+                    similarityCalculator.countMismatches(i, j, maxMismatches, mismatch_i, mismatch_j);
+                    *row++ = min(mismatch_i, maxMismatches);
+                    if (!isSymmetric)
+                    {
+                        *row++ = min(mismatch_j, maxMismatches);
+                    }
+                }
+            }
+
+            lock_guard<mutex> guard(outputLock);
+            output.seekp(dataOffset + rowOffset(tileStart, depth) * countsPerPair * sizeof(T));
+            output.write(reinterpret_cast<const char*>(counts.data()), counts.size() * sizeof(T));
+        }
+    };
+
+    vector<thread> workers;
+    for (int t = 1; t < threads; t++)
+    {
+        workers.emplace_back(countTiles);
+    }
+    countTiles();
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+void DistanceStore::write(const string& file, const vector<vector<int>>& sequences, bool isSymmetric,
+                          const string& standardLetters, NonStandardHandler nonStandardOption, int maxMismatches, int threads)
+{
+    if (maxMismatches <= 0 || maxMismatches > UINT16_MAX)
+    {
+        throw runtime_error("Maximum number of mismatches of pair distances should be between 1 and " + to_string(UINT16_MAX) + ".");
+    }
+
+    // threshold is not used, as mismatches are counted up to 'maxMismatches' for any cutoff
+    SimilarityCalculator similarityCalculator(sequences, 1, isSymmetric, standardLetters, nonStandardOption);
+    int depth = sequences.size();
+    int length = sequences[0].size();
+    int bytesPerCount = maxMismatches <= UINT8_MAX ? 1 : 2;
+
+    string tempFile = file + ".tmp";
+    {
+        ofstream output(tempFile, ios::binary);
+        if (!output)
+        {
+            throw runtime_error("Failed to create file: " + tempFile);
+        }
+
+        output.write(DISTANCE_MAGIC, sizeof(DISTANCE_MAGIC));
+        writeValue<uint32_t>(output, DISTANCE_VERSION);
+        writeValue<uint8_t>(output, isSymmetric);
+        writeValue<uint8_t>(output, nonStandardOption);
+        writeValue<uint8_t>(output, bytesPerCount);
+        writeValue<uint8_t>(output, 0);
+        writeValue<uint32_t>(output, maxMismatches);
+        writeValue<int32_t>(output, depth);
+        writeValue<int32_t>(output, length);
+        writeValue<int32_t>(output, 0);
+
+        if (!isSymmetric)
+        {
+            for (int i = 0; i < depth; i++)
+            {
+                writeValue<int32_t>(output, similarityCalculator.getNonGapCount(i));
+            }
+        }
+
+        size_t dataOffset = output.tellp();
+        if (bytesPerCount == 1)
+        {
+            writePairMismatches<uint8_t>(output, dataOffset, similarityCalculator, depth, isSymmetric, maxMismatches, threads);
+        }
+        else
+        {
+            writePairMismatches<uint16_t>(output, dataOffset, similarityCalculator, depth, isSymmetric, maxMismatches, threads);
+        }
+
+        if (!output)
+        {
+            throw runtime_error("Failed to write file: " + tempFile);
+        }
+    }
+    filesystem::rename(tempFile, file);
+}
+
+DistanceStore::DistanceStore(const string& _file)
+    : file(_file), mapped(nullptr), mappedSize(0)
+{
+    ifstream input(file, ios::binary);
+    if (!input)
+    {
+        throw runtime_error("Failed to open the pair distances file '" + file + "'.");
+    }
+
+    char magic[sizeof(DISTANCE_MAGIC)];
+    if (!input.read(magic, sizeof(magic)) || memcmp(magic, DISTANCE_MAGIC, sizeof(magic)) != 0)
+    {
+        throw runtime_error("'" + file + "' is not a pair distances file.");
+    }
+    if (readValue<uint32_t>(input, file) != DISTANCE_VERSION)
+    {
+        throw runtime_error("Unsupported version of the pair distances file '" + file + "'.");
+    }
+
+    isSymmetric = readValue<uint8_t>(input, file);
+    nonStandardOption = static_cast<NonStandardHandler>(readValue<uint8_t>(input, file));
+    bytesPerCount = readValue<uint8_t>(input, file);
+    readValue<uint8_t>(input, file);
+    maxMismatches = readValue<uint32_t>(input, file);
+    depth = readValue<int32_t>(input, file);
+    length = readValue<int32_t>(input, file);
+    readValue<int32_t>(input, file);
+
+    if ((bytesPerCount != 1 && bytesPerCount != 2) || depth <= 0 || length < 0)
+    {
+        throw runtime_error("Pair distances file '" + file + "' is corrupted.");
+    }
+
+    if (!isSymmetric)
+    {
+        nonGapCount.resize(depth);
+        for (int i = 0; i < depth; i++)
+        {
+            nonGapCount[i] = readValue<int32_t>(input, file);
+        }
+    }
+    dataOffset = HEADER_SIZE + nonGapCount.size() * sizeof(int32_t);
+
+    size_t expectedSize = dataOffset + rowOffset(depth, depth) * (isSymmetric ? 1 : 2) * bytesPerCount;
+    input.seekg(0, ios::end);
+    mappedSize = input.tellg();
+    if (mappedSize < expectedSize)
+    {
+        throw runtime_error("File '" + file + "' is truncated.");
+    }
+    input.close();
+
+#if !defined(_WIN32)
+    int descriptor = open(file.c_str(), O_RDONLY);
+    void* address = descriptor < 0 ? MAP_FAILED : mmap(nullptr, mappedSize, PROT_READ, MAP_SHARED, descriptor, 0);
+    if (descriptor >= 0)
+    {
+        close(descriptor); // the mapping keeps the file open
+    }
+    if (address == MAP_FAILED)
+    {
+        throw runtime_error("Failed to map the pair distances file '" + file + "'.");
+    }
+    mapped = static_cast<const char*>(address);
+#else
+    buffer.resize(mappedSize);
+    ifstream data(file, ios::binary);
+    data.read(buffer.data(), mappedSize);
+    mapped = buffer.data();
+#endif
+}
+
+DistanceStore::~DistanceStore()
+{
+#if !defined(_WIN32)
+    if (mapped != nullptr)
+    {
+        munmap(const_cast<char*>(mapped), mappedSize);
+    }
+#endif
+}
+
+template <typename T>
+vector<int> DistanceStore::computeWeights(const vector<int>& cutoff, const vector<int>& rows) const
+{
+    const T* counts = reinterpret_cast<const T*>(mapped + dataOffset);
+    int countsPerPair = isSymmetric ? 1 : 2;
+    int rowCount = rows.size();
+    vector<int> weights(rowCount, 1); // number of homolog sequences to each sequence
+
+    for (int a = 0; a < rowCount; a++)
+    {
+        int i = rows[a];
+        const T* row = counts + rowOffset(i, depth) * countsPerPair;
+        for (int b = a+1; b < rowCount; b++)
+        {
+            const T* pair = row + (size_t)(rows[b] - i - 1) * countsPerPair;
+            if (isSymmetric)
+            {
+                bool similar = (pair[0] <= cutoff[0]);
+                weights[a] += similar;
+                weights[b] += similar;
+            }
+            else
+            {
+                weights[a] += (pair[0] <= cutoff[i]);
+                weights[b] += (pair[1] <= cutoff[rows[b]]);
+            }
+        }
+    }
+    return weights;
+}
+
+vector<int> DistanceStore::computeWeights(float threshold, const vector<int>& rows) const
+{
+    if (rows.empty())
+    {
+        throw runtime_error("There is no sequence to compute weights for.");
+    }
+
+    // cutoffs are computed the same as comparing sequences;
+    // saturated counts are exact for cutoffs below the saturation
+    vector<int> cutoff;
+    if (isSymmetric)
+    {
+        cutoff.push_back(length * (1-threshold));
+    }
+    else
+    {
+        cutoff.assign(depth, 0);
+        for (int i : rows)
+        {
+            cutoff[i] = nonGapCount[i] * (1-threshold);
+        }
+    }
+    for (int i : rows)
+    {
+        if (cutoff[isSymmetric ? 0 : i] >= maxMismatches)
+        {
+            throw runtime_error("Threshold " + to_string(threshold) + " needs pair distances of up to "
+                                + to_string(cutoff[isSymmetric ? 0 : i] + 1) + " mismatches, but '" + file
+                                + "' is saturated at " + to_string(maxMismatches) + " mismatches.");
+        }
+    }
+
+    return bytesPerCount == 1 ? computeWeights<uint8_t>(cutoff, rows) : computeWeights<uint16_t>(cutoff, rows);
+}
@@ -0,0 +1,72 @@
+/**
+ * @file distanceStore.h
+ * @brief This file contains the declaration of the DistanceStore class.
+ *
+ * A distance store keeps the number of mismatches of every pair of sequences of an MSA (upper triangle),
+ * saturated at a maximum number of mismatches, in a binary file that is memory-mapped for queries.
+ * Sequence weights at any threshold whose cutoffs are below the saturation, for any subset of rows
+ * (e.g. the first d rows), are then computed by scanning the stored counts instead of comparing sequences.
+ */
+
+#ifndef DISTANCE_STORE_H
+#define DISTANCE_STORE_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include "common.h"
+
+class DistanceStore
+{
+public:
+    /// @brief Count mismatches of all pairs of sequences and write them in a binary file, one tile of rows at a time;
+    /// the file is replaced atomically
+    /// @param file
+    /// @param sequences
+    /// @param isSymmetric
+    /// @param standardLetters
+    /// @param nonStandardOption
+    /// @param maxMismatches counts are saturated at this value (stored in 1 byte up to 255, otherwise in 2 bytes)
+    /// @param threads
+    static void write(const std::string& file, const std::vector<std::vector<int>>& sequences, bool isSymmetric,
+                      const std::string& standardLetters, NonStandardHandler nonStandardOption, int maxMismatches, int threads = 1);
+
+    /// @brief Open a distance store file for queries
+    /// @param file
+    explicit DistanceStore(const std::string& file);
+    ~DistanceStore();
+
+    DistanceStore(const DistanceStore&) = delete;
+    DistanceStore& operator=(const DistanceStore&) = delete;
+
+    int getDepth() const { return depth; }
+    int getLength() const { return length; }
+    bool getIsSymmetric() const { return isSymmetric; }
+    NonStandardHandler getNonStandardOption() const { return nonStandardOption; }
+
+    /// @brief Compute sequence weights of the given rows at the given threshold, considering only pairs within the rows
+    /// @param threshold
+    /// @param rows indices of rows (starting from 0), in increasing order
+    /// @return inverse of sequence weights of the given rows
+    std::vector<int> computeWeights(float threshold, const std::vector<int>& rows) const;
+
+private:
+    std::string file;
+    bool isSymmetric;
+    NonStandardHandler nonStandardOption;
+    int bytesPerCount;
+    int maxMismatches;
+    int depth;
+    int length;
+    std::vector<int> nonGapCount; // number of positions counted in mismatches of each sequence (asymmetric)
+
+    const char* mapped;    // whole file, memory-mapped (or read in memory, where mapping is not available)
+    size_t mappedSize;
+    size_t dataOffset;     // offset of the counts in the file
+    std::vector<char> buffer;
+
+    template <typename T>
+    std::vector<int> computeWeights(const std::vector<int>& cutoff, const std::vector<int>& rows) const;
+};
+
+#endif
@@ -39,6 +39,7 @@ void FlagHandler::processFlags(const vector<string>& args)
                 if (!value.empty())
                 {
                     flag->second.value = value;
+                    givenFlags.insert(name);
                 }
                 else
                 {
@@ -60,6 +61,11 @@ void FlagHandler::processFlags(const vector<string>& args)
     }
 }
 
+bool FlagHandler::isGiven(const string& flagName) const
+{
+    return givenFlags.count(flagName) > 0;
+}
+
 string FlagHandler::getFlagValue(const string& flagName) const
 {
     auto flag = flags.find(flagName);
@@ -187,6 +193,85 @@ vector<int> FlagHandler::getIntArrayValue(const string& name) const
     return values;
 }
 
+vector<float> FlagHandler::getFloatArrayValue(const string& name) const
+{
+    vector<float> values;
+    for (const string& item : getArrayValues(name))
+    {
+        float value;
+        try {
+            size_t pos;
+            value = stof(item, &pos);
+            if (pos != item.length() || value <= 0.0 || value > 1.0) {
+                throw runtime_error("");
+            }
+        } catch (const exception& e) {
+            throw runtime_error("Invalid '" + name + "' value. Each value should be a number between 0 and 1 (excluding 0).");
+        }
+        values.push_back(value);
+    }
+
+    if (values.empty()) {
+        throw runtime_error("Invalid '" + name + "' value. It should contain at least one number");
+    }
+    return values;
+}
+
+vector<bool> FlagHandler::getBooleanArrayValue(const string& name) const
+{
+    vector<bool> values;
+    for (const string& item : getArrayValues(name))
+    {
+        if (item == "true") {
+            values.push_back(true);
+        } else if (item == "false") {
+            values.push_back(false);
+        } else {
+            throw runtime_error("Invalid boolean '" + name + "' value. Each value should be either 'true' or 'false'.");
+        }
+    }
+
+    if (values.empty()) {
+        throw runtime_error("Invalid '" + name + "' value. It should contain at least one value");
+    }
+    return values;
+}
+
+vector<pair<int, int>> FlagHandler::getRangeArrayValue(const string& name) const
+{
+    vector<pair<int, int>> ranges;
+    for (const string& item : getArrayValues(name))
+    {
+        int start, end;
+        try {
+            size_t separator = item.find('-');
+            size_t pos;
+            start = stoi(item.substr(0, separator), &pos);
+            if (pos != min(separator, item.length())) {
+                throw runtime_error("");
+            }
+            end = start;
+            if (separator != string::npos) {
+                end = stoi(item.substr(separator + 1), &pos);
+                if (pos != item.length() - separator - 1) {
+                    throw runtime_error("");
+                }
+            }
+            if (start <= 0 || end < start) {
+                throw runtime_error("");
+            }
+        } catch (const exception& e) {
+            throw runtime_error("Invalid '" + name + "' value. Each item should be a positive number or a range as '<start>-<end>' with start <= end.");
+        }
+        ranges.push_back({start, end});
+    }
+
+    if (ranges.empty()) {
+        throw runtime_error("Invalid '" + name + "' value. It should contain at least one item");
+    }
+    return ranges;
+}
+
 int FlagHandler::getIntValue(const string& name) const
 {
     string svalue = getFlagValue(name);
@@ -218,3 +303,32 @@ int FlagHandler::getNonZeroIntValue(const string& name) const
     }
     return value;
 }
+
+float FlagHandler::getPositiveFloatValue(const string& name) const
+{
+    float value;
+    try {
+        size_t pos;
+        string svalue = getFlagValue(name);
+        value = stof(svalue, &pos);
+        if (pos != svalue.length() || !(value > 0.0)) {
+            throw runtime_error("");
+        }
+    } catch (const exception& e) {
+        throw runtime_error("Invalid '" + name + "' value. It should be a positive number.");
+    }
+    return value;
+}
+
+Alphabet FlagHandler::getAlphabet() const
+{
+    int intValue = getIntValue("alphabet");
+    Alphabet alphabet = static_cast<Alphabet>(intValue);
+
+    // value is within the valid range of the enum
+    if (alphabet < Alphabet::protein || alphabet > Alphabet::DNA) {
+        throw runtime_error("Invalid 'alphabet' value. It is outside the valid enum range.");
+    }
+
+    return alphabet;
+}
@@ -9,8 +9,10 @@
 #include <iostream>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <stdexcept>
 #include <vector>
+#include "common.h"
 
 struct FlagInfo
 {    
@@ -22,6 +24,7 @@ class FlagHandler
 {
 private:
     std::unordered_map<std::string, FlagInfo> flags;
+    std::unordered_set<std::string> givenFlags; // flags given in the processed arguments
 
 public:
 
@@ -46,6 +49,11 @@ public:
      */
     std::string getFlagValue(const std::string& flagName) const;
 
+    /// @brief Whether a flag is given in the processed arguments (even with its default value)
+    /// @param flagName 
+    /// @return 
+    bool isGiven(const std::string& flagName) const;
+
     /**
      * @brief Checks if all required flags have values.
      * @throws std::runtime_error if a required flag is missing a value.
@@ -86,6 +94,21 @@ public:
     /// @return 
     std::vector<int> getIntArrayValue(const std::string& name) const;
 
+    /// @brief Get given list of float options by user
+    /// @param name
+    /// @return 
+    std::vector<float> getFloatArrayValue(const std::string& name) const;
+
+    /// @brief Get given list of boolean options by user
+    /// @param name
+    /// @return 
+    std::vector<bool> getBooleanArrayValue(const std::string& name) const;
+
+    /// @brief Get given list of ranges by user, as '<start>-<end>' or '<value>' (positive, inclusive)
+    /// @param name
+    /// @return pairs of start and end of each range
+    std::vector<std::pair<int, int>> getRangeArrayValue(const std::string& name) const;
+
     /// @brief Get given int option by user
     /// @param name 
     /// @return 
@@ -95,6 +118,15 @@ public:
     /// @param name 
     /// @return 
     int getNonZeroIntValue(const std::string& name) const;
+
+    /// @brief Get given positive float option by user (not limited to 1)
+    /// @param name 
+    /// @return 
+    float getPositiveFloatValue(const std::string& name) const;
+
+    /// @brief Get given alphabet option by user ('alphabet' flag)
+    /// @return 
+    Alphabet getAlphabet() const;
 };
 
 #endif
\ No newline at end of file
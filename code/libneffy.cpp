@@ -0,0 +1,411 @@
+/**
+ * @file libneffy.cpp
+ * @brief This file contains the implementation of the C API of the NEFFy library (libneffy).
+ *
+ * Exceptions are caught at the API boundary and turned into NEFFY_ERROR (or NULL) with the message kept for
+ * neffy_last_error.
+ */
+
+#include <vector>
+#include <string>
+#include <cmath>
+#include <cctype>
+#include <cstring>
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+#include "common.h"
+#include "msaReader.h"
+#include "msaWriter.h"
+#include "multimerHandler.h"
+#include "neffCalculator.h"
+#include "libneffy.h"
+
+using namespace std;
+
+// Loaded MSA, with the encoded sequences and weights of the last parameters they were computed with
+struct neffy_msa
+{
+    Alphabet alphabet;
+    vector<Sequence> sequences;
+
+    // encoded sequences of the first encodedDepth sequences
+    bool isEncoded = false;
+    int encodedDepth;
+    NonStandardHandler encodedOption;
+    float encodedGapCutoff;
+    vector<vector<int>> sequences2num;
+
+    // number of homologs of each encoded sequence
+    bool hasWeights = false;
+    float weightsThreshold;
+    bool weightsSymmetric;
+    vector<int> sequenceWeights;
+};
+
+static thread_local string lastError;
+
+/// @brief Run a function of the API, keeping the message of any error for neffy_last_error
+/// @param function
+/// @return NEFFY_OK or NEFFY_ERROR
+template <typename Function>
+static int runGuarded(Function function)
+{
+    try
+    {
+        lastError.clear();
+        function();
+        return NEFFY_OK;
+    }
+    catch (const exception& e)
+    {
+        lastError = e.what();
+    }
+    catch (...)
+    {
+        lastError = "Unknown error.";
+    }
+    return NEFFY_ERROR;
+}
+
+/// @brief Get the alphabet of the given value
+/// @param value
+/// @return
+static Alphabet toAlphabet(int value)
+{
+    if (value < Alphabet::protein || value > Alphabet::DNA)
+    {
+        throw runtime_error("Invalid 'alphabet' value. It is outside the valid enum range.");
+    }
+    return static_cast<Alphabet>(value);
+}
+
+/// @brief Check the parameters, with the same ranges as the flags of neff
+/// @param params
+static void checkParams(const neffy_params* params)
+{
+    if (params == nullptr)
+    {
+        throw runtime_error("Parameters should be given.");
+    }
+    if (!(params->threshold > 0 && params->threshold <= 1))
+    {
+        throw runtime_error("Invalid 'threshold' value. It should be a number between 0 and 1 (excluding 0).");
+    }
+    if (!(params->gap_cutoff > 0 && params->gap_cutoff <= 1))
+    {
+        throw runtime_error("Invalid 'gap_cutoff' value. It should be a number between 0 and 1 (excluding 0).");
+    }
+    if (params->non_standard_option < AsStandard || params->non_standard_option > ConsiderGap)
+    {
+        throw runtime_error("Invalid 'non_standard_option' value. It is outside the valid enum range.");
+    }
+    if (params->norm < Sqrt_L || params->norm > None)
+    {
+        throw runtime_error("Invalid 'norm' value. It is outside the valid enum range.");
+    }
+    if (params->depth < 0 || params->threads < 1)
+    {
+        throw runtime_error("Invalid 'depth' or 'threads' value. Depth cannot be negative and threads should be positive.");
+    }
+}
+
+/// @brief Get the encoded sequences of the MSA for the given parameters, encoding them only if the parameters of
+/// encoding are changed since the last call
+/// @param msa
+/// @param params
+/// @return
+static const vector<vector<int>>& getEncodedSequences(neffy_msa* msa, const neffy_params* params)
+{
+    int depth = params->depth == 0 ? msa->sequences.size() : min(params->depth, (int)msa->sequences.size());
+    NonStandardHandler nonStandardOption = static_cast<NonStandardHandler>(params->non_standard_option);
+
+    if (!msa->isEncoded || msa->encodedDepth != depth || msa->encodedOption != nonStandardOption
+        || msa->encodedGapCutoff != params->gap_cutoff)
+    {
+        vector<Sequence> sequences(msa->sequences.begin(), msa->sequences.begin() + depth);
+        msa->sequences2num = processSequences(sequences, getStandardLetters(msa->alphabet), getNonStandardLetters(msa->alphabet),
+                                              nonStandardOption, params->gap_cutoff);
+        msa->isEncoded = true;
+        msa->encodedDepth = depth;
+        msa->encodedOption = nonStandardOption;
+        msa->encodedGapCutoff = params->gap_cutoff;
+        msa->hasWeights = false;
+    }
+    return msa->sequences2num;
+}
+
+/// @brief Get the number of homologs of each encoded sequence for the given parameters, comparing pairs of sequences
+/// only if the parameters are changed since the last call
+/// @param msa
+/// @param params
+/// @return
+static const vector<int>& getSequenceWeights(neffy_msa* msa, const neffy_params* params)
+{
+    checkParams(params);
+    const vector<vector<int>>& sequences2num = getEncodedSequences(msa, params);
+
+    if (!msa->hasWeights || msa->weightsThreshold != params->threshold || msa->weightsSymmetric != (params->is_symmetric != 0))
+    {
+        msa->sequenceWeights = computeWeights(sequences2num, params->threshold, params->is_symmetric != 0,
+                                              getStandardLetters(msa->alphabet), msa->encodedOption, params->threads);
+        msa->hasWeights = true;
+        msa->weightsThreshold = params->threshold;
+        msa->weightsSymmetric = params->is_symmetric != 0;
+    }
+    return msa->sequenceWeights;
+}
+
+/// @brief Create a sequence of the given letters, in upper case
+/// @param index index of the sequence in the MSA
+/// @param letters
+/// @param length
+/// @param alphabet
+/// @param checkValidation
+/// @return
+static Sequence toSequence(int index, const char* letters, size_t length, Alphabet alphabet, bool checkValidation)
+{
+    Sequence sequence;
+    sequence.id = "sequence_" + to_string(index + 1);
+    sequence.sequence.assign(letters, length);
+    for (char& letter : sequence.sequence)
+    {
+        letter = toupper(letter);
+    }
+    if (checkValidation && sequence.sequence.find_first_not_of(getAllowedLetters(alphabet)) != string::npos)
+    {
+        throw runtime_error("MSA contains an invalid character in sequence " + to_string(index + 1) + ".");
+    }
+    return sequence;
+}
+
+/// @brief Create a handle of the given sequences
+/// @param sequences
+/// @param alphabet
+/// @param omitGapsInQuery
+/// @return
+static neffy_msa* createMSA(vector<Sequence> sequences, Alphabet alphabet, bool omitGapsInQuery)
+{
+    if (sequences.empty())
+    {
+        throw runtime_error("There is no sequence in the MSA.");
+    }
+    for (const auto& sequence : sequences)
+    {
+        if (sequence.sequence.size() != sequences[0].sequence.size())
+        {
+            throw runtime_error("Sequences of the MSA should be aligned (have the same length).");
+        }
+    }
+    if (omitGapsInQuery && sequences[0].sequence.find('-') != string::npos)
+    {
+        keepNonGapPositionsOfQuerySequence(sequences);
+    }
+
+    neffy_msa* msa = new neffy_msa();
+    msa->alphabet = alphabet;
+    msa->sequences = move(sequences);
+    return msa;
+}
+
+extern "C" {
+
+int neffy_api_version(void)
+{
+    return NEFFY_API_VERSION;
+}
+
+const char* neffy_last_error(void)
+{
+    return lastError.c_str();
+}
+
+void neffy_default_params(neffy_params* params)
+{
+    params->threshold = 0.8;
+    params->is_symmetric = 1;
+    params->non_standard_option = AsStandard;
+    params->gap_cutoff = 1;
+    params->norm = Sqrt_L;
+    params->depth = 0;
+    params->threads = 1;
+}
+
+neffy_msa* neffy_msa_load(const char* file, const char* format, int alphabet, int check_validation, int omit_query_gaps,
+                          int skip_lines)
+{
+    neffy_msa* msa = nullptr;
+    runGuarded([&]()
+    {
+        string msaFormat = getFormat(file, format == nullptr ? "" : format, "file");
+        vector<Sequence> sequences = readMSA(file, msaFormat, toAlphabet(alphabet), check_validation != 0, omit_query_gaps != 0,
+                                             skip_lines);
+        msa = createMSA(move(sequences), toAlphabet(alphabet), omit_query_gaps != 0);
+    });
+    return msa;
+}
+
+neffy_msa* neffy_msa_from_sequences(const char* const* sequences, int count, int alphabet, int check_validation,
+                                    int omit_query_gaps)
+{
+    neffy_msa* msa = nullptr;
+    runGuarded([&]()
+    {
+        vector<Sequence> msaSequences(max(count, 0));
+        for (int i = 0; i < count; i++)
+        {
+            msaSequences[i] = toSequence(i, sequences[i], strlen(sequences[i]), toAlphabet(alphabet), check_validation != 0);
+        }
+        msa = createMSA(move(msaSequences), toAlphabet(alphabet), omit_query_gaps != 0);
+    });
+    return msa;
+}
+
+neffy_msa* neffy_msa_from_matrix(const unsigned char* letters, int depth, int length, int alphabet, int check_validation,
+                                 int omit_query_gaps)
+{
+    neffy_msa* msa = nullptr;
+    runGuarded([&]()
+    {
+        vector<Sequence> msaSequences(max(depth, 0));
+        for (int i = 0; i < depth; i++)
+        {
+            msaSequences[i] = toSequence(i, reinterpret_cast<const char*>(letters) + (size_t)i * length, length,
+                                         toAlphabet(alphabet), check_validation != 0);
+        }
+        msa = createMSA(move(msaSequences), toAlphabet(alphabet), omit_query_gaps != 0);
+    });
+    return msa;
+}
+
+void neffy_msa_free(neffy_msa* msa)
+{
+    delete msa;
+}
+
+int neffy_msa_depth(const neffy_msa* msa)
+{
+    return msa->sequences.size();
+}
+
+int neffy_msa_length(const neffy_msa* msa)
+{
+    return msa->sequences[0].sequence.size();
+}
+
+int neffy_compute_weights(neffy_msa* msa, const neffy_params* params, float* weights, int* depth)
+{
+    return runGuarded([&]()
+    {
+        const vector<int>& sequenceWeights = getSequenceWeights(msa, params);
+        for (int i = 0; i < sequenceWeights.size(); i++)
+        {
+            weights[i] = 1. / sequenceWeights[i];
+        }
+        *depth = sequenceWeights.size();
+    });
+}
+
+int neffy_compute_neff(neffy_msa* msa, const neffy_params* params, float* neff, int* length)
+{
+    return runGuarded([&]()
+    {
+        const vector<int>& sequenceWeights = getSequenceWeights(msa, params);
+        int encodedLength = msa->sequences2num[0].size();
+        *neff = computeNeff(sequenceWeights, static_cast<Normalization>(params->norm), encodedLength);
+        if (length != nullptr)
+        {
+            *length = encodedLength;
+        }
+    });
+}
+
+int neffy_compute_residue_neff(neffy_msa* msa, const neffy_params* params, float* residue_neff, int* length)
+{
+    return runGuarded([&]()
+    {
+        const vector<int>& sequenceWeights = getSequenceWeights(msa, params);
+        vector<float> residueNEFF = computeResidueNEFF(msa->sequences2num, sequenceWeights, static_cast<Normalization>(params->norm));
+        copy(residueNEFF.begin(), residueNEFF.end(), residue_neff);
+        *length = residueNEFF.size();
+    });
+}
+
+int neffy_compute_multimer_neff(neffy_msa* msa, const neffy_params* params, const char* stoichiom, const int* chain_lengths,
+                                int chain_count, float* neffs, int* depths, int capacity, int* count)
+{
+    return runGuarded([&]()
+    {
+        checkParams(params);
+        if (params->gap_cutoff != 1)
+        {
+            throw runtime_error("NEFF of a multimer MSA is computed without removing gappy positions ('gap_cutoff' = 1).");
+        }
+
+        MultimerHandler multimerHandler(stoichiom);
+        const vector<vector<int>>& sequences2num = getEncodedSequences(msa, params);
+        Normalization norm = static_cast<Normalization>(params->norm);
+        NonStandardHandler nonStandardOption = msa->encodedOption;
+        string standardLetters = getStandardLetters(msa->alphabet);
+
+        // MSAs in the order of the results of neff
+        vector<vector<vector<int>>> msas = {sequences2num};
+        vector<int> msaDepths = {(int)sequences2num.size()};
+        if (multimerHandler.isHomomerFormat())
+        {
+            msas.push_back(multimerHandler.getHomomerIndividualMSA(sequences2num));
+            msaDepths.push_back(msas.back().size());
+        }
+        else if (multimerHandler.isHeteromerFormat())
+        {
+            vector<vector<vector<int>>> heteromerMSAs =
+                multimerHandler.getHetoromerMSAs(sequences2num, vector<int>(chain_lengths, chain_lengths + chain_count));
+            for (int i = 0; i < heteromerMSAs.size(); i++)
+            {
+                msas.push_back(heteromerMSAs[i]);
+                // the query sequence is not counted in the depth of individual MSAs
+                msaDepths.push_back(i == 0 ? heteromerMSAs[i].size() : max(0, (int)heteromerMSAs[i].size() - 1));
+            }
+        }
+        else
+        {
+            throw runtime_error(string("Stoichiometry: ") + stoichiom
+                                + " is not in the correct format 'An' for homomers and 'AnBm...' for heteromers");
+        }
+
+        if (msas.size() > capacity)
+        {
+            throw runtime_error("There is room for " + to_string(capacity) + " values, but " + to_string(msas.size())
+                                + " values are computed.");
+        }
+        for (int m = 0; m < msas.size(); m++)
+        {
+            if (msas[m].empty())
+            {
+                neffs[m] = NAN;
+                depths[m] = 0;
+                continue;
+            }
+            // weights of the entire MSA are kept in the handle
+            vector<int> sequenceWeights = m == 0 ? getSequenceWeights(msa, params)
+                                                 : computeWeights(msas[m], params->threshold, params->is_symmetric != 0,
+                                                                  standardLetters, nonStandardOption, params->threads);
+            neffs[m] = computeNeff(sequenceWeights, norm, msas[m][0].size());
+            depths[m] = msaDepths[m];
+        }
+        *count = msas.size();
+    });
+}
+
+int neffy_convert(const char* in_file, const char* out_file, const char* in_format, const char* out_format, int alphabet,
+                  int check_validation)
+{
+    return runGuarded([&]()
+    {
+        string inFormat = getFormat(in_file, in_format == nullptr ? "" : in_format, "in_file");
+        string outFormat = getFormat(out_file, out_format == nullptr ? "" : out_format, "out_file");
+        writeMSA(readMSA(in_file, inFormat, toAlphabet(alphabet), check_validation != 0), out_file, outFormat);
+    });
+}
+
+}
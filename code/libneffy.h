@@ -0,0 +1,96 @@
+/**
+ * @file libneffy.h
+ * @brief This file contains the C API of the NEFFy library (libneffy).
+ *
+ * An MSA is loaded once in a handle, from a file or from aligned sequences in memory, and can be used in any number of
+ * calls computing sequence weights, NEFF or per-residue NEFF with different parameters. The encoded sequences and the
+ * last computed weights are kept in the handle, so calls with the same parameters do not compare sequences again.
+ *
+ * Functions returning int return NEFFY_OK on success and NEFFY_ERROR on failure; functions returning a handle return
+ * NULL on failure. The message of the last error of the calling thread is returned by neffy_last_error.
+ * A handle should not be used by more than one thread at a time; different handles can be used concurrently.
+ */
+
+#ifndef LIBNEFFY_H
+#define LIBNEFFY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define NEFFY_API_VERSION 1
+#define NEFFY_OK 0
+#define NEFFY_ERROR (-1)
+
+/* Handle of a loaded MSA */
+typedef struct neffy_msa neffy_msa;
+
+/* Parameters of computing sequence weights and NEFF (the same as the flags of neff) */
+typedef struct neffy_params
+{
+    float threshold;         /* threshold value of considering two sequences similar (default: 0.8) */
+    int is_symmetric;        /* 1: symmetric, 0: asymmetric (default: 1) */
+    int non_standard_option; /* 0: AsStandard, 1: ConsiderGapInCutoff, 2: ConsiderGap (default: 0) */
+    float gap_cutoff;        /* positions with a fraction of gaps >= gap_cutoff are removed (default: 1) */
+    int norm;                /* 0: sqrt(length), 1: length, 2: no normalization (default: 0) */
+    int depth;               /* number of the first sequences considered, 0 for all (default: 0) */
+    int threads;             /* number of threads used to compare pairs of sequences (default: 1) */
+} neffy_params;
+
+/* Version of the API the library is built with (NEFFY_API_VERSION) */
+int neffy_api_version(void);
+
+/* Message of the last error of the calling thread (empty if there is none) */
+const char* neffy_last_error(void);
+
+/* Set the default parameters */
+void neffy_default_params(neffy_params* params);
+
+/* Load an MSA file; format may be NULL or empty to be inferred from the file extension.
+   alphabet: 0: protein, 1: RNA, 2: DNA */
+neffy_msa* neffy_msa_load(const char* file, const char* format, int alphabet, int check_validation, int omit_query_gaps,
+                          int skip_lines);
+
+/* Load an MSA from count aligned sequences, starting from the query sequence */
+neffy_msa* neffy_msa_from_sequences(const char* const* sequences, int count, int alphabet, int check_validation,
+                                    int omit_query_gaps);
+
+/* Load an MSA from a depth x length matrix of letters (row-major, one byte for each letter, e.g. a NumPy uint8 array
+   of ASCII codes), starting from the query sequence */
+neffy_msa* neffy_msa_from_matrix(const unsigned char* letters, int depth, int length, int alphabet, int check_validation,
+                                 int omit_query_gaps);
+
+/* Free a handle (NULL is ignored) */
+void neffy_msa_free(neffy_msa* msa);
+
+/* Number of sequences and length of sequences of the loaded MSA */
+int neffy_msa_depth(const neffy_msa* msa);
+int neffy_msa_length(const neffy_msa* msa);
+
+/* Compute sequence weights (inverse of the number of homologs) of the considered sequences;
+   weights should have room for neffy_msa_depth values. depth is set to the number of written weights. */
+int neffy_compute_weights(neffy_msa* msa, const neffy_params* params, float* weights, int* depth);
+
+/* Compute NEFF; length (may be NULL) is set to the length of sequences after removing gappy positions */
+int neffy_compute_neff(neffy_msa* msa, const neffy_params* params, float* neff, int* length);
+
+/* Compute per-residue (column-wise) NEFF; residue_neff should have room for neffy_msa_length values.
+   length is set to the number of written values (length of sequences after removing gappy positions). */
+int neffy_compute_residue_neff(neffy_msa* msa, const neffy_params* params, float* residue_neff, int* length);
+
+/* Compute NEFF of a multimer MSA of the given stoichiometry (e.g. A3 or A2B1); chain_lengths (chain_count values) are
+   required for heteromers. Values are written in the order of neff: entire MSA and individual MSA for homomers, or
+   entire MSA, paired MSA and the individual MSA of each chain for heteromers, with their depths (NaN and 0 for a chain
+   without an individual MSA). neffs and depths should have room for capacity values; count is set to the number of values. */
+int neffy_compute_multimer_neff(neffy_msa* msa, const neffy_params* params, const char* stoichiom, const int* chain_lengths,
+                                int chain_count, float* neffs, int* depths, int capacity, int* count);
+
+/* Convert the format of an MSA file; formats may be NULL or empty to be inferred from the file extensions */
+int neffy_convert(const char* in_file, const char* out_file, const char* in_format, const char* out_format, int alphabet,
+                  int check_validation);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
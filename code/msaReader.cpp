@@ -14,6 +14,7 @@
 #include <sstream>
 #include <algorithm>
 #include <stdexcept>
+#include <memory>
 #include "common.h"
 #include "msaReader.h"
 
@@ -30,6 +31,11 @@ vector<Sequence> MSAReader::read()
         throw runtime_error( "Failed to open the input file '"+ file + "'.");
     }
 
+    return read(inputFile);
+}
+
+vector<Sequence> MSAReader::read(istream& inputFile)
+{
     // Skip the first n lines
     if (skipLines > 0)
     {
@@ -39,8 +45,6 @@ vector<Sequence> MSAReader::read()
 
     readFile(inputFile);
 
-    inputFile.close();
-
     makeUppercase();
 
     if(checkValidation)
@@ -50,7 +54,7 @@ vector<Sequence> MSAReader::read()
     return Sequences;
 }
 
-// void MSAReader::readFile(ifstream& inputFile) {}
+// void MSAReader::readFile(istream& inputFile) {}
 
 void MSAReader::makeUppercase()
 {
@@ -109,7 +113,7 @@ string MSAReader::containsInvalidLetters(Alphabet alphabet)
     return "";
 }
 
-void MSAReader_a2m::readFile(ifstream& inputFile)
+void MSAReader_a2m::readFile(istream& inputFile)
 {
     string line, id, sequence, temp, remarks = "";
     int num = 0;
@@ -152,7 +156,7 @@ void MSAReader_a2m::readFile(ifstream& inputFile)
     }
 }
 
-void MSAReader_a3m::readFile(ifstream& inputFile)
+void MSAReader_a3m::readFile(istream& inputFile)
 {
     string line, id, sequence, temp, remarks = "";
     int num =  0;
@@ -241,7 +245,7 @@ void MSAReader_a3m::readFile(ifstream& inputFile)
     }
 }
 
-void MSAReader_sto::readFile(ifstream& inputFile)
+void MSAReader_sto::readFile(istream& inputFile)
 {
     string id, seq, line, temp, remarks = "";
     int lastGS = 0;
@@ -340,7 +344,7 @@ void MSAReader_sto::readFile(ifstream& inputFile)
     }
 }
 
-void MSAReader_fasta::readFile(ifstream& inputFile)
+void MSAReader_fasta::readFile(istream& inputFile)
 {
     int num = 0;
     string line, id, sequence, temp, remarks = "";
@@ -395,7 +399,7 @@ void MSAReader_fasta::readFile(ifstream& inputFile)
     }
 }
 
-void MSAReader_clustal::readFile(ifstream& inputFile)
+void MSAReader_clustal::readFile(istream& inputFile)
 {
     string line, id, seq;
     while (getline(inputFile, line))
@@ -424,7 +428,7 @@ void MSAReader_clustal::readFile(ifstream& inputFile)
     }
 }
 
-void MSAReader_aln::readFile(ifstream& inputFile)
+void MSAReader_aln::readFile(istream& inputFile)
 {
     string line, sequence;
     
@@ -439,7 +443,7 @@ void MSAReader_aln::readFile(ifstream& inputFile)
     }
 }
 
-void MSAReader_pfam::readFile(ifstream& inputFile)
+void MSAReader_pfam::readFile(istream& inputFile)
 {
     string line, id, seq;
     while (getline(inputFile, line))
@@ -467,3 +471,45 @@ void MSAReader_pfam::readFile(ifstream& inputFile)
         }
     }
 }
+
+/// @brief Create the reader of the given format
+/// @param file 
+/// @param format 
+/// @param alphabet 
+/// @param checkValidation 
+/// @param omitGaps 
+/// @param skipLines 
+/// @return 
+static unique_ptr<MSAReader> createMSAReader(const string& file, const string& format, Alphabet alphabet, bool checkValidation,
+                                             bool omitGaps, int skipLines)
+{
+    if (format == "a2m")
+        return make_unique<MSAReader_a2m>(file, alphabet, checkValidation, omitGaps, skipLines);
+    else if (format == "a3m")
+        return make_unique<MSAReader_a3m>(file, alphabet, checkValidation, omitGaps, skipLines);
+    else if (format == "sto")
+        return make_unique<MSAReader_sto>(file, alphabet, checkValidation, omitGaps, skipLines);
+    else if (format == "clustal")
+        return make_unique<MSAReader_clustal>(file, alphabet, checkValidation, omitGaps, skipLines);
+    else if (format == "aln")
+        return make_unique<MSAReader_aln>(file, alphabet, checkValidation, omitGaps, skipLines);
+    else if (format == "pfam")
+        return make_unique<MSAReader_pfam>(file, alphabet, checkValidation, omitGaps, skipLines);
+    else if (find(FASTA_FORMATS.begin(), FASTA_FORMATS.end(), format) != FASTA_FORMATS.end())
+        return make_unique<MSAReader_fasta>(file, alphabet, checkValidation, omitGaps, skipLines);
+    else
+        throw runtime_error("Unsupported format '" + format + "' of the input file '" + file + "'.");
+}
+
+vector<Sequence> readMSA(const string& file, const string& format, Alphabet alphabet, bool checkValidation,
+                         bool omitGaps, int skipLines)
+{
+    return createMSAReader(file, format, alphabet, checkValidation, omitGaps, skipLines)->read();
+}
+
+vector<Sequence> readMSAText(const string& text, const string& format, Alphabet alphabet, bool checkValidation,
+                             bool omitGaps, int skipLines)
+{
+    istringstream input(text);
+    return createMSAReader("<inline MSA>", format, alphabet, checkValidation, omitGaps, skipLines)->read(input);
+}
@@ -40,7 +40,7 @@ protected:
     /// @param alphabet 
     void validateSequences(Alphabet alphabet);
 
-    virtual void readFile(std::ifstream& file)=0;  //??
+    virtual void readFile(std::istream& file)=0;  //??
 
 public:
     /// @brief Constructor
@@ -50,9 +50,16 @@ public:
     /// @param _omitGaps 
     MSAReader(std::string _file, Alphabet _alphabet, bool _checkValidation, bool _omitGaps = false, int _skipLines = 0);
 
+    virtual ~MSAReader() = default;
+
     /// @brief Read the MSA file
     /// @return The processed sequences in the file
     std::vector<Sequence> read();
+
+    /// @brief Read the MSA from the given stream (e.g. an MSA in memory)
+    /// @param input 
+    /// @return The processed sequences in the stream
+    std::vector<Sequence> read(std::istream& input);
 };
 
 // Derived class for reading a2m format
@@ -61,7 +68,7 @@ class MSAReader_a2m : public MSAReader
 public:
     using MSAReader::MSAReader;
 private:
-    void readFile(std::ifstream& file) override;
+    void readFile(std::istream& file) override;
 };
 
 // Derived class for reading a3m format
@@ -70,7 +77,7 @@ class MSAReader_a3m : public MSAReader
 public:
     using MSAReader::MSAReader;
 private:
-    void readFile(std::ifstream& file) override;
+    void readFile(std::istream& file) override;
 };
 
 // Derived class for reading stockholm format
@@ -79,7 +86,7 @@ class MSAReader_sto : public MSAReader
 public:
     using MSAReader::MSAReader;
 private:
-    void readFile(std::ifstream& file) override;
+    void readFile(std::istream& file) override;
 };
 
 // Derived class for reading fasta format
@@ -88,7 +95,7 @@ class MSAReader_fasta : public MSAReader
 public:
     using MSAReader::MSAReader;
 private:
-    void readFile(std::ifstream& file) override;
+    void readFile(std::istream& file) override;
 };
 
 // Derived class for reading clustal format
@@ -97,7 +104,7 @@ class MSAReader_clustal : public MSAReader
 public:
     using MSAReader::MSAReader;
 private:
-    void readFile(std::ifstream& file) override;
+    void readFile(std::istream& file) override;
 };
 
 // Derived class for reading aln format
@@ -106,7 +113,7 @@ class MSAReader_aln : public MSAReader
 public:
     using MSAReader::MSAReader;
 private:
-    void readFile(std::ifstream& file) override;
+    void readFile(std::istream& file) override;
 };
 
 // Derived class for reading pfam format
@@ -115,7 +122,29 @@ class MSAReader_pfam : public MSAReader
 public:
     using MSAReader::MSAReader;
 private:
-    void readFile(std::ifstream& file) override;
+    void readFile(std::istream& file) override;
 };
 
+/// @brief Read an MSA file with the reader of the given format
+/// @param file 
+/// @param format one of VALID_FORMATS
+/// @param alphabet 
+/// @param checkValidation 
+/// @param omitGaps 
+/// @param skipLines 
+/// @return The processed sequences in the file
+std::vector<Sequence> readMSA(const std::string& file, const std::string& format, Alphabet alphabet, bool checkValidation,
+                              bool omitGaps = false, int skipLines = 0);
+
+/// @brief Read an MSA given as text (the content of an MSA file) with the reader of the given format
+/// @param text 
+/// @param format one of VALID_FORMATS
+/// @param alphabet 
+/// @param checkValidation 
+/// @param omitGaps 
+/// @param skipLines 
+/// @return The processed sequences in the text
+std::vector<Sequence> readMSAText(const std::string& text, const std::string& format, Alphabet alphabet, bool checkValidation,
+                                  bool omitGaps = false, int skipLines = 0);
+
 #endif
@@ -12,6 +12,9 @@
 #include <string>
 #include <fstream>
 #include <iomanip>
+#include <memory>
+#include <algorithm>
+#include <stdexcept>
 #include "common.h"
 #include "msaWriter.h"
 #include <set>
@@ -196,3 +199,26 @@ void MSAWriter_pfam::writeFile(ofstream& outputFile)
         outputFile << sequence.id << '\t' << sequence.sequence << endl;
     }
 }
+
+void writeMSA(const vector<Sequence>& sequences, const string& file, const string& format)
+{
+    unique_ptr<MSAWriter> msaWriter;
+    if (format == "a2m")
+        msaWriter = make_unique<MSAWriter_a2m>(sequences, file);
+    else if (format == "a3m")
+        msaWriter = make_unique<MSAWriter_a3m>(sequences, file);
+    else if (find(FASTA_FORMATS.begin(), FASTA_FORMATS.end(), format) != FASTA_FORMATS.end())
+        msaWriter = make_unique<MSAWriter_fasta>(sequences, file);
+    else if (format == "sto")
+        msaWriter = make_unique<MSAWriter_sto>(sequences, file);
+    else if (format == "clustal")
+        msaWriter = make_unique<MSAWriter_clustal>(sequences, file);
+    else if (format == "aln")
+        msaWriter = make_unique<MSAWriter_aln>(sequences, file);
+    else if (format == "pfam")
+        msaWriter = make_unique<MSAWriter_pfam>(sequences, file);
+    else
+        throw runtime_error("Unsupported format '" + format + "' of the output file '" + file + "'.");
+
+    msaWriter->write();
+}
@@ -39,6 +39,8 @@ class MSAWriter
         /// @param file
         MSAWriter(std::vector<Sequence> sequences, std::string file);
 
+        virtual ~MSAWriter() = default;
+
          /**
          * @brief Write sequences in the MSA file, based on the format of the output file.
          * @param file The output file path to write to.
@@ -109,4 +111,10 @@ class MSAWriter_pfam : public MSAWriter
         void writeFile(std::ofstream& file) override;
 };
 
+/// @brief Write sequences in an MSA file with the writer of the given format
+/// @param sequences 
+/// @param file 
+/// @param format one of VALID_FORMATS
+void writeMSA(const std::vector<Sequence>& sequences, const std::string& file, const std::string& format);
+
 #endif
@@ -11,7 +11,7 @@
  *   ./neff --file=<input_file> [options]
  *
  * Options:
- *   --file=<input_file>               Input files (comma-separated, no spaces) containing multiple sequence alignments (required)\n"
+ *   --file=<input_file>               Input files (comma-separated, no spaces) containing multiple sequence alignments (required, unless --combine_states, --merge, --distances, --serve or --manifest is given)\n"
  *   --format=<input_format>           Input file formats (comma-separated, no spaces) containing formats of multiple sequence alignments (optional)\n"
  *   --alphabet=<value>                Valid alphabet of MSA; alphabet option (0: Protein, 1: RNA, 2: DNA) (default: 0)\n"
  *   --check_validation=<true/false>   Perform validation on sequences (default: false)\n"
@@ -30,6 +30,52 @@
  *   --chain_length=<list of values>   Length of the chains in heteromer multimer (default: 0)\n"
  *   --residue_neff=<true/false>       Compute per-resiue (column-wise) NEFF (default: false)
  *   --skip_lines=<value>              Number of lines to skip at the beginning of the file (default: 0)
+ *   --state_out=<file>                Persist encoded sequences and their number of homologs in a weight state file (default: empty)
+ *   --append=<file>                   Append sequences of given files to a weight state file and update it in place (default: empty)
+ *   --combine_states=<list of files>  Integrate weight state files of several MSAs, comparing only sequences of different files (default: empty)
+ *   --threads=<value>                 Number of threads used to compare pairs of sequences (default: 1)
+ *   --shard=<k>/<n>                   Compare only pairs of sequences in the k'th of n shards and write partial weights to --shard_out (default: empty)
+ *   --shard_out=<file>                File to write partial weights of the shard in (default: empty)
+ *   --merge=<list of files>           Sum partial weights of all shards and report NEFF, weights or per-residue NEFF (default: empty)
+ *   --checkpoint=<file>               Periodically write completed tiles of sequence pairs and their number of homologs in a checkpoint file (default: empty)
+ *   --checkpoint_interval=<value>     Seconds between writing two checkpoints (default: 60)
+ *   --resume=<true/false>             Continue from the tiles completed in the checkpoint file, when it exists (default: false)
+ *   --depth_curve=<list of values>    Report NEFF of the MSA prefixes at each given depth, in one pass over the pairs of sequences (default: empty)
+ *   --distances_out=<file>            Write mismatches of all pairs of sequences in a pair distances file (default: empty)
+ *   --distance_max=<value>            Number of mismatches pair distances are saturated at (default: 255)
+ *   --distances=<file>                Compute weights from a pair distances file instead of an MSA (default: empty)
+ *   --subset=<list of rows>           Rows of the pair distances to compute weights for, as values or ranges '<start>-<end>' (default: all rows)
+ *   --neighbors_out=<file>            Write the homologs of each sequence, with their number of mismatches, in a file (default: empty)
+ *   --neighbors_format=<value>        Format of the neighbors file (csr: binary compressed sparse rows, tsv) (default: csr)
+ *   --neighbors_top_k=<value>         Maximum number of the most similar homologs written for each sequence (default: inf)
+ *   --regions=<list of ranges>        Regions of the query sequence, as ranges '<start>-<end>', to report NEFF of (default: empty)
+ *   --window=<value>                  Number of columns of the window to compute local NEFF of each position with (default: empty)
+ *   --mask_frac=<value>               Fraction of columns randomly masked in each trial of column masking (default: empty)
+ *   --mask_trials=<value>             Number of trials of column masking (default: 10)
+ *   --seed=<value>                    Seed of the random generator of column masks (default: 0)
+ *   --mask_out=<file>                 Write the MSA of the trial of column masking with the highest NEFF (default: empty)
+ *   --reorder=<true/false>            Reorder columns by entropy before comparing sequences, where it scans fewer columns (default: false)
+ *   --weighting=<value>               Method of computing sequence weights (pairwise, henikoff) (default: pairwise)
+ *   --select_depth=<value>            Number of rows to select greedily maximizing NEFF, starting from the query (default: empty)
+ *   --select_out=<file>               Write the selected rows in a file instead of printing their indices (default: empty)
+ *   --profile_out=<file>              Write weighted column frequencies, entropy and log-odds scores (PSSM) in a file (default: empty)
+ *   --profile_format=<value>          Format of the profile file (bin: binary, tsv) (default: bin)
+ *   --profile_pseudocount=<value>     Weight of background frequencies added to the residue counts of each column (default: 1)
+ *   --pair_stats_out=<file>           Write weighted frequencies of columns and pairs of columns in a binary file (default: empty)
+ *   --pair_mi=<true/false>            Write mutual information of pairs of columns, with APC, in the pair statistics file (default: false)
+ *   --output_format=<value>           Format of NEFF, weights, per-residue NEFF or tables of NEFF (text, json, tsv, npy) (default: text)
+ *   --out=<file>                      Write results in a file instead of the standard output (default: empty)
+ *   --serve=<socket>                  Serve NEFF requests over a Unix domain socket until stopped (default: empty)
+ *   --serve_workers=<value>           Number of worker threads of the server (default: 4)
+ *   --serve_queue=<value>             Maximum number of connections waiting for a worker of the server (default: 64)
+ *   --serve_timeout=<value>           Seconds to receive and compute a request of the server (default: 60)
+ *   --cache_dir=<dir>                 Directory of cached numbers of homologs, reused for the same encoded MSA and parameters (default: empty)
+ *   --cache_max_size=<value>          Maximum size of the cache in megabytes; least recently used entries are removed (default: 1024)
+ *   --manifest=<file>                 Compute NEFF of each entry (input files and options) of a file, writing one line of results for each entry (default: empty)
+ *   --manifest_jobs=<value>           Number of entries of the manifest computed at the same time, sharing --threads (default: 1)
+ *
+ *   --threshold, --is_symmetric and --non_standard_option also accept lists of values (comma-separated, no spaces);
+ *   NEFF of all combinations is then reported, comparing pairs of sequences once for each encoding of sequences.
  *
  * For more comprehensive instructions, please refer to the documentation at https://maryam-haghani.github.io/NEFFy.
  */
@@ -57,7 +103,7 @@ Usage:
 Options:
   --file=<input_file>
       Input file(s) containing the MSA(s). Multiple files can be specified as a comma-separated list (without spaces).
-      (Required)
+      (Required, unless --combine_states, --merge, --distances, --serve or --manifest is given)
 
   --format=<input_format>
       Format(s) of the input file(s) (comma-separated, no spaces).
@@ -137,6 +183,268 @@ Options:
       Number of lines to skip at the beginning of the input file(s).
       (Default: 0)
 
+  --state_out=<file>
+      Writes the encoded sequences, a digest of each sequence as read (to find duplicate sequences) and the number of
+      homologs of each sequence to a binary weight state file, to be extended later by --append. Requires --gap_cutoff=1.
+      (Default: empty)
+
+  --append=<file>
+      Appends the sequences of the input file(s) that are not already in the given weight state file, comparing only
+      the new sequences against all sequences, and reports NEFF of the extended MSA. The state file is updated in place
+      (or written to --state_out, if given). The input MSA should be aligned to the same query sequence and be computed
+      with the same parameters as the state. Requires --gap_cutoff=1 and --depth=inf.
+      (Default: empty)
+
+  --combine_states=<list of files>
+      Integrates weight state files (comma-separated, no spaces) written by --state_out for each MSA, in the given order,
+      removing redundant sequences as done for multiple input files. Only sequences of different files are compared.
+      Reports NEFF after integrating each file and the marginal NEFF contributed by it. Parameters of the states are used
+      instead of the similarity flags; --file, --append, --multimer_MSA and --depth should not be given.
+      (Default: empty)
+
+  --threads=<value>
+      Number of threads used to compare pairs of sequences.
+      (Default: 1)
+
+  --shard=<k>/<n>
+      Splits the pairs of sequences into n shards, by deterministically assigning row tiles of the triangle of sequence
+      pairs to shards with balanced number of pairs, and compares only the pairs of the k'th shard (1 <= k <= n).
+      Partial weights of the shard are written to --shard_out, to be summed by --merge.
+      (Default: empty)
+
+  --shard_out=<file>
+      Binary file to write partial weights of the shard in. Required when --shard is given.
+      (Default: empty)
+
+  --merge=<list of files>
+      Sums partial weights of all shards (comma-separated, no spaces) and reports NEFF, or sequence weights when
+      --only_weights=true. To compute per-residue NEFF, --file and the flags used for the shards should also be given;
+      when --file is given, shards are checked to be computed for the same MSA and parameters.
+      (Default: empty)
+
+  --checkpoint=<file>
+      Binary file to periodically write the row tiles of the triangle of sequence pairs that are completely compared,
+      and the number of homologs found within them, in. The file is replaced atomically, without stopping the threads
+      comparing pairs of sequences.
+      (Default: empty)
+
+  --checkpoint_interval=<value>
+      Seconds between writing two checkpoints.
+      (Default: 60)
+
+  --resume=<true/false>
+      Continues from the tiles completed in the checkpoint file, when it exists, after checking that it is computed for
+      the same MSA and parameters.
+      (Default: false)
+
+  --depth_curve=<list of values>
+      Reports NEFF of the MSA limited to each given depth (comma-separated, no spaces), as --depth would, in one pass
+      over the pairs of sequences. Requires --gap_cutoff=1.
+      (Default: empty)
+
+  --distances_out=<file>
+      Writes the number of mismatches of all pairs of sequences (upper triangle), saturated at --distance_max, in a
+      binary file, to compute weights later with --distances without comparing sequences. The file is memory-mapped
+      when queried.
+      (Default: empty)
+
+  --distance_max=<value>
+      Number of mismatches pair distances are saturated at; values up to 255 are stored in 1 byte, otherwise in 2 bytes
+      (at most 65535). Thresholds whose similarity cutoff is not below this value cannot be queried.
+      (Default: 255)
+
+  --distances=<file>
+      Computes weights and NEFF from a pair distances file written by --distances_out, instead of an MSA, at the given
+      --threshold, for the first --depth rows and/or rows in --subset. The is_symmetric and non_standard_option of the
+      file are used; if they are given, they should be the same as the ones of the file. Only --threshold, --depth,
+      --subset, --norm and --only_weights can be given along with it.
+      (Default: empty)
+
+  --subset=<list of rows>
+      Rows (1-based, comma-separated, no spaces) of the pair distances to compute weights for, as values or ranges
+      '<start>-<end>' (inclusive); only pairs of the given rows are considered.
+      (Default: all rows)
+
+  --neighbors_out=<file>
+      Writes the homolog graph found while computing weights: the homologs of each sequence (excluding itself) with
+      their number of mismatches. In the asymmetric version, a sequence is written as a neighbor of another one when
+      it is a homolog of that sequence.
+      (Default: empty)
+
+  --neighbors_format=<value>
+      Format of the neighbors file:
+        csr : binary compressed sparse rows (row offsets, neighbors and mismatches) (default)
+        tsv : one line for each neighbor as 'row, neighbor, mismatches' (1-based rows)
+
+  --neighbors_top_k=<value>
+      Maximum number of neighbors written for each sequence, keeping the ones with the least mismatches; neighbors are
+      then ordered by mismatches instead of index. Sequence weights still count all homologs.
+      (Default: inf)
+
+  --regions=<list of ranges>
+      Regions of the query sequence (comma-separated ranges '<start>-<end>', no spaces, 1-based and inclusive, as
+      'pos_start' and 'pos_end') to report NEFF of, comparing pairs of sequences once for all regions.
+      (Default: empty)
+
+  --window=<value>
+      Number of columns (after removing gappy positions) of the window centered on each position to compute sequence
+      weights with; local NEFF of all positions is reported, as with 'residue_neff'.
+      (Default: empty)
+
+  --mask_frac=<value>
+      Fraction of columns (after removing gappy positions) randomly masked in each trial of column masking; NEFF of all
+      trials is reported, comparing pairs of sequences once for all trials.
+      (Default: empty)
+
+  --mask_trials=<value>
+      Number of trials of column masking.
+      (Default: 10)
+
+  --seed=<value>
+      Seed of the random generator of column masks, to reproduce the trials.
+      (Default: 0)
+
+  --mask_out=<file>
+      File to write the MSA of the trial with the highest NEFF in, without its masked columns (format is inferred from
+      the file extension).
+      (Default: empty)
+
+  --reorder=<true/false>
+      If true, columns are reordered by decreasing entropy before comparing pairs of sequences, so that mismatches of
+      dissimilar pairs reach the cutoff within the first columns. Columns are only reordered when pairs are compared
+      column by column (not by the sparse rows of local hits or the block dictionary of redundant MSAs, which are
+      faster) and the sampled number of columns scanned per pair drops by at least a quarter; otherwise weights are
+      computed as without it. Results are the same; the sampled numbers of scanned columns and whether columns are
+      reordered are reported in the standard error.
+      (Default: false)
+
+  --weighting=<value>
+      Method of computing sequence weights:
+        pairwise : inverse of the number of homologs of each sequence, comparing all pairs of sequences (default)
+        henikoff : Henikoff position-based weights, from the number of each residue in each column in O(N*L);
+                   NEFF is the effective count of sequences (sum of weights)^2 / (sum of squared weights).
+                   Similarity flags ('threshold' and 'is_symmetric') are not used.
+
+  --select_depth=<value>
+      Number of rows to select, starting from the query (first) sequence, by greedily adding the row that increases
+      NEFF of the selected rows the most (instead of the first rows, as --depth does). Gains are updated lazily, so
+      most rows are only compared with a part of the selected rows. NEFF of the selected rows is reported.
+      (Default: empty)
+
+  --select_out=<file>
+      File to write the selected rows in (format is inferred from the file extension); if not given, indices of the
+      selected rows (1-based, in the order of selection) are printed.
+      (Default: empty)
+
+  --profile_out=<file>
+      File to write the profile of the MSA (after removing gappy positions) in, computed with the sequence weights of
+      the run: for each column, the frequencies of the gap and standard letters weighted by sequence weights
+      (non-standard letters are counted with gaps), the entropy (bits) of standard letters and their log-odds scores
+      (bits) against background frequencies (BLOSUM62 for proteins, uniform for nucleotides), with pseudocounts.
+      (Default: empty)
+
+  --profile_format=<value>
+      Format of the profile file:
+        bin : binary; frequencies, entropy and scores as float32 arrays (default)
+        tsv : one line for each column as 'position, frequencies, entropy, scores' (1-based positions)
+
+  --profile_pseudocount=<value>
+      Weight of background frequencies added to the weighted residue counts of each column to compute log-odds scores.
+      (Default: 1)
+
+  --pair_stats_out=<file>
+      File to write the statistics of columns and pairs of columns of the MSA (after removing gappy positions) in, as
+      the inputs of coevolution methods, computed with the sequence weights of the run: frequencies f_i(a) and f_ij(a,b)
+      of the gap and standard letters weighted by sequence weights (non-standard letters are counted with gaps). The
+      binary file has a 64-byte header followed by float32 arrays, so that they can be memory-mapped.
+      (Default: empty)
+
+  --pair_mi=<true/false>
+      If true, the mutual information of all pairs of columns, with average product correction (APC), is also written
+      in the pair statistics file.
+      (Default: false)
+
+  --output_format=<value>
+      Format of the results (NEFF, sequence weights with --only_weights or per-residue NEFF with --residue_neff):
+        text : human-readable lines (default)
+        json : one object with the length and depth of the MSA and the results
+        tsv  : one line for each value or list of values, as '<name>, <values>' (tab-separated)
+        npy  : .npy array of float32 (weights, per-residue NEFF or NEFF as one value), loadable without parsing; requires --out
+      NEFF of --depth_curve, --regions, --mask_frac, lists of options, --multimer_MSA and --combine_states is written as
+      a table ('depth_curve', 'regions', 'mask_trials', 'configs', 'multimer' or 'states'), with a row of NEFF for each
+      depth, region, trial, setting, MSA or state file (npy: the NEFF column); local NEFF of --window is written as
+      'local_neff'. Results of --shard
+      are only reported as text, as they are written in --shard_out.
+      Values are written with the shortest representation that is read back as the same float.
+
+  --out=<file>
+      File to write the results in, in --output_format (instead of the standard output); the file is replaced atomically.
+      (Default: empty)
+
+  --serve=<socket>
+      Runs a server on the given Unix domain socket until SIGINT or SIGTERM, so that many MSAs are computed without
+      starting a process for each one. Each request and response is a 4-byte little-endian length followed by that many
+      bytes. A request has one '--<flag>=<value>' on each line: file, format, alphabet, check_validation, threshold, norm,
+      omit_query_gaps, is_symmetric, non_standard_option, depth, gap_cutoff, pos_start, pos_end, only_weights,
+      residue_neff, skip_lines and output_format (json (default), tsv or npy); instead of 'file', the MSA can follow the
+      flags after an empty line (with 'format'). The response is the result in output_format, or '{"error": "<message>"}'.
+      A request with '--command=stats' is answered with statistics of the server in the OpenMetrics text format.
+      --threads is the number of threads of each request; only --threads, --cache_dir, --cache_max_size and the serve_*
+      flags can be given with it.
+      (Default: empty)
+
+  --serve_workers=<value>
+      Number of worker threads of the server; each serves one connection at a time.
+      (Default: 4)
+
+  --serve_queue=<value>
+      Maximum number of accepted connections waiting for a worker; other connections are answered with an error
+      before their request is read, so clients should read the answer when sending the request fails.
+      (Default: 64)
+
+  --serve_timeout=<value>
+      Seconds to receive a request and compute its result, after which the request fails; the time is checked after
+      reading and encoding the MSA and while comparing sequences. Idle connections are closed after the same time.
+      (Default: 60)
+
+  --cache_dir=<dir>
+      Directory of the result cache. The number of homologs of each sequence is stored in the directory, addressed by
+      a hash of the encoded MSA (after omitting query gaps, depth, positions and gap_cutoff) and of threshold,
+      is_symmetric, the number of standard letters of the alphabet and non_standard_option; entries also keep these
+      parameters and a second hash of the MSA, which are verified when they are read. Later runs on the same MSA and
+      parameters read NEFF, weights and per-residue NEFF (of any norm) from it without comparing sequences. The
+      directory can be shared by concurrent processes. Only plain computations of NEFF, weights or per-residue NEFF
+      (with state_out, profile_out, pair_stats_out and output_format) and requests of --serve use the cache.
+      (Default: empty)
+
+  --cache_max_size=<value>
+      Maximum total size of the entries of the cache in megabytes; the least recently used entries are removed when
+      it is exceeded.
+      (Default: 1024)
+
+  --manifest=<file>
+      Computes NEFF of many MSAs in one run. Each line of the file is an entry: input file(s) of one MSA (comma-separated,
+      no spaces, integrated as with --file), optionally followed by '--<flag>=<value>' options of the entry separated by
+      spaces (format, alphabet, check_validation, threshold, norm, omit_query_gaps, is_symmetric, non_standard_option,
+      depth, gap_cutoff, pos_start, pos_end, only_weights, residue_neff and skip_lines); other options of the entries
+      are the ones given to neff. Empty lines and lines starting with '#' are skipped. One line of results is written
+      for each entry, in the order of the manifest as soon as the previous entries are written, in --out (or the
+      standard output) as TSV, or as JSON Lines with --output_format=json. Failures of an entry (e.g. a missing file) are written in its line, with the status
+      'error', and the other entries are still computed. Only --threads, --cache_dir, --cache_max_size, --out,
+      --output_format and the options of the entries can be given with it.
+      (Default: empty)
+
+  --manifest_jobs=<value>
+      Number of entries of the manifest computed at the same time; each entry is computed with --threads divided by
+      this value threads (at least one), so that at most --threads threads compare sequences.
+      (Default: 1)
+
+  Lists of similarity options:
+      --threshold, --is_symmetric and --non_standard_option also accept lists of values (comma-separated, no spaces).
+      NEFF of every combination of the given values is reported in one row. Mismatches of each pair of sequences are
+      counted once for all combinations with the same encoding of sequences (--non_standard_option=2 encodes
+      non-standard letters as gaps, the others do not).
+
 Examples:
   Compute the NEFF for a protein MSA:
     ./neff --file=msa.a3m --alphabet=0
@@ -147,6 +455,71 @@ Examples:
   Compute per-residue NEFF:
     ./neff --file=msa.a3m --residue_neff=true
 
+  Persist a weight state and extend it with the MSA of the next search iteration:
+    ./neff --file=round1.a3m --state_out=msa.state
+    ./neff --file=round2.a3m --append=msa.state
+
+  Integrate weight states of several MSAs and report the marginal NEFF of each one:
+    ./neff --combine_states=uniref90.state,mgnify.state,bfd.state
+
+  Split the pairs of sequences between two nodes and merge the partial weights:
+    ./neff --file=msa.a3m --shard=1/2 --shard_out=shard1.bin --threads=8
+    ./neff --file=msa.a3m --shard=2/2 --shard_out=shard2.bin --threads=8
+    ./neff --merge=shard1.bin,shard2.bin
+
+  Compute NEFF on a preemptible node, continuing from the last checkpoint when restarted:
+    ./neff --file=msa.a3m --threads=8 --checkpoint=msa.ckpt --checkpoint_interval=300 --resume=true
+
+  Compute NEFF at several depths of the MSA to choose the depth of the input of a structure predictor:
+    ./neff --file=msa.a3m --depth_curve=64,128,256,512,1024,2048,4096,8192
+
+  Compute NEFF of several similarity thresholds, symmetric and asymmetric, in one run:
+    ./neff --file=msa.a3m --threshold=0.62,0.8,0.9 --is_symmetric=true,false
+
+  Store pair distances once and query NEFF of other thresholds, depths or subsets of rows:
+    ./neff --file=msa.a3m --distances_out=msa.dist
+    ./neff --distances=msa.dist --threshold=0.7 --depth=256
+    ./neff --distances=msa.dist --subset=1-100,250-300 --only_weights=true
+
+  Compute NEFF and write the 50 most similar homologs of each sequence for clustering:
+    ./neff --file=msa.a3m --neighbors_out=msa.nbrs --neighbors_top_k=50
+
+  Compute NEFF of several domains of the query sequence:
+    ./neff --file=msa.a3m --regions=1-120,121-340
+
+  Compute local NEFF of each position with sequence weights of a window of 32 columns:
+    ./neff --file=msa.a3m --window=32
+
+  Compute NEFF of 10 trials of masking 20% of columns and write the MSA with the highest NEFF:
+    ./neff --file=msa.a3m --threshold=0.6 --mask_frac=0.2 --mask_trials=10 --mask_out=best.fasta
+
+  Reorder columns before comparing pairs of sequences:
+    ./neff --file=msa.a3m --is_symmetric=false --reorder=true
+
+  Estimate NEFF of a very deep MSA in linear time:
+    ./neff --file=msa.a3m --weighting=henikoff --threads=8
+
+  Select 512 rows maximizing NEFF as the input of a structure predictor:
+    ./neff --file=msa.a3m --select_depth=512 --select_out=selected.a3m
+
+  Compute NEFF and write the weighted profile and PSSM of the MSA from the same weights:
+    ./neff --file=msa.a3m --profile_out=msa_profile.tsv --profile_format=tsv
+
+  Compute NEFF and weighted pair statistics with mutual information for contact prediction:
+    ./neff --file=msa.a3m --pair_stats_out=msa_pairs.bin --pair_mi=true --threads=8
+
+  Write sequence weights as an .npy array, to be loaded with numpy.load:
+    ./neff --file=msa.a3m --only_weights=true --output_format=npy --out=weights.npy
+
+  Serve NEFF requests of a feature pipeline with 8 workers of 2 threads:
+    ./neff --serve=/tmp/neff.sock --serve_workers=8 --threads=2
+
+  Reuse NEFF of MSAs computed by earlier runs of a pipeline:
+    ./neff --file=msa.a3m --cache_dir=neff_cache --cache_max_size=4096
+
+  Compute NEFF of all MSAs listed in a manifest, 4 at a time with 2 threads each:
+    ./neff --manifest=msas.txt --manifest_jobs=4 --threads=8 --output_format=json --out=neffs.jsonl
+
   For more comprehensive instructions, please refer to the documentation at https://maryam-haghani.github.io/NEFFy.
 )";
 
@@ -154,6 +527,17 @@ Examples:
 #include "msaReader.h"
 #include "msaWriter.h"
 #include "multimerHandler.h"
+#include "neffCalculator.h"
+#include "weightState.h"
+#include "partialWeights.h"
+#include "checkpoint.h"
+#include "distanceStore.h"
+#include "neighborGraph.h"
+#include "profile.h"
+#include "pairStatistics.h"
+#include "resultWriter.h"
+#include "neffServer.h"
+#include "resultCache.h"
 #include <iostream>
 #include <vector>
 #include <string>
@@ -165,6 +549,7 @@ Examples:
 #include <cmath>
 #include <fstream>
 #include <algorithm>
+#include <numeric>
 #include <tuple>
 #include <random>
 #include <fstream>
@@ -172,14 +557,16 @@ Examples:
 #include <thread>
 #include <future>
 #include <mutex>
+#include <condition_variable>
+#include <atomic>
 #include <chrono>
 #include <iostream>
 
 using namespace std;
 
-unordered_map<string, FlagInfo> Flags =
+static unordered_map<string, FlagInfo> Flags =
 {
-    {"file", {true, ""}},                   // Input files (comma-separated, no spaces) containing multiple sequence alignments
+    {"file", {false, ""}},                  // Input files (comma-separated, no spaces) containing multiple sequence alignments (required, unless 'combine_states', 'merge', 'distances', 'serve' or 'manifest' is given)
     {"format", {false, ""}},                // Input file formats (comma-separated, no spaces) containing formats of multiple sequence alignments
     {"alphabet", {false, "0"}},             // Alphabet of MSA
     {"check_validation", {false, "false"}}, // Perform validation on sequences to include only alphabet letters
@@ -197,316 +584,304 @@ unordered_map<string, FlagInfo> Flags =
     {"stoichiom", {false, ""}},             // Multimer stoichiometry
     {"chain_length", {false, "0"}},         // Length of the chains in heteromer multimer
     {"residue_neff", {false, "false"}},     // Compute per-resiue (column-wise) NEFF
-    {"skip_lines", {false, "0"}}            // Number of lines to skip at the beginning of the file
+    {"skip_lines", {false, "0"}},           // Number of lines to skip at the beginning of the file
+    {"state_out", {false, ""}},             // File to persist encoded sequences and their number of homologs in
+    {"append", {false, ""}},                // Weight state file to append sequences of given files to
+    {"combine_states", {false, ""}},        // Weight state files (comma-separated, no spaces) to integrate
+    {"threads", {false, "1"}},              // Number of threads used to compare pairs of sequences
+    {"shard", {false, ""}},                 // Shard of the pairs of sequences to compare, as <k>/<n>
+    {"shard_out", {false, ""}},             // File to write partial weights of the shard in
+    {"merge", {false, ""}},                 // Partial weights files (comma-separated, no spaces) of all shards to merge
+    {"checkpoint", {false, ""}},            // File to periodically write completed tiles and their number of homologs in
+    {"checkpoint_interval", {false, "60"}}, // Seconds between writing two checkpoints
+    {"resume", {false, "false"}},           // Continue from the tiles completed in the checkpoint file
+    {"depth_curve", {false, ""}},           // Depths (comma-separated, no spaces) to report NEFF of the MSA prefixes at
+    {"distances_out", {false, ""}},         // File to write mismatches of all pairs of sequences in
+    {"distance_max", {false, "255"}},       // Number of mismatches pair distances are saturated at
+    {"distances", {false, ""}},             // Pair distances file to compute weights from, instead of an MSA
+    {"subset", {false, ""}},                // Rows (comma-separated, no spaces) of the pair distances to compute weights for
+    {"neighbors_out", {false, ""}},         // File to write the homologs of each sequence in
+    {"neighbors_format", {false, "csr"}},   // Format of the neighbors file (csr or tsv)
+    {"neighbors_top_k", {false, "inf"}},    // Maximum number of the most similar homologs written for each sequence
+    {"regions", {false, ""}},               // Regions (comma-separated, no spaces) of the query sequence to report NEFF of
+    {"window", {false, ""}},                // Number of columns of the window to compute local NEFF of each position with
+    {"mask_frac", {false, ""}},             // Fraction of columns randomly masked in each trial of column masking
+    {"mask_trials", {false, "10"}},         // Number of trials of column masking
+    {"seed", {false, "0"}},                 // Seed of the random generator of column masks
+    {"mask_out", {false, ""}},              // File to write the MSA of the trial of column masking with the highest NEFF in
+    {"reorder", {false, "false"}},          // Reorder columns by entropy before comparing pairs of sequences, where it scans fewer columns
+    {"weighting", {false, "pairwise"}},     // Method of computing sequence weights (pairwise, henikoff)
+    {"select_depth", {false, ""}},          // Number of rows to select maximizing NEFF
+    {"select_out", {false, ""}},            // File to write the selected rows in
+    {"profile_out", {false, ""}},           // File to write the weighted profile (frequencies, entropy and PSSM) in
+    {"profile_format", {false, "bin"}},     // Format of the profile file (bin or tsv)
+    {"profile_pseudocount", {false, "1"}},  // Weight of background frequencies added to the residue counts of each column
+    {"pair_stats_out", {false, ""}},        // File to write weighted frequencies of columns and pairs of columns in
+    {"pair_mi", {false, "false"}},          // Write mutual information of pairs of columns, with APC, in the pair statistics file
+    {"output_format", {false, "text"}},     // Format of NEFF, weights, per-residue NEFF or tables of NEFF (text, json, tsv or npy)
+    {"out", {false, ""}},                   // File to write results in, instead of the standard output
+    {"serve", {false, ""}},                 // Unix domain socket to serve NEFF requests on
+    {"serve_workers", {false, "4"}},        // Number of worker threads of the server
+    {"serve_queue", {false, "64"}},         // Maximum number of connections waiting for a worker of the server
+    {"serve_timeout", {false, "60"}},       // Seconds to receive and compute a request of the server
+    {"cache_dir", {false, ""}},             // Directory of cached numbers of homologs of computed MSAs
+    {"cache_max_size", {false, "1024"}},    // Maximum size of the cache in megabytes
+    {"manifest", {false, ""}},              // File of MSAs to compute, one entry of input file(s) and options on each line
+    {"manifest_jobs", {false, "1"}}         // Number of entries of the manifest computed at the same time
 };
 
-/// @brief Map char residues to digit based on given 'nonStandardOption'
-/// @param c input letter
-/// @param standardLetters 
-/// @param nonStandardLetters 
-/// @param nonStandardOption 
-/// @return 
-int char2num(char c, const string& standardLetters, const string& nonStandardLetters, NonStandardHandler nonStandardOption)
+// Flags of the requests of the server (with the defaults of the command line, output_format: json)
+// and of the entries of a manifest
+static const vector<string> REQUEST_FLAGS = {"file", "format", "alphabet", "check_validation", "threshold", "norm",
+                                             "omit_query_gaps", "is_symmetric", "non_standard_option", "depth", "gap_cutoff",
+                                             "pos_start", "pos_end", "only_weights", "residue_neff", "skip_lines"};
+
+// Modes of computing NEFF and options changing them from their defaults; each mode lists the modes above it that can be
+// given along with it, and any other pair of given modes is refused
+struct FlagMode
+{
+    string name;                // flag, or 'lists' of values of the similarity options
+    vector<string> compatible;
+};
+
+static const vector<FlagMode> FLAG_MODES =
 {
-    int position;
-    int standardLetterSize = standardLetters.size();
+    {"file", {}},
+    {"depth", {"file"}},
+    {"gap_cutoff", {"file", "depth"}},
+    {"pos_start", {"file", "depth", "gap_cutoff"}},
+    {"pos_end", {"file", "depth", "gap_cutoff", "pos_start"}},
+    {"omit_query_gaps", {"file", "depth", "gap_cutoff", "pos_start", "pos_end"}},
+    {"only_weights", {"file", "depth", "gap_cutoff", "pos_start", "pos_end", "omit_query_gaps"}},
+    {"residue_neff", {"file", "depth", "gap_cutoff", "pos_start", "pos_end", "omit_query_gaps"}},
+    {"multimer_MSA", {"file", "depth"}},
+    {"state_out", {"file", "depth", "pos_start", "pos_end", "omit_query_gaps", "only_weights", "residue_neff"}},
+    {"append", {"file", "pos_start", "pos_end", "omit_query_gaps", "only_weights", "residue_neff", "state_out"}},
+    {"combine_states", {"gap_cutoff", "pos_start", "pos_end", "omit_query_gaps", "only_weights", "residue_neff",
+                        "state_out"}},
+    {"shard", {"file", "depth", "gap_cutoff", "pos_start", "pos_end", "omit_query_gaps"}},
+    {"merge", {"file", "depth", "gap_cutoff", "pos_start", "pos_end", "omit_query_gaps", "only_weights", "residue_neff"}},
+    {"checkpoint", {"file", "depth", "gap_cutoff", "pos_start", "pos_end", "omit_query_gaps", "only_weights",
+                    "residue_neff", "state_out"}},
+    {"depth_curve", {"file", "depth", "pos_start", "pos_end", "omit_query_gaps"}},
+    {"lists", {"file", "depth", "gap_cutoff", "pos_start", "pos_end", "omit_query_gaps"}},
+    {"distances_out", {"file", "depth", "gap_cutoff", "pos_start", "pos_end", "omit_query_gaps", "only_weights",
+                       "residue_neff", "state_out"}},
+    {"distances", {"depth", "only_weights"}},
+    {"neighbors_out", {"file", "depth", "gap_cutoff", "pos_start", "pos_end", "omit_query_gaps", "only_weights",
+                       "residue_neff", "state_out"}},
+    {"regions", {"file", "depth", "gap_cutoff", "omit_query_gaps"}},
+    {"window", {"file", "depth", "gap_cutoff", "pos_start", "pos_end", "omit_query_gaps"}},
+    {"mask_frac", {"file", "depth", "gap_cutoff", "pos_start", "pos_end", "omit_query_gaps"}},
+    {"reorder", {"file", "depth", "gap_cutoff", "pos_start", "pos_end", "omit_query_gaps", "only_weights", "residue_neff",
+                 "state_out"}},
+    {"weighting", {"file", "depth", "gap_cutoff", "pos_start", "pos_end", "omit_query_gaps", "only_weights",
+                   "residue_neff"}},
+    {"select_depth", {"file", "depth", "gap_cutoff", "pos_start", "pos_end", "omit_query_gaps", "only_weights",
+                      "residue_neff"}},
+    {"profile_out", {"file", "depth", "gap_cutoff", "pos_start", "pos_end", "omit_query_gaps", "only_weights",
+                     "residue_neff", "state_out", "append", "merge", "checkpoint", "distances_out", "neighbors_out",
+                     "reorder", "weighting"}},
+    {"pair_stats_out", {"file", "depth", "gap_cutoff", "pos_start", "pos_end", "omit_query_gaps", "only_weights",
+                        "residue_neff", "state_out", "append", "merge", "checkpoint", "distances_out", "neighbors_out",
+                        "reorder", "weighting", "profile_out"}},
+    {"output_format", {"file", "depth", "gap_cutoff", "pos_start", "pos_end", "omit_query_gaps", "only_weights",
+                       "residue_neff", "multimer_MSA", "state_out", "append", "combine_states", "merge", "checkpoint",
+                       "depth_curve", "lists", "distances_out", "distances", "neighbors_out", "regions", "window",
+                       "mask_frac", "reorder", "weighting", "profile_out", "pair_stats_out"}},
+    {"cache_dir", {"file", "depth", "gap_cutoff", "pos_start", "pos_end", "omit_query_gaps", "only_weights",
+                   "residue_neff", "state_out", "profile_out", "pair_stats_out", "output_format"}},
+};
 
-    position = standardLetters.find(c);
 
-    if (position != string::npos) // standard
-    {
-        return position+1;
+/// @brief Get given normalization option by user
+/// @param flagHandler 
+/// @return 
+Normalization getNormalization(FlagHandler& flagHandler)
+{
+    int intValue = flagHandler.getIntValue("norm");
+    Normalization norm = static_cast<Normalization>(intValue);
+
+    // value is within the valid range of the enum
+    if (norm < Normalization::Sqrt_L || norm > Normalization::None) {
+        throw runtime_error("Invalid 'norm' value. It is outside the valid enum range.");
     }
-    else if (nonStandardOption == AsStandard || nonStandardOption == ConsiderGapInCutoff) // behave like standard ones
+    return norm;
+}
+
+/// @brief Get given non_standard_option options by user (comma-separated, no spaces)
+/// @param flagHandler 
+/// @return 
+vector<NonStandardHandler> getNonStandardOptions(FlagHandler& flagHandler)
+{
+    vector<NonStandardHandler> nonStandardOptions;
+    for (const string& item : flagHandler.getArrayValues("non_standard_option"))
     {
-        position = nonStandardLetters.find(c);
+        size_t pos;
+        int intValue = stoi(item, &pos);
+        NonStandardHandler nonStandardOption = static_cast<NonStandardHandler>(intValue);
 
-        if (position != string::npos)
-        {
-            return position + standardLetterSize + 1; // non-standard
+        if (pos != item.length()
+            || nonStandardOption < NonStandardHandler::AsStandard || nonStandardOption > NonStandardHandler::ConsiderGap) {
+            throw runtime_error("Invalid 'non_standard_option' value. It is outside the valid enum range.");
         }
+        nonStandardOptions.push_back(nonStandardOption);
     }
-    return 0; // condier as gap
+    if (nonStandardOptions.empty()) {
+        throw runtime_error("Invalid 'non_standard_option' value. It should contain at least one value");
+    }
+    return nonStandardOptions;
 }
 
-/// @brief Remove gappy positions from sequences based on given 'gapCutoff'
-/// @param sequences 
-/// @param gapCutoff 
-void removeGappyPositions(vector<vector<int>>& sequences, float gapCutoff)
+/// @brief Get all combinations of given similarity options by user;
+/// threshold, is_symmetric and non_standard_option can be lists of values (comma-separated, no spaces)
+/// @param flagHandler 
+/// @return configurations, grouped by the encoding of sequences (non_standard_option)
+vector<SimilarityConfig> getSimilarityConfigs(FlagHandler& flagHandler)
 {
-    vector<int> querySequence = sequences[0];
-    int length = querySequence.size();
-    int depth = sequences.size();
-    int gapCutoffNo = depth * gapCutoff;
-    vector<int> removingPositions;
-    int i, j;
+    vector<SimilarityConfig> configs;
+    vector<float> thresholds = flagHandler.getFloatArrayValue("threshold");
+    vector<bool> symmetricOptions = flagHandler.getBooleanArrayValue("is_symmetric");
 
-    // find gappy positions
-    for(i = length-1; i >= 0; i--)
+    for (NonStandardHandler nonStandardOption : getNonStandardOptions(flagHandler))
     {
-        int gapCount = 0;
-        for(j = 0; j < depth; j++)
+        for (bool isSymmetric : symmetricOptions)
         {
-            if(sequences[j][i] == 0)
+            for (float threshold : thresholds)
             {
-                gapCount++;
+                configs.push_back({threshold, isSymmetric, nonStandardOption});
             }
         }
-        if(gapCount >= gapCutoffNo)
-        {
-            removingPositions.push_back(i);
-        }
-    }
-    //remove gappy positions from all sequences
-    for (auto& sequence : sequences)
-    {
-        for (int pos : removingPositions)
-        {
-            sequence.erase(sequence.begin() + pos);
-        }
     }
+    return configs;
 }
 
-/// @brief Map chars to digits based on provided 'nonStandardOption' and also remove gappy positions based on given 'gapCutoff'
-/// @param omitGapsInQuery 
-/// @param alphabet 
-/// @param nonStandardOption 
-/// @param gapCutoff 
+/// @brief Check whether more than one value is given for any of the similarity options
+/// @param flagHandler 
 /// @return 
-vector<vector<int>> processSequences(vector<Sequence> sequences, string standardLetters,
-                                    string nonStandardLetters, NonStandardHandler nonStandardOption, float gapCutoff)
+bool hasMultipleConfigs(FlagHandler& flagHandler)
 {
-    vector<vector<int>> sequences2num;
-    if(sequences.size() == 0)
-    {
-        return sequences2num;
-    }
-
-    string querySequence = sequences[0].sequence;
-
-
-    // map letters to numbers
-    vector<int> sequence2num;
-    int length = querySequence.length();
+    return flagHandler.getArrayValues("threshold").size() > 1 || flagHandler.getArrayValues("is_symmetric").size() > 1
+           || flagHandler.getArrayValues("non_standard_option").size() > 1;
+}
 
-    for (auto sequence : sequences)
+/// @brief Check whether a mode of FLAG_MODES is given, i.e. its flag is changed from the default
+/// @param flagHandler 
+/// @param name 
+/// @return 
+bool isModeGiven(FlagHandler& flagHandler, const string& name)
+{
+    if (name == "lists")
     {
-        sequence2num = {};
-        for (int position = 0; position < length; position++)
-        {
-            sequence2num.push_back(char2num(sequence.sequence[position], standardLetters,
-                                            nonStandardLetters, nonStandardOption));
-        }
-        sequences2num.push_back(sequence2num);            
+        return hasMultipleConfigs(flagHandler);
     }
-
-    if(gapCutoff < 1)
+    string defaultValue = Flags.at(name).value;
+    if (defaultValue == "true" || defaultValue == "false")
     {
-        removeGappyPositions(sequences2num, gapCutoff);
+        // throws if the value is not a boolean
+        return flagHandler.getBooleanValue(name) != (defaultValue == "true");
     }
-
-    return sequences2num;
+    return flagHandler.getFlagValue(name) != defaultValue;
 }
 
-/// @brief Compute sequence weights based on given options
-/// @param sequences 
-/// @param threshold 
-/// @param norm 
-/// @param isSymmetric 
-/// @param nonStandardOption 
-/// @return inverse of sequence weights
-vector<int> computeWeights(vector<vector<int>> sequences, float threshold, bool isSymmetric,
-                     string standardLetters, NonStandardHandler nonStandardOption)
+/// @brief Get the description of a mode of FLAG_MODES in error messages
+/// @param name 
+/// @return 
+string getModeDescription(const string& name)
 {
-    int msa_depth = sequences.size();
-
-    if(msa_depth == 0)
-    {
-        cerr << "There is no sequence to compute weights for." << endl;
-        exit(0);
-    }
-
-    vector<int> querySequence = sequences[0];
-    int length = querySequence.size();
-
-    int position, i, j; // loop indexes    
-    int non_gap_count;
-    vector <bool> non_gap_seq; // keeps positions of residues in a sequence
-    vector<vector<bool>> non_gap_msa; // keeps positions of non-gap residues in all sequences
-    vector<int> cutoff; // keeps max num of mismatches for a sequence to be considered homolog
-    non_gap_seq.assign(length, 0);
+    return name == "lists" ? "lists of values of 'threshold', 'is_symmetric' or 'non_standard_option'" : "'" + name + "'";
+}
 
-    // computeing cutoff for each sequence
-    // and keeping non-gap positions in non_gap_msa for asymmetric option
-    if (isSymmetric)
-    {
-        cutoff.push_back(length * (1-threshold));
-    }
-    else
+/// @brief Check flags     
+/// @param flagHandler 
+void checkFlags(FlagHandler& flagHandler)
+{
+    string serve = flagHandler.getFlagValue("serve");
+    if (!serve.empty())
     {
-        for (auto sequence : sequences)
+        // MSAs and their options are given by requests
+        for (const auto& flag : Flags)
         {
-            non_gap_count = 0;
-            // finding non-gap positions of the sequence
-            for (position = 0; position < length; position++)
-            {                
-                if ((nonStandardOption ==  ConsiderGapInCutoff && (sequence[position] == 0 || sequence[position] > standardLetters.size()))
-                    || (nonStandardOption != ConsiderGap && sequence[position] == 0))
-                {
-                    non_gap_seq[position] = 0;
-                }                
-                else
-                {
-                    non_gap_count++;
-                    non_gap_seq[position] = 1;
-                }
+            if (flag.first != "threads" && flag.first.rfind("serve", 0) != 0 && flag.first.rfind("cache", 0) != 0
+                && flagHandler.getFlagValue(flag.first) != flag.second.value)
+            {
+                throw runtime_error("When 'serve' is given, only 'threads', 'cache_dir', 'cache_max_size', 'serve_workers', "
+                                    "'serve_queue' and 'serve_timeout' can be given; other options are given by requests.");
             }
-            non_gap_msa.push_back(non_gap_seq);
-            cutoff.push_back(non_gap_count * (1-threshold));
         }
-    }    
-    non_gap_seq.clear();
-
-    int mismatch_i = 0, mismatch_j = 0; // # mismatches in i'th and j'th sequences
-    vector<int> sequence_weight(msa_depth, 1); // number of homolog sequences to each sequence
+        return;
+    }
 
-    // iterate through each pair of sequence and compute sequence weights
-    for (i = 0; i < msa_depth; i++)
+    if (!flagHandler.getFlagValue("manifest").empty())
     {
-        for (j = i+1; j < msa_depth; j++)
+        // MSAs are given by the entries of the manifest, and the flags of the entries are their default options
+        for (const auto& flag : Flags)
         {
-            mismatch_i = mismatch_j = 0;
-            for (position = 0; position < length; position++)
+            if (flag.first != "threads" && flag.first != "out" && flag.first != "output_format"
+                && flag.first.rfind("manifest", 0) != 0 && flag.first.rfind("cache", 0) != 0
+                && (flag.first == "file" || find(REQUEST_FLAGS.begin(), REQUEST_FLAGS.end(), flag.first) == REQUEST_FLAGS.end())
+                && flagHandler.getFlagValue(flag.first) != flag.second.value)
             {
-                if (sequences[i][position] == sequences[j][position]) // position match
-                {
-                    continue;
-                }
-                if (isSymmetric) 
-                {
-                    // increment both sequences when there is a position mismatch                    
-                    mismatch_i++;
-                    mismatch_j++;
-                    if (mismatch_i > cutoff[0])
-                    {
-                        // no need to iterate more when already found cutoff mismatches this pair 
-                        break;
-                    }
-                }
-                else //asymmetric
-                {
-                    mismatch_i += non_gap_msa[i][position]; // increment mismatches if this position is non-gap
-                    mismatch_j += non_gap_msa[j][position];
-                    
-                    if ((mismatch_i > cutoff[i]) && (mismatch_j > cutoff[j]))
-                    {
-                        // no need to iterate more when found unsimilarity threshhold for this pair
-                        break;
-                    }
-                }
-            }
-            if(isSymmetric)
-            {
-                sequence_weight[i] += (mismatch_i <= cutoff[0]);
-                sequence_weight[j] += (mismatch_j <= cutoff[0]);
-            }
-            else
-            {
-                sequence_weight[i] += (mismatch_i <= cutoff[i]);
-                sequence_weight[j] += (mismatch_j <= cutoff[j]);
+                throw runtime_error("When 'manifest' is given, only 'threads', 'cache_dir', 'cache_max_size', 'out', "
+                                    "'output_format', 'manifest_jobs' and the options of the entries can be given.");
             }
         }
+        string outputFormat = flagHandler.getFlagValue("output_format");
+        if (outputFormat != "text" && outputFormat != "tsv" && outputFormat != "json")
+        {
+            throw runtime_error("When 'manifest' is given, 'output_format' should be 'tsv' or 'json'.");
+        }
+        // throws if the values are not positive numbers
+        flagHandler.getNonZeroIntValue("manifest_jobs");
+        if (!flagHandler.getFlagValue("cache_dir").empty())
+        {
+            flagHandler.getNonZeroIntValue("cache_max_size");
+        }
+        return;
     }
 
-    return sequence_weight;
-}
-
-/// @brief Cumpote NEFF values based on sequence weights and given normalization
-/// @param sequenceWeights 
-/// @param norm 
-/// @param sequenceLength 
-/// @return 
-float computeNeff(vector<int> sequenceWeights, Normalization norm, int length)
-{
-    float neff = 0;
-    for (int i=0; i < sequenceWeights.size(); i++)
+    // file is required, unless NEFF is computed from weight states, partial weights or stored distances
+    string merge = flagHandler.getFlagValue("merge");
+    if (flagHandler.getFlagValue("file").empty()
+        && (flagHandler.getFlagValue("combine_states").empty() && (merge.empty() || flagHandler.getBooleanValue("residue_neff"))
+            && flagHandler.getFlagValue("distances").empty()))
     {
-        neff += 1./sequenceWeights[i];
+        throw runtime_error("Missing value for required flag: file");
     }
-    
-    switch(norm) // normalizing Nf
+
+    // values of the modes
+    string weighting = flagHandler.getFlagValue("weighting");
+    if (weighting != "pairwise" && weighting != "henikoff")
     {
-        case Sqrt_L:
-            neff = neff/sqrt(length);
-            break;
-        case L:
-            neff = neff/length;
-            break;
-        default:
-            break;
+        throw runtime_error("Invalid 'weighting' value. It should be either 'pairwise' or 'henikoff'.");
     }
-    return neff;
-}
-
-/// @brief Get given alphabet by user
-/// @param flagHandler 
-/// @return 
-Alphabet getAlphabet(FlagHandler& flagHandler)
-{
-    int intValue = flagHandler.getIntValue("alphabet");
-    Alphabet alphabet = static_cast<Alphabet>(intValue);
-
-    // value is within the valid range of the enum
-    if (alphabet < Alphabet::protein || alphabet > Alphabet::DNA) {
-        throw runtime_error("Invalid 'alphabet' value. It is outside the valid enum range.");
+    string outputFormat = flagHandler.getFlagValue("output_format");
+    if (find(OUTPUT_FORMATS.begin(), OUTPUT_FORMATS.end(), outputFormat) == OUTPUT_FORMATS.end())
+    {
+        throw runtime_error("Invalid 'output_format' value. It should be one of 'text', 'json', 'tsv' or 'npy'.");
     }
-
-    return alphabet;
-}
-
-
-/// @brief Get given normalization option by user
-/// @param flagHandler 
-/// @return 
-Normalization getNormalization(FlagHandler& flagHandler)
-{
-    int intValue = flagHandler.getIntValue("norm");
-    Normalization norm = static_cast<Normalization>(intValue);
-
-    // value is within the valid range of the enum
-    if (norm < Normalization::Sqrt_L || norm > Normalization::None) {
-        throw runtime_error("Invalid 'norm' value. It is outside the valid enum range.");
+    if (!flagHandler.getFlagValue("neighbors_out").empty())
+    {
+        string neighborsFormat = flagHandler.getFlagValue("neighbors_format");
+        if (neighborsFormat != "csr" && neighborsFormat != "tsv")
+        {
+            throw runtime_error("Invalid 'neighbors_format' value. It should be either 'csr' or 'tsv'.");
+        }
     }
-    return norm;
-}
-
-/// @brief Get given non_standard_option option by user
-/// @param flagHandler 
-/// @return 
-NonStandardHandler getNonStandardOption(FlagHandler& flagHandler)
-{
-    int intValue = flagHandler.getIntValue("non_standard_option");
-    NonStandardHandler nonStandardOption = static_cast<NonStandardHandler>(intValue);
-
-    if (nonStandardOption < NonStandardHandler::AsStandard || nonStandardOption > NonStandardHandler::ConsiderGap) {
-        throw runtime_error("Invalid 'non_standard_option' value. It is outside the valid enum range.");
+    if (!flagHandler.getFlagValue("profile_out").empty())
+    {
+        string profileFormat = flagHandler.getFlagValue("profile_format");
+        if (profileFormat != "bin" && profileFormat != "tsv")
+        {
+            throw runtime_error("Invalid 'profile_format' value. It should be either 'bin' or 'tsv'.");
+        }
+        // throws if the pseudocount is not a positive number
+        flagHandler.getPositiveFloatValue("profile_pseudocount");
     }
-    return nonStandardOption;
-}
-
-/// @brief Check flags     
-/// @param flagHandler 
-void checkFlags(FlagHandler& flagHandler)
-{
-    // Only one of only_weights, multimer_MSA, or residue_neff can be true at a time.
-    int trueCount = 0;
-    if (flagHandler.getBooleanValue("only_weights")) trueCount++;
-    if (flagHandler.getBooleanValue("multimer_MSA")) trueCount++;
-    if (flagHandler.getBooleanValue("residue_neff")) trueCount++;
-    if (trueCount > 1)
+    if (!flagHandler.getFlagValue("cache_dir").empty())
     {
-        throw runtime_error(
-            "Only one of 'only_weights', 'residue_neff', or 'multimer_MSA' can be true at a time.");
+        // throws if the size is not a positive number
+        flagHandler.getNonZeroIntValue("cache_max_size");
     }
     if (flagHandler.getBooleanValue("multimer_MSA"))
     {
@@ -540,16 +915,164 @@ void checkFlags(FlagHandler& flagHandler)
                 ("When multimer is heteromer, 'chain_length' should be a list of positive numbers");
             }
         }
-        
-        if (!((flagHandler.getBooleanValue("omit_query_gaps"))
-        && (flagHandler.getFlagValue("gap_cutoff") == "1")
-        && (flagHandler.getFlagValue("pos_start") == "1")
-        && (flagHandler.getFlagValue("pos_end") == "inf")))
+    }
+
+    // modes given together
+    for (int i = 0; i < FLAG_MODES.size(); i++)
+    {
+        if (!isModeGiven(flagHandler, FLAG_MODES[i].name))
+        {
+            continue;
+        }
+        for (int j = 0; j < i; j++)
+        {
+            const vector<string>& compatible = FLAG_MODES[i].compatible;
+            if (isModeGiven(flagHandler, FLAG_MODES[j].name)
+                && find(compatible.begin(), compatible.end(), FLAG_MODES[j].name) == compatible.end())
+            {
+                throw runtime_error("Only one of " + getModeDescription(FLAG_MODES[j].name) + " and "
+                                    + getModeDescription(FLAG_MODES[i].name) + " can be given at a time.");
+            }
+        }
+    }
+    // partial weights without an MSA have no sequences to compute the profile or pair statistics of
+    if (!merge.empty() && flagHandler.getFlagValue("file").empty()
+        && (!flagHandler.getFlagValue("profile_out").empty() || !flagHandler.getFlagValue("pair_stats_out").empty()))
+    {
+        throw runtime_error("When 'profile_out' or 'pair_stats_out' is given with 'merge', 'file' should have a value.");
+    }
+
+    // options of the modes
+    if (!flagHandler.getFlagValue("shard").empty() && flagHandler.getFlagValue("shard_out").empty())
+    {
+        throw runtime_error("When 'shard' is given, 'shard_out' should have a value.");
+    }
+    if (flagHandler.getBooleanValue("resume") && flagHandler.getFlagValue("checkpoint").empty())
+    {
+        throw runtime_error("When 'resume'=true, 'checkpoint' should have a value.");
+    }
+    if (!flagHandler.getFlagValue("mask_out").empty() && flagHandler.getFlagValue("mask_frac").empty())
+    {
+        throw runtime_error("'mask_out' can only be given with 'mask_frac'.");
+    }
+    if (!flagHandler.getFlagValue("select_out").empty() && flagHandler.getFlagValue("select_depth").empty())
+    {
+        throw runtime_error("'select_out' can only be given with 'select_depth'.");
+    }
+    if (flagHandler.getBooleanValue("pair_mi") && flagHandler.getFlagValue("pair_stats_out").empty())
+    {
+        throw runtime_error("'pair_mi' can only be given with 'pair_stats_out'.");
+    }
+    if (!flagHandler.getFlagValue("subset").empty() && flagHandler.getFlagValue("distances").empty())
+    {
+        throw runtime_error("'subset' can only be given along with 'distances'.");
+    }
+    if (outputFormat != "text")
+    {
+        if (outputFormat == "npy" && flagHandler.getFlagValue("out").empty())
+        {
+            throw runtime_error("When 'output_format' is 'npy', 'out' should have a value.");
+        }
+        // selected rows are only printed as text
+        if (!flagHandler.getFlagValue("select_depth").empty() && flagHandler.getFlagValue("select_out").empty()
+            && flagHandler.getFlagValue("out").empty())
+        {
+            throw runtime_error("When 'select_depth' is given with 'output_format', 'select_out' or 'out' should have a value.");
+        }
+    }
+    else if (!flagHandler.getFlagValue("out").empty())
+    {
+        throw runtime_error("'out' can only be given when 'output_format' is not 'text'.");
+    }
+}
+
+/// @brief Get given shard option by user, as '<k>/<n>' with 1 <= k <= n
+/// @param flagHandler 
+/// @param shard index of the shard (starting from 0)
+/// @param shardCount 
+void getShard(FlagHandler& flagHandler, int& shard, int& shardCount)
+{
+    string value = flagHandler.getFlagValue("shard");
+    size_t separator = value.find('/');
+    try
+    {
+        if (separator == string::npos)
         {
-            throw runtime_error
-            ("When 'multimer_MSA'=true, 'omit_query_gaps', 'pos_start', and 'pos_end' should remain at their default parameters.");
+            throw runtime_error("");
+        }
+        size_t pos;
+        shard = stoi(value.substr(0, separator), &pos);
+        if (pos != separator)
+        {
+            throw runtime_error("");
+        }
+        shardCount = stoi(value.substr(separator + 1), &pos);
+        if (pos != value.size() - separator - 1 || shard < 1 || shard > shardCount)
+        {
+            throw runtime_error("");
+        }
+    }
+    catch (const exception& e)
+    {
+        throw runtime_error("Invalid 'shard' value. It should be in the form of '<k>/<n>' with 1 <= k <= n.");
+    }
+    shard--;
+}
+
+/// @brief Get rows of pair distances to compute weights for, based on 'subset' (1-based, inclusive ranges) and 'depth' flags
+/// @param flagHandler 
+/// @param depth depth of the MSA of the pair distances
+/// @return indices of rows (starting from 0), in increasing order
+vector<int> getDistanceRows(FlagHandler& flagHandler, int depth)
+{
+    depth = min(depth, flagHandler.getNonZeroIntValue("depth"));
+    vector<int> rows;
+
+    if (flagHandler.getFlagValue("subset").empty())
+    {
+        rows.resize(depth);
+        iota(rows.begin(), rows.end(), 0);
+        return rows;
+    }
+
+    vector<bool> selected(depth, false);
+    for (const auto& range : flagHandler.getRangeArrayValue("subset"))
+    {
+        if (range.second > depth)
+        {
+            throw runtime_error("Invalid 'subset' value. Rows should not be greater than the depth (" + to_string(depth) + ").");
+        }
+        fill(selected.begin() + range.first - 1, selected.begin() + range.second, true);
+    }
+    for (int i = 0; i < depth; i++)
+    {
+        if (selected[i])
+        {
+            rows.push_back(i);
         }
     }
+    return rows;
+}
+
+/// @brief Get the parameters a weight state is computed with, based on given flags
+/// @param flagHandler 
+/// @param alphabet 
+/// @param nonStandardOption 
+/// @param threshold 
+/// @param isSymmetric 
+/// @return weight state without any sequences
+WeightState getWeightStateParameters(FlagHandler& flagHandler, Alphabet alphabet, NonStandardHandler nonStandardOption,
+                                     float threshold, bool isSymmetric)
+{
+    WeightState state;
+    state.alphabet = alphabet;
+    state.nonStandardOption = nonStandardOption;
+    state.isSymmetric = isSymmetric;
+    state.threshold = threshold;
+    state.omitGapsInQuery = flagHandler.getBooleanValue("omit_query_gaps");
+    state.posStart = flagHandler.getNonZeroIntValue("pos_start");
+    state.posEnd = flagHandler.getNonZeroIntValue("pos_end");
+    return state;
 }
 
 /// @brief Set MSA depth based on 'depth' flag
@@ -603,128 +1126,1185 @@ int getNonGapEndPosition(string firstAlignement, int startPos, int length)
     return i;
 }
 
-/// @brief Set desired positiones to compute NEFF for based on given 'pos_start' and 'pos_end' flags
-/// @param sequences 
+/// @brief Get the columns of MSA corresponding to the given start and end positions of the query sequence
+/// @param firstAlignment first (query) sequence of MSA
+/// @param startPos start position (1-based, inclusive)
+/// @param endPos end position (1-based, inclusive), not greater than the length of the first alignment
+/// @return first and last columns (0-based, inclusive)
+pair<int, int> getColumnRange(const string& firstAlignment, int startPos, int endPos)
+{
+    int lengthOfFirstAlignment = firstAlignment.length();
+    int coutOfGapPositions = count(firstAlignment.begin(), firstAlignment.end(), '-');
+    int lengthOfQuerySeq = lengthOfFirstAlignment - coutOfGapPositions;
+
+    // is start and end positions are different from start and end positions of the quesry sequence
+    if(startPos != 1 || endPos != lengthOfQuerySeq)
+    {
+        int nonGapStartPos = startPos-1;
+        int nonGapEndPos = endPos-1;
+
+        // set non-gap start position and end position if there is any gaps in the first alignment        
+        if (coutOfGapPositions > 0)
+        {
+            nonGapStartPos = getNonGapStartPosition(firstAlignment, startPos);
+            if(endPos != lengthOfQuerySeq)
+            {
+                nonGapEndPos = getNonGapEndPosition(firstAlignment, nonGapStartPos, endPos-startPos+1);         
+            }
+        }
+        // columns up to the end of the alignment, if the end position is not found after the start position
+        if (nonGapEndPos < nonGapStartPos - 1 || nonGapEndPos >= lengthOfFirstAlignment)
+        {
+            nonGapEndPos = lengthOfFirstAlignment - 1;
+        }
+        return {nonGapStartPos, nonGapEndPos};
+    }
+    return {0, lengthOfFirstAlignment - 1};
+}
+
+/// @brief Set desired positiones to compute NEFF for based on given 'pos_start' and 'pos_end' flags
+/// @param sequences 
+/// @param flagHandler 
+void getPositions(vector<Sequence>& sequences, FlagHandler flagHandler)
+{
+    int startPos;
+    int endPos;
+
+    string firstAlignment = sequences[0].sequence;
+    int lengthOfFirstAlignment = firstAlignment.length();
+
+    // pos_start
+    startPos = flagHandler.getNonZeroIntValue("pos_start");
+
+    if (startPos >= lengthOfFirstAlignment)
+    {
+        throw runtime_error("'pos_start' should be less than the length of query sequence (" + to_string(lengthOfFirstAlignment) + ").");
+    }
+
+    // pos_end
+    endPos = flagHandler.getNonZeroIntValue("pos_end");
+
+    if (endPos <= startPos)
+    {
+        throw runtime_error("'pos_end' should be greater than 'pos_start'");
+    }
+    // condider the last position if given value is greater than length of query sequence
+    endPos = min(endPos, lengthOfFirstAlignment);
+    
+    pair<int, int> columns = getColumnRange(firstAlignment, startPos, endPos);
+    if (columns.first != 0 || columns.second != lengthOfFirstAlignment - 1)
+    {
+        // extract the substrings based on nonGap positions of start and end  AND update sequences, accordingly
+        for (auto& sequence : sequences)
+        {
+            sequence.sequence = sequence.sequence.substr(columns.first, columns.second - columns.first + 1);
+        }
+    }
+}
+
+/// @brief Get the columns of MSA of each region given by 'regions' flag, as ranges of positions of the query sequence
+/// (the same as 'pos_start' and 'pos_end'), excluding gappy columns
+/// @param sequences 
+/// @param gappyColumns 
+/// @param flagHandler 
+/// @return columns of each region, in increasing order
+vector<vector<int>> getRegionColumns(const vector<Sequence>& sequences, const vector<int>& gappyColumns, FlagHandler& flagHandler)
+{
+    const string& firstAlignment = sequences[0].sequence;
+    int lengthOfFirstAlignment = firstAlignment.length();
+
+    vector<bool> gappy(lengthOfFirstAlignment, false);
+    for (int column : gappyColumns)
+    {
+        gappy[column] = true;
+    }
+
+    vector<vector<int>> regionColumns;
+    for (const auto& region : flagHandler.getRangeArrayValue("regions"))
+    {
+        if (region.first >= lengthOfFirstAlignment || region.second <= region.first)
+        {
+            throw runtime_error("Invalid 'regions' value. Start of each region should be less than its end and the length of query sequence ("
+                                + to_string(lengthOfFirstAlignment) + ").");
+        }
+        pair<int, int> columns = getColumnRange(firstAlignment, region.first, min(region.second, lengthOfFirstAlignment));
+
+        vector<int> region2columns;
+        for (int column = columns.first; column <= columns.second; column++)
+        {
+            if (!gappy[column])
+            {
+                region2columns.push_back(column);
+            }
+        }
+        regionColumns.push_back(region2columns);
+    }
+    return regionColumns;
+}
+
+/// @brief to merge sequences and remove redundant sequences
+/// @param integratedSequences 
+/// @param sequences 
+void integrateUniqueSequences(vector<Sequence>& integratedSequences, const vector<Sequence>& sequences) {
+
+    //length of sequences in all provided files should be the same    
+    if(integratedSequences.size() != 0 && sequences[0].sequence.size() != integratedSequences[0].sequence.size())
+    {
+        throw runtime_error("Length of sequences in provided files are not the same.");
+    }
+    
+    // Iterate over the new sequences
+    for (const auto& seq : sequences) {
+        // Check if the sequence is not already in integratedSequences
+        auto it = std::find_if(integratedSequences.begin(), integratedSequences.end(), 
+                               [&](const Sequence& integratedSeq) {
+                                   return integratedSeq.sequence == seq.sequence;
+                               });
+        // If the sequence is not found, add it to integratedSequences
+        if (it == integratedSequences.end()) {
+            integratedSequences.push_back(seq);
+        }
+    }
+}
+
+/// @brief Read the MSA of the files given by 'file', omitting gap positions of the query sequence if 'omit_query_gaps'=true;
+/// unique sequences of multiple files are integrated until the given depth is reached
+/// @param flagHandler 
+/// @return 
+vector<Sequence> readInputMSA(FlagHandler& flagHandler)
+{
+    // file
+    vector<string> files = flagHandler.getFileArrayValue("file");
+
+    //formats
+    vector<string> formats = flagHandler.getArrayValues("format");
+
+    if (!formats.empty() && formats.size() != files.size())
+    {
+        throw runtime_error("'format' must either be empty or have the same number of elements as 'file'.");
+    }
+
+    Alphabet alphabet = flagHandler.getAlphabet();
+    bool checkValidation = flagHandler.getBooleanValue("check_validation");
+    bool omitGapsInQuery = flagHandler.getBooleanValue("omit_query_gaps");
+    int depth = flagHandler.getNonZeroIntValue("depth");
+    int skipLines = flagHandler.getIntValue("skip_lines");
+
+    vector<Sequence> integratedSequences;
+    for(int f=0; f<files.size(); f++)
+    {
+        string format = getFormat(files[f], !formats.empty()? formats[f] : "", "file");
+
+        vector<Sequence> sequences = readMSA(files[f], format, alphabet, checkValidation, omitGapsInQuery, skipLines);
+
+        if(sequences.size() == 0)
+        {
+            continue;
+        }
+
+        /// omit gap positions of query sequence in all sequences if omitGapsInQuery=true
+        if (omitGapsInQuery &&  sequences[0].sequence.find('-') != string::npos)
+        // if query sequence contains any gaps and they meant to be omitted
+        { 
+            keepNonGapPositionsOfQuerySequence(sequences);
+        }
+
+        if (files.size() == 1)
+        {
+            integratedSequences = sequences;
+            break;
+        }
+        
+        // integrate unique sequences from files when more than one file exists
+        integrateUniqueSequences(integratedSequences, sequences);         
+
+        // no need to integrate if the depth of sequences so far is more than the given depth
+        if (depth < integratedSequences.size())
+        {
+            break;
+        }
+    }
+
+    if (integratedSequences.empty())
+    {
+        throw runtime_error("There is no sequence in the given file(s).");
+    }
+    return integratedSequences;
+}
+
+/// @brief Get the median of per-residue NEFF
+/// @param residueNEFF 
+/// @return 
+float getMedian(vector<float> residueNEFF)
+{
+    sort(residueNEFF.begin(), residueNEFF.end());
+    return residueNEFF.size() % 2 == 0 
+            ? (residueNEFF[residueNEFF.size()/2 - 1] + residueNEFF[residueNEFF.size()/2]) / 2.0 
+            : residueNEFF[residueNEFF.size()/2];
+}
+
+/// @brief Print per-residue NEFF and its median
+/// @param residueNEFF 
+void printResidueNeff(const vector<float>& residueNEFF)
+{
+    cout << "Per-residue (column-wise) NEFF:" << endl;
+    for (int col=0; col < residueNEFF.size(); col++)
+    {
+        cout << residueNEFF[col] << ' ';
+    }
+    cout << "\nMedian of per-residue (column-wise) NEFF: " << getMedian(residueNEFF) <<endl << flush;
+}
+
+/// @brief Check whether lines of text can be printed in the standard output,
+/// i.e. results are not written in the standard output in a machine-readable format
+/// @param flagHandler 
+/// @return 
+bool printsText(FlagHandler& flagHandler)
+{
+    return flagHandler.getFlagValue("output_format") == "text" || !flagHandler.getFlagValue("out").empty();
+}
+
+/// @brief Print length and depth of MSA, unless results are written in the standard output in a machine-readable format
+/// @param flagHandler 
+/// @param length 
+/// @param depth 
+void printMSAShape(FlagHandler& flagHandler, int length, int depth)
+{
+    if (printsText(flagHandler))
+    {
+        cout << "MSA sequence length: "<< length << endl;
+        cout << "MSA depth:" << depth << endl;
+    }
+}
+
+/// @brief Get sequence weights, per-residue NEFF or NEFF based on given flags, to be written in a machine-readable format
+/// @param flagHandler 
+/// @param sequences2num 
+/// @param sequenceWeights 
+/// @param norm 
+/// @param length 
+/// @return 
+NeffResults getNeffResults(FlagHandler& flagHandler, const vector<vector<int>>& sequences2num,
+                           const vector<int>& sequenceWeights, Normalization norm, int length)
+{
+    NeffResults results;
+    results.length = length;
+    results.depth = sequenceWeights.size();
+    if (flagHandler.getBooleanValue("only_weights"))
+    {
+        results.weights.resize(sequenceWeights.size());
+        for (int i = 0; i < sequenceWeights.size(); i++)
+        {
+            results.weights[i] = 1. / sequenceWeights[i];
+        }
+    }
+    else if (flagHandler.getBooleanValue("residue_neff"))
+    {
+        results.residueNeff = computeResidueNEFF(sequences2num, sequenceWeights, norm);
+        results.medianResidueNeff = getMedian(results.residueNeff);
+    }
+    else
+    {
+        results.hasNeff = true;
+        results.neff = computeNeff(sequenceWeights, norm, length);
+    }
+    return results;
+}
+
+/// @brief Print sequence weights, per-residue NEFF or NEFF based on given flags
+/// @param flagHandler 
+/// @param sequences2num 
+/// @param sequenceWeights 
+/// @param norm 
+/// @param length 
+void printResults(FlagHandler& flagHandler, const vector<vector<int>>& sequences2num,
+                  const vector<int>& sequenceWeights, Normalization norm, int length)
+{
+    string outputFormat = flagHandler.getFlagValue("output_format");
+    if (outputFormat != "text")
+    {
+        writeResults(getNeffResults(flagHandler, sequences2num, sequenceWeights, norm, length), outputFormat,
+                     flagHandler.getFlagValue("out"));
+        return;
+    }
+
+    if(flagHandler.getBooleanValue("only_weights"))
+    {
+        cout << "Sequence weights:" << endl;
+        for (int i=0; i < sequenceWeights.size(); i++)
+        {
+            cout << 1./sequenceWeights[i] << ' ';
+        }
+        cout << endl << flush;
+    }
+    else if(flagHandler.getBooleanValue("residue_neff"))
+    {
+        printResidueNeff(computeResidueNEFF(sequences2num, sequenceWeights, norm));
+    }
+    else
+    {
+        float neff = computeNeff(sequenceWeights, norm, length);
+        cout << "NEFF: " << neff << endl;
+    }
+}
+
+/// @brief Write NEFF of several settings of an MSA in the format given by 'output_format' (not text)
+/// @param flagHandler 
+/// @param length 
+/// @param depth 
+/// @param table 
+void writeTableResults(FlagHandler& flagHandler, int length, int depth, const ResultTable& table)
+{
+    NeffResults results;
+    results.length = length;
+    results.depth = depth;
+    results.tables.push_back(table);
+    writeResults(results, flagHandler.getFlagValue("output_format"), flagHandler.getFlagValue("out"));
+}
+
+/// @brief Report NEFF of each configuration of similarity options; pairs of sequences are compared once
+/// for all configurations with the same encoding of sequences (non-standard letters are encoded as gaps only by ConsiderGap)
+/// @param flagHandler 
+/// @param sequences 
+/// @param configs 
+/// @param standardLetters 
+/// @param nonStandardLetters 
+/// @param gapCutoff 
+/// @param norm 
+/// @param threads 
+void reportMultiConfigNeff(FlagHandler& flagHandler, const vector<Sequence>& sequences, const vector<SimilarityConfig>& configs,
+                           const string& standardLetters, const string& nonStandardLetters, float gapCutoff, Normalization norm,
+                           int threads)
+{
+    vector<float> neffs(configs.size());
+    vector<int> lengths(configs.size());
+    vector<pair<string, int>> groupLengths; // non_standard_option values of each encoding and their MSA length
+    int depth = 0;
+
+    for (bool encodedAsGap : {configs[0].nonStandardOption == ConsiderGap, configs[0].nonStandardOption != ConsiderGap})
+    {
+        vector<int> group;
+        vector<SimilarityConfig> groupConfigs;
+        for (int c = 0; c < configs.size(); c++)
+        {
+            if ((configs[c].nonStandardOption == ConsiderGap) == encodedAsGap)
+            {
+                group.push_back(c);
+                groupConfigs.push_back(configs[c]);
+            }
+        }
+        if (group.empty())
+        {
+            continue;
+        }
+
+        vector<vector<int>> sequences2num = processSequences(sequences, standardLetters, nonStandardLetters,
+                                                             groupConfigs[0].nonStandardOption, gapCutoff);
+        int length = sequences2num[0].size();
+        depth = sequences2num.size();
+
+        // removing gappy positions depends on the encoding, so the length may differ between the groups
+        string options;
+        for (const SimilarityConfig& config : groupConfigs)
+        {
+            string option = to_string(config.nonStandardOption);
+            if (("," + options + ",").find("," + option + ",") == string::npos)
+            {
+                options += (options.empty() ? "" : ",") + option;
+            }
+        }
+        groupLengths.push_back({options, length});
+
+        vector<vector<int>> groupWeights = computeMultiConfigWeights(sequences2num, groupConfigs, standardLetters, threads);
+        for (int g = 0; g < group.size(); g++)
+        {
+            neffs[group[g]] = computeNeff(groupWeights[g], norm, length);
+            lengths[group[g]] = length;
+        }
+    }
+
+    if (printsText(flagHandler))
+    {
+        if (groupLengths.size() == 1 || groupLengths[0].second == groupLengths[1].second)
+        {
+            cout << "MSA sequence length: "<< groupLengths[0].second << endl;
+        }
+        else
+        {
+            for (const auto& groupLength : groupLengths)
+            {
+                cout << "MSA sequence length (non_standard_option=" << groupLength.first << "): " << groupLength.second << endl;
+            }
+        }
+        cout << "MSA depth:" << depth << endl;
+    }
+
+    if (flagHandler.getFlagValue("output_format") != "text")
+    {
+        ResultTable table = {"configs", {"threshold", "is_symmetric", "non_standard_option", "length"},
+                             {false, false, false, false}};
+        for (int c = 0; c < configs.size(); c++)
+        {
+            table.rows.push_back({formatFloat(configs[c].threshold), configs[c].isSymmetric ? "true" : "false",
+                                  to_string(configs[c].nonStandardOption), to_string(lengths[c])});
+            table.neff.push_back(neffs[c]);
+        }
+        writeTableResults(flagHandler, lengths[0], depth, table);
+        return;
+    }
+    for (int c = 0; c < configs.size(); c++)
+    {
+        cout << "NEFF (threshold=" << configs[c].threshold << ", is_symmetric=" << (configs[c].isSymmetric ? "true" : "false")
+             << ", non_standard_option=" << configs[c].nonStandardOption << "): " << neffs[c] << endl;
+    }
+}
+
+/// @brief Select 'select_depth' rows greedily maximizing NEFF, write them in 'select_out' (or print their indices)
+/// and print NEFF (or weights or per-residue NEFF) of the selected rows
+/// @param flagHandler 
+/// @param sequences 
+/// @param sequences2num 
+/// @param threshold 
+/// @param isSymmetric 
+/// @param standardLetters 
+/// @param nonStandardOption 
+/// @param norm 
+void reportSelectedRows(FlagHandler& flagHandler, const vector<Sequence>& sequences, const vector<vector<int>>& sequences2num,
+                        float threshold, bool isSymmetric, const string& standardLetters, NonStandardHandler nonStandardOption,
+                        Normalization norm)
+{
+    vector<int> sequenceWeights;
+    long long comparisons;
+    int depth = flagHandler.getNonZeroIntValue("select_depth");
+    vector<int> rows = selectDepth(sequences2num, threshold, isSymmetric, standardLetters, nonStandardOption, depth,
+                                   sequenceWeights, &comparisons);
+    cerr << "Compared " << comparisons << " pairs of sequences to select " << rows.size() << " of " << sequences2num.size()
+         << " rows" << endl;
+
+    vector<vector<int>> selected2num;
+    vector<Sequence> selectedSequences;
+    for (int row : rows)
+    {
+        selected2num.push_back(sequences2num[row]);
+        selectedSequences.push_back(sequences[row]);
+    }
+
+    int length = sequences2num[0].size();
+    printMSAShape(flagHandler, length, rows.size());
+
+    // select_out
+    string selectOutFile = flagHandler.getFlagValue("select_out");
+    if (!selectOutFile.empty())
+    {
+        writeMSA(selectedSequences, selectOutFile, getFormat(selectOutFile, "", "select_out"));
+    }
+    else
+    {
+        cout << "Selected rows:" << endl;
+        for (int row : rows)
+        {
+            cout << row + 1 << ' ';
+        }
+        cout << endl;
+    }
+
+    printResults(flagHandler, selected2num, sequenceWeights, norm, length);
+}
+
+/// @brief Write the profile of the MSA weighted by the given sequence weights in 'profile_out', if given
+/// @param flagHandler 
+/// @param sequences2num 
+/// @param weights weight of each sequence
+/// @param alphabet 
+/// @param threads 
+void writeProfile(FlagHandler& flagHandler, const vector<vector<int>>& sequences2num, const vector<float>& weights,
+                  Alphabet alphabet, int threads)
+{
+    string profileFile = flagHandler.getFlagValue("profile_out");
+    if (profileFile.empty())
+    {
+        return;
+    }
+
+    Profile profile = computeProfile(sequences2num, weights, alphabet, flagHandler.getPositiveFloatValue("profile_pseudocount"),
+                                     threads);
+    if (flagHandler.getFlagValue("profile_format") == "tsv")
+    {
+        profile.writeTSV(profileFile);
+    }
+    else
+    {
+        profile.write(profileFile);
+    }
+}
+
+/// @brief Write weighted frequencies of columns and pairs of columns of the MSA (and their mutual information, if 'pair_mi'
+/// is true) in 'pair_stats_out', if given
+/// @param flagHandler 
+/// @param sequences2num 
+/// @param weights weight of each sequence
+/// @param alphabet 
+/// @param threads 
+void writePairStatistics(FlagHandler& flagHandler, const vector<vector<int>>& sequences2num, const vector<float>& weights,
+                         Alphabet alphabet, int threads)
+{
+    string pairStatisticsFile = flagHandler.getFlagValue("pair_stats_out");
+    if (pairStatisticsFile.empty())
+    {
+        return;
+    }
+
+    PairStatistics statistics = computePairStatistics(sequences2num, weights, alphabet, flagHandler.getBooleanValue("pair_mi"),
+                                                      threads);
+    statistics.write(pairStatisticsFile);
+}
+
+/// @brief Print Henikoff position-based sequence weights, per-residue NEFF or NEFF (effective count of sequences)
+/// based on given flags
+/// @param flagHandler 
+/// @param sequences2num 
+/// @param alphabet 
+/// @param nonStandardOption 
+/// @param norm 
+/// @param threads 
+void reportHenikoffNeff(FlagHandler& flagHandler, const vector<vector<int>>& sequences2num, Alphabet alphabet,
+                        NonStandardHandler nonStandardOption, Normalization norm, int threads)
+{
+    vector<float> weights = computeHenikoffWeights(sequences2num, getStandardLetters(alphabet), nonStandardOption, threads);
+    writeProfile(flagHandler, sequences2num, weights, alphabet, threads);
+    writePairStatistics(flagHandler, sequences2num, weights, alphabet, threads);
+    int length = sequences2num[0].size();
+
+    printMSAShape(flagHandler, length, sequences2num.size());
+
+    string outputFormat = flagHandler.getFlagValue("output_format");
+    if (outputFormat != "text")
+    {
+        NeffResults results;
+        results.length = length;
+        results.depth = sequences2num.size();
+        if (flagHandler.getBooleanValue("only_weights"))
+        {
+            results.weights = weights;
+        }
+        else if (flagHandler.getBooleanValue("residue_neff"))
+        {
+            results.residueNeff = computeResidueNEFF(sequences2num, weights, norm);
+            results.medianResidueNeff = getMedian(results.residueNeff);
+        }
+        else
+        {
+            results.hasNeff = true;
+            results.neff = computeNeff(weights, norm, length);
+        }
+        writeResults(results, outputFormat, flagHandler.getFlagValue("out"));
+    }
+    else if(flagHandler.getBooleanValue("only_weights"))
+    {
+        cout << "Sequence weights:" << endl;
+        for (int i=0; i < weights.size(); i++)
+        {
+            cout << weights[i] << ' ';
+        }
+        cout << endl << flush;
+    }
+    else if(flagHandler.getBooleanValue("residue_neff"))
+    {
+        printResidueNeff(computeResidueNEFF(sequences2num, weights, norm));
+    }
+    else
+    {
+        cout << "NEFF: " << computeNeff(weights, norm, length) << endl;
+    }
+}
+
+/// @brief Report NEFF of trials of randomly masking 'mask_frac' of columns (after removing gappy positions),
+/// and write the MSA of the trial with the highest NEFF (without its masked columns) if 'mask_out' is given
+/// @param flagHandler 
+/// @param sequences 
+/// @param standardLetters 
+/// @param nonStandardLetters 
+/// @param nonStandardOption 
+/// @param gapCutoff 
+/// @param threshold 
+/// @param isSymmetric 
+/// @param norm 
+/// @param threads 
+void reportMaskTrialNeff(FlagHandler& flagHandler, const vector<Sequence>& sequences, const string& standardLetters,
+                         const string& nonStandardLetters, NonStandardHandler nonStandardOption, float gapCutoff,
+                         float threshold, bool isSymmetric, Normalization norm, int threads)
+{
+    vector<vector<int>> sequences2num = processSequences(sequences, standardLetters, nonStandardLetters, nonStandardOption, 1);
+    vector<bool> gappy(sequences2num[0].size(), false);
+    if (gapCutoff < 1)
+    {
+        for (int column : getGappyPositions(sequences2num, gapCutoff))
+        {
+            gappy[column] = true;
+        }
+    }
+    vector<int> columns; // columns of sequences, after removing gappy positions
+    for (int column = 0; column < gappy.size(); column++)
+    {
+        if (!gappy[column])
+        {
+            columns.push_back(column);
+        }
+    }
+    removeGappyPositions(sequences2num, gapCutoff);
+
+    int length = columns.size();
+    int maskedCount = length * flagHandler.getFloatValue("mask_frac");
+    if (maskedCount >= length)
+    {
+        throw runtime_error("'mask_frac' should leave at least one column unmasked.");
+    }
+
+    // random masks of columns, reproducible by 'seed'
+    int trials = flagHandler.getNonZeroIntValue("mask_trials");
+    mt19937 generator(flagHandler.getIntValue("seed"));
+    vector<int> order(length);
+    vector<vector<bool>> keptColumns(trials, vector<bool>(length, true));
+    for (int t = 0; t < trials; t++)
+    {
+        iota(order.begin(), order.end(), 0);
+        shuffle(order.begin(), order.end(), generator);
+        for (int c = 0; c < maskedCount; c++)
+        {
+            keptColumns[t][order[c]] = false;
+        }
+    }
+
+    vector<vector<int>> maskWeights = computeMaskWeights(sequences2num, threshold, isSymmetric, standardLetters,
+                                                         nonStandardOption, keptColumns, threads);
+
+    printMSAShape(flagHandler, length - maskedCount, sequences2num.size());
+
+    int best = 0;
+    vector<float> neffs;
+    for (int t = 0; t < trials; t++)
+    {
+        neffs.push_back(computeNeff(maskWeights[t], norm, length - maskedCount));
+        if (neffs[t] > neffs[best])
+        {
+            best = t;
+        }
+    }
+
+    if (flagHandler.getFlagValue("output_format") != "text")
+    {
+        ResultTable table = {"mask_trials", {"trial"}, {false}};
+        for (int t = 0; t < trials; t++)
+        {
+            table.rows.push_back({to_string(t + 1)});
+        }
+        table.neff = neffs;
+        writeTableResults(flagHandler, length - maskedCount, sequences2num.size(), table);
+    }
+    else
+    {
+        for (int t = 0; t < trials; t++)
+        {
+            cout << "NEFF of mask trial " << t+1 << ": " << neffs[t] << endl;
+        }
+        cout << "Highest NEFF: " << neffs[best] << " (mask trial " << best+1 << ")" << endl;
+    }
+
+    // mask_out
+    string maskOutFile = flagHandler.getFlagValue("mask_out");
+    if (!maskOutFile.empty())
+    {
+        vector<Sequence> maskedSequences = sequences;
+        for (auto& sequence : maskedSequences)
+        {
+            string kept;
+            for (int c = 0; c < length; c++)
+            {
+                if (keptColumns[best][c])
+                {
+                    kept += sequence.sequence[columns[c]];
+                }
+            }
+            sequence.sequence = kept;
+        }
+
+        writeMSA(maskedSequences, maskOutFile, getFormat(maskOutFile, "", "mask_out"));
+    }
+}
+
+/// @brief Report local NEFF of each position, computed with sequence weights of the window of 'window' columns centered
+/// on that position (windows at the ends of sequences are shifted to stay within them)
+/// @param flagHandler 
+/// @param sequences2num 
+/// @param threshold 
+/// @param isSymmetric 
+/// @param standardLetters 
+/// @param nonStandardOption 
+/// @param norm 
+/// @param window 
+/// @param threads 
+void reportWindowNeff(FlagHandler& flagHandler, const vector<vector<int>>& sequences2num, float threshold, bool isSymmetric,
+                      const string& standardLetters, NonStandardHandler nonStandardOption, Normalization norm, int window,
+                      int threads)
+{
+    int length = sequences2num[0].size();
+    // consider the whole sequences if given window is greater than their length
+    window = min(window, length);
+
+    vector<vector<int>> windowWeights = computeWindowWeights(sequences2num, threshold, isSymmetric, standardLetters,
+                                                             nonStandardOption, window, threads);
+    vector<float> windowNEFF;
+    for (const auto& weights : windowWeights)
+    {
+        windowNEFF.push_back(computeNeff(weights, norm, window));
+    }
+
+    printMSAShape(flagHandler, length, sequences2num.size());
+
+    vector<float> localNEFF;
+    for (int col=0; col < length; col++)
+    {
+        int start = min(max(col - window/2, 0), length - window);
+        localNEFF.push_back(windowNEFF[start]);
+    }
+
+    string outputFormat = flagHandler.getFlagValue("output_format");
+    if (outputFormat != "text")
+    {
+        NeffResults results;
+        results.length = length;
+        results.depth = sequences2num.size();
+        results.window = window;
+        results.localNeff = localNEFF;
+        results.medianLocalNeff = getMedian(localNEFF);
+        writeResults(results, outputFormat, flagHandler.getFlagValue("out"));
+        return;
+    }
+
+    cout << "Per-position local NEFF (window=" << window << "):" << endl;
+    for (int col=0; col < length; col++)
+    {
+        cout << localNEFF[col] << ' ';
+    }
+    cout << "\nMedian of per-position local NEFF: " << getMedian(localNEFF) <<endl << flush;
+}
+
+/// @brief Report NEFF of each region given by 'regions' flag, comparing pairs of sequences once for all regions
+/// @param flagHandler 
+/// @param sequences 
+/// @param standardLetters 
+/// @param nonStandardLetters 
+/// @param nonStandardOption 
+/// @param gapCutoff 
+/// @param threshold 
+/// @param isSymmetric 
+/// @param norm 
+/// @param threads 
+void reportRegionNeff(FlagHandler& flagHandler, const vector<Sequence>& sequences, const string& standardLetters,
+                      const string& nonStandardLetters, NonStandardHandler nonStandardOption, float gapCutoff,
+                      float threshold, bool isSymmetric, Normalization norm, int threads)
+{
+    // gappy columns are the same when removed within each region or within all columns
+    vector<vector<int>> sequences2num = processSequences(sequences, standardLetters, nonStandardLetters, nonStandardOption, 1);
+    vector<int> gappyColumns;
+    if (gapCutoff < 1)
+    {
+        gappyColumns = getGappyPositions(sequences2num, gapCutoff);
+    }
+    vector<vector<int>> regionColumns = getRegionColumns(sequences, gappyColumns, flagHandler);
+
+    vector<vector<int>> regionWeights = computeRegionWeights(sequences2num, threshold, isSymmetric, standardLetters,
+                                                             nonStandardOption, regionColumns, threads);
+
+    int length = sequences2num[0].size() - gappyColumns.size();
+    printMSAShape(flagHandler, length, sequences2num.size());
+    vector<string> regions = flagHandler.getArrayValues("regions");
+    if (flagHandler.getFlagValue("output_format") != "text")
+    {
+        ResultTable table = {"regions", {"region", "length"}, {true, false}};
+        for (int r = 0; r < regions.size(); r++)
+        {
+            table.rows.push_back({regions[r], to_string(regionColumns[r].size())});
+            table.neff.push_back(computeNeff(regionWeights[r], norm, regionColumns[r].size()));
+        }
+        writeTableResults(flagHandler, length, sequences2num.size(), table);
+        return;
+    }
+    for (int r = 0; r < regions.size(); r++)
+    {
+        cout << "NEFF of region " << regions[r] << ": " << computeNeff(regionWeights[r], norm, regionColumns[r].size()) << endl;
+    }
+}
+
+/// @brief Integrate weight states of several files in the given order, by comparing only sequences of different files
+/// and get NEFF contributed by each file
+/// @param stateFiles 
+/// @param norm 
+/// @param table set to NEFF after integrating each file, with its marginal NEFF
+/// @return integrated weight state
+WeightState combineWeightStates(const vector<string>& stateFiles, Normalization norm, ResultTable& table)
+{
+    WeightState integratedState;
+    float previousNeff = 0.0;
+    table = {"states", {"file", "depth", "marginal_neff"}, {true, false, false}};
+
+    for (int f = 0; f < stateFiles.size(); f++)
+    {
+        WeightState state = WeightState::read(stateFiles[f]);
+        if (f == 0)
+        {
+            // parameters of the first state are used for all states
+            integratedState = state;
+            integratedState.sequences.clear();
+            integratedState.sequenceWeights.clear();
+            integratedState.sequenceDigests.clear();
+        }
+        else
+        {
+            integratedState.checkCompatibility(state, stateFiles[f]);
+        }
+
+        // remove redundant sequences, as done when integrating MSA files
+        integratedState.merge(state);
+
+        int length = integratedState.sequences[0].size();
+        float neff = computeNeff(integratedState.sequenceWeights, norm, length);
+
+        table.rows.push_back({stateFiles[f], to_string(integratedState.sequences.size()), formatFloat(neff - previousNeff)});
+        table.neff.push_back(neff);
+        previousNeff = neff;
+    }
+
+    return integratedState;
+}
+
+/// @brief Fail a request of the server whose deadline is passed, between the steps of its computation
+/// @param deadline 
+void checkDeadline(chrono::steady_clock::time_point deadline)
+{
+    if (chrono::steady_clock::now() >= deadline)
+    {
+        throw runtime_error("The request exceeded its time limit.");
+    }
+}
+
+/// @brief Compute NEFF, sequence weights or per-residue NEFF of an MSA read for a request of the server or an entry of a
+/// manifest, with the options of its flags
+/// @param flagHandler 
+/// @param sequences 
+/// @param threads 
+/// @param cache 
+/// @param deadline 
+/// @param comparedPairs set to the number of pairs of sequences compared (0 if weights are read from the cache)
+/// @return 
+NeffResults computeNeffResults(FlagHandler& flagHandler, vector<Sequence>& sequences, int threads, const ResultCache& cache,
+                               chrono::steady_clock::time_point deadline, long long& comparedPairs)
+{
+    if (flagHandler.getBooleanValue("only_weights") && flagHandler.getBooleanValue("residue_neff"))
+    {
+        throw runtime_error("Only one of 'only_weights' or 'residue_neff' can be true at a time.");
+    }
+    if (hasMultipleConfigs(flagHandler))
+    {
+        throw runtime_error("Lists of similarity options are not supported by requests and manifest entries.");
+    }
+
+    setDepth(sequences, flagHandler.getNonZeroIntValue("depth"));
+    getPositions(sequences, flagHandler);
+
+    Alphabet alphabet = flagHandler.getAlphabet();
+    NonStandardHandler nonStandardOption = getNonStandardOptions(flagHandler)[0];
+    string standardLetters = getStandardLetters(alphabet);
+    vector<vector<int>> sequences2num = processSequences(sequences, standardLetters, getNonStandardLetters(alphabet),
+                                                         nonStandardOption, flagHandler.getFloatValue("gap_cutoff"));
+    Normalization norm = getNormalization(flagHandler);
+    checkDeadline(deadline);
+
+    bool cached;
+    vector<int> sequenceWeights = cache.getWeights(sequences2num, flagHandler.getFloatValue("threshold"),
+                                                   flagHandler.getBooleanValue("is_symmetric"), standardLetters,
+                                                   nonStandardOption, threads, deadline, &cached);
+    comparedPairs = cached ? 0 : (long long)sequences2num.size() * (sequences2num.size() - 1) / 2;
+
+    NeffResults results = getNeffResults(flagHandler, sequences2num, sequenceWeights, norm, sequences2num[0].size());
+    checkDeadline(deadline);
+    return results;
+}
+
+/// @brief Compute the response of a request of the server: one '--<flag>=<value>' on each line, optionally followed by
+/// an empty line and the MSA (instead of 'file')
+/// @param request 
+/// @param deadline 
+/// @param threads 
+/// @param cache 
+/// @param server 
+/// @param comparedPairs 
+/// @return results in the requested output_format, or statistics of the server
+string serveRequest(const string& request, chrono::steady_clock::time_point deadline, int threads, const ResultCache& cache,
+                    const NeffServer& server, long long& comparedPairs)
+{
+    size_t flagsEnd = request.find("\n\n");
+    string msaText = flagsEnd == string::npos ? "" : request.substr(flagsEnd + 2);
+
+    vector<string> args;
+    istringstream lines(request.substr(0, flagsEnd));
+    string line;
+    while (getline(lines, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.pop_back();
+        }
+        if (!line.empty())
+        {
+            args.push_back(line);
+        }
+    }
+
+    unordered_map<string, FlagInfo> requestFlags = {{"command", {false, "neff"}}, {"output_format", {false, "json"}}};
+    for (const string& name : REQUEST_FLAGS)
+    {
+        requestFlags[name] = Flags.at(name);
+    }
+    FlagHandler flagHandler(requestFlags);
+    flagHandler.processFlags(args);
+
+    string command = flagHandler.getFlagValue("command");
+    if (command == "stats")
+    {
+        return server.getMetrics();
+    }
+    if (command != "neff")
+    {
+        throw runtime_error("Invalid 'command' value. It should be 'neff' or 'stats'.");
+    }
+    string outputFormat = flagHandler.getFlagValue("output_format");
+    if (outputFormat == "text" || find(OUTPUT_FORMATS.begin(), OUTPUT_FORMATS.end(), outputFormat) == OUTPUT_FORMATS.end())
+    {
+        throw runtime_error("Invalid 'output_format' value of a request. It should be one of 'json', 'tsv' or 'npy'.");
+    }
+    string file = flagHandler.getFlagValue("file");
+    if (file.empty() == msaText.empty())
+    {
+        throw runtime_error("Either 'file' or an MSA after the flags of the request should be given.");
+    }
+    vector<Sequence> sequences;
+    if (file.empty())
+    {
+        bool omitGapsInQuery = flagHandler.getBooleanValue("omit_query_gaps");
+        sequences = readMSAText(msaText, getFormat("", flagHandler.getFlagValue("format"), "format"), flagHandler.getAlphabet(),
+                                flagHandler.getBooleanValue("check_validation"), omitGapsInQuery,
+                                flagHandler.getIntValue("skip_lines"));
+        if (sequences.empty())
+        {
+            throw runtime_error("There is no sequence in the MSA.");
+        }
+        if (omitGapsInQuery && sequences[0].sequence.find('-') != string::npos)
+        {
+            keepNonGapPositionsOfQuerySequence(sequences);
+        }
+    }
+    else
+    {
+        sequences = readInputMSA(flagHandler);
+    }
+    checkDeadline(deadline);
+
+    ostringstream response;
+    writeResults(response, computeNeffResults(flagHandler, sequences, threads, cache, deadline, comparedPairs), outputFormat);
+    return response.str();
+}
+
+/// @brief Get the result cache in the directory given by 'cache_dir'; the cache is disabled when it is empty
 /// @param flagHandler 
-void getPositions(vector<Sequence>& sequences, FlagHandler flagHandler)
+/// @return 
+ResultCache getResultCache(FlagHandler& flagHandler)
 {
-    int startPos;
-    int endPos;
+    return ResultCache(flagHandler.getFlagValue("cache_dir"),
+                       (long long)flagHandler.getNonZeroIntValue("cache_max_size") * 1024 * 1024);
+}
 
-    string firstAlignment = sequences[0].sequence;
-    int lengthOfFirstAlignment = firstAlignment.length();
+/// @brief Serve NEFF requests on the socket given by 'serve' until the server is stopped
+/// @param flagHandler 
+void runServer(FlagHandler& flagHandler)
+{
+    ServerOptions options;
+    options.socketPath = flagHandler.getFlagValue("serve");
+    options.workers = flagHandler.getNonZeroIntValue("serve_workers");
+    options.queueSize = flagHandler.getNonZeroIntValue("serve_queue");
+    options.timeout = flagHandler.getNonZeroIntValue("serve_timeout");
+    int threads = flagHandler.getNonZeroIntValue("threads");
+    ResultCache cache = getResultCache(flagHandler);
+
+    NeffServer* serverPointer = nullptr;
+    NeffServer server(options, [&](const string& request, chrono::steady_clock::time_point deadline, long long& comparedPairs)
+    {
+        return serveRequest(request, deadline, threads, cache, *serverPointer, comparedPairs);
+    });
+    serverPointer = &server;
 
-    int coutOfGapPositions = count(firstAlignment.begin(), firstAlignment.end(), '-');
-    int lengthOfQuerySeq = lengthOfFirstAlignment - coutOfGapPositions;
+    cerr << "Serving NEFF requests on " << options.socketPath << " with " << options.workers << " workers." << endl;
+    server.run();
+}
 
-    // pos_start
-    startPos = flagHandler.getNonZeroIntValue("pos_start");
+// Entry of a manifest
+struct ManifestEntry
+{
+    int line;                 // line of the entry in the manifest
+    string file;              // input file(s), comma-separated
+    vector<string> args;      // options of the entry, as '--<flag>=<value>'
+};
 
-    if (startPos >= lengthOfFirstAlignment)
+/// @brief Read the entries of a manifest, skipping empty lines and comments
+/// @param file 
+/// @return 
+vector<ManifestEntry> readManifest(const string& file)
+{
+    ifstream input(file);
+    if (!input)
     {
-        throw runtime_error("'pos_start' should be less than the length of query sequence (" + to_string(lengthOfFirstAlignment) + ").");
+        throw runtime_error("Failed to open the manifest file '" + file + "'.");
     }
 
-    // pos_end
-    endPos = flagHandler.getNonZeroIntValue("pos_end");
-
-    if (endPos <= startPos)
-    {
-        throw runtime_error("'pos_end' should be greater than 'pos_start'");
-    }
-    // condider the last position if given value is greater than length of query sequence
-    endPos = min(endPos, lengthOfFirstAlignment);
-    
-    // is start and end positions are different from start and end positions of the quesry sequence
-    if(startPos != 1 || endPos != lengthOfQuerySeq)
+    vector<ManifestEntry> entries;
+    string line;
+    int lineNumber = 0;
+    while (getline(input, line))
     {
-        int nonGapStartPos = startPos-1;
-        int nonGapEndPos = endPos-1;
-
-        // set non-gap start position and end position if there is any gaps in the first alignment        
-        if (coutOfGapPositions > 0)
+        lineNumber++;
+        istringstream fields(line);
+        ManifestEntry entry;
+        entry.line = lineNumber;
+        if (!(fields >> entry.file) || entry.file[0] == '#')
         {
-            nonGapStartPos = getNonGapStartPosition(firstAlignment, startPos);
-            if(endPos != lengthOfQuerySeq)
-            {
-                nonGapEndPos = getNonGapEndPosition(firstAlignment, nonGapStartPos, endPos-startPos+1);         
-            }
+            continue;
         }
-        // extract the substrings based on nonGap positions of start and end  AND update sequences, accordingly
-        for (auto& sequence : sequences)
+        string arg;
+        while (fields >> arg)
         {
-            sequence.sequence = sequence.sequence.substr(nonGapStartPos , nonGapEndPos - nonGapStartPos + 1);
+            entry.args.push_back(arg);
         }
+        entries.push_back(entry);
     }
+    return entries;
 }
 
-/// @brief to merge sequences and remove redundant sequences
-/// @param integratedSequences 
-/// @param sequences 
-void integrateUniqueSequences(vector<Sequence>& integratedSequences, const vector<Sequence>& sequences) {
-
-    //length of sequences in all provided files should be the same    
-    if(integratedSequences.size() != 0 && sequences[0].sequence.size() != integratedSequences[0].sequence.size())
+/// @brief Compute NEFF, sequence weights or per-residue NEFF of an entry of a manifest
+/// @param flagHandler flags of the run, the defaults of the options of the entry
+/// @param entry 
+/// @param threads 
+/// @param cache 
+/// @return 
+NeffResults computeManifestEntry(const FlagHandler& flagHandler, const ManifestEntry& entry, int threads, const ResultCache& cache)
+{
+    unordered_map<string, FlagInfo> entryFlags;
+    for (const string& name : REQUEST_FLAGS)
     {
-        throw runtime_error("Length of sequences in provided files are not the same.");
+        entryFlags[name] = {false, flagHandler.getFlagValue(name)};
     }
-    
-    // Iterate over the new sequences
-    for (const auto& seq : sequences) {
-        // Check if the sequence is not already in integratedSequences
-        auto it = std::find_if(integratedSequences.begin(), integratedSequences.end(), 
-                               [&](const Sequence& integratedSeq) {
-                                   return integratedSeq.sequence == seq.sequence;
-                               });
-        // If the sequence is not found, add it to integratedSequences
-        if (it == integratedSequences.end()) {
-            integratedSequences.push_back(seq);
+    FlagHandler entryHandler(entryFlags);
+    for (const string& arg : entry.args)
+    {
+        if (arg.rfind("--file=", 0) == 0)
+        {
+            throw runtime_error("Input files of an entry should be given by its first field, not by 'file'.");
         }
     }
+    entryHandler.processFlags(entry.args);
+    entryHandler.processFlags({"--file=" + entry.file});
+
+    vector<Sequence> sequences = readInputMSA(entryHandler);
+    long long comparedPairs;
+    return computeNeffResults(entryHandler, sequences, threads, cache, chrono::steady_clock::time_point::max(), comparedPairs);
 }
 
-/// @brief Compute per-residue (column-wise) NEFF
-/// @param sequences 
-/// @param sequenceWeights
-/// @param norm 
-/// @return 
-vector<float> computeResidueNEFF
-(const vector<vector<int>>& sequences, const vector<int>& sequenceWeights, Normalization norm) {
-    int numSequences = sequences.size();
-    if (numSequences == 0) {
-        return {};
+/// @brief Compute the entries of the manifest given by 'manifest', 'manifest_jobs' entries at a time, and write one line of
+/// results for each entry in the order of the manifest, as soon as the results of the previous entries are written
+/// @param flagHandler 
+void runManifest(FlagHandler& flagHandler)
+{
+    vector<ManifestEntry> entries = readManifest(flagHandler.getFileValue("manifest"));
+    int threads = flagHandler.getNonZeroIntValue("threads");
+    int jobs = max(1, min<int>(flagHandler.getNonZeroIntValue("manifest_jobs"), entries.size()));
+    // entries computed at the same time share the threads, instead of each one using all of them
+    int entryThreads = max(1, threads / jobs);
+    string format = flagHandler.getFlagValue("output_format") == "json" ? "json" : "tsv";
+    ResultCache cache = getResultCache(flagHandler);
+
+    string outFile = flagHandler.getFlagValue("out");
+    ofstream outStream;
+    if (!outFile.empty())
+    {
+        outStream.open(outFile);
+        if (!outStream)
+        {
+            throw runtime_error("Failed to create file: " + outFile);
+        }
     }
-    int sequenceLength = sequences[0].size();
-    
-    vector<float> residueNEFF(sequenceLength, 0.0);
-    
-    for (int col = 0; col < sequenceLength; ++col) {
-        float sumWeights = 0.0;
-        for (int row = 0; row < numSequences; ++row) {
-            // include sequence weight of the current seqeunce in the residue NEFF, if residue is not corresponding to a gap position
-            if (sequences[row][col] != 0)
+    ostream& output = outFile.empty() ? cout : outStream;
+    if (format == "tsv")
+    {
+        writeEntryHeader(output);
+    }
+
+    vector<string> lines(entries.size());
+    vector<bool> done(entries.size(), false);
+    mutex linesLock;
+    condition_variable linesCondition;
+    atomic<int> nextEntry{0};
+    atomic<int> failedEntries{0};
+
+    vector<thread> workers;
+    for (int j = 0; j < jobs; j++)
+    {
+        workers.emplace_back([&]()
+        {
+            for (int e = nextEntry++; e < entries.size(); e = nextEntry++)
             {
-                sumWeights += 1./ sequenceWeights[row];
+                ostringstream line;
+                try
+                {
+                    NeffResults results = computeManifestEntry(flagHandler, entries[e], entryThreads, cache);
+                    writeEntryResults(line, entries[e].line, entries[e].file, &results, "", format);
+                }
+                catch (const exception& error)
+                {
+                    // failures are reported in the results of the entry, without stopping the other entries
+                    writeEntryResults(line, entries[e].line, entries[e].file, nullptr, error.what(), format);
+                    failedEntries++;
+                }
+                {
+                    lock_guard<mutex> guard(linesLock);
+                    lines[e] = line.str();
+                    done[e] = true;
+                }
+                linesCondition.notify_all();
             }
-        }
+        });
+    }
 
-        switch(norm) // normalizing Nf
+    for (int e = 0; e < entries.size(); e++)
+    {
+        string line;
         {
-            case Sqrt_L:
-                residueNEFF[col] = sumWeights/sqrt(sequenceLength);
-                break;
-            case L:
-                residueNEFF[col] = sumWeights/sequenceLength;
-                break;
-            default:
-                residueNEFF[col] = sumWeights;
-                break;
+            unique_lock<mutex> guard(linesLock);
+            linesCondition.wait(guard, [&]() { return done[e]; });
+            line.swap(lines[e]);
         }
+        output << line << flush;
+    }
+    for (thread& worker : workers)
+    {
+        worker.join();
     }
-    
-    return residueNEFF;
-}
 
+    if (!output)
+    {
+        throw runtime_error("Failed to write the results of the manifest.");
+    }
+    cerr << "Computed " << entries.size() - failedEntries << " of " << entries.size() << " entries of the manifest ("
+         << failedEntries << " failed)." << endl;
+}
 
 int main(int argc, char **argv)
 {
@@ -740,16 +2320,14 @@ int main(int argc, char **argv)
         }
     }
 
-    vector<string> files, formats;
-    string file;
     float threshold, gapCutoff;
-    bool checkValidation, omitGapsInQuery, isSymmetric;
+    bool isSymmetric;
     int depth;
     Alphabet alphabet;
     NonStandardHandler nonStandardOption;
     Normalization norm;
     string standardLetters, nonStandardLetters;
-    vector<Sequence> sequences, integratedSequences;
+    vector<Sequence> sequences;
     vector<vector<int>> sequences2num;
     vector<int> sequenceWeights;
 
@@ -760,94 +2338,122 @@ int main(int argc, char **argv)
 
         checkFlags(flagHandler);
 
-        // file
-        files = flagHandler.getFileArrayValue("file");
-
-        //formats
-        formats = flagHandler.getArrayValues("format");
-
-        if (!formats.empty() && formats.size() != files.size())
+        // serve
+        if (!flagHandler.getFlagValue("serve").empty())
         {
-            throw runtime_error("'format' must either be empty or have the same number of elements as 'file'.");
+            runServer(flagHandler);
+            return 0;
         }
-                
-        // alphabet
-        alphabet = getAlphabet(flagHandler);
-
-        // check_validation
-        checkValidation = flagHandler.getBooleanValue("check_validation");
-
-        // omit_query_gaps
-        omitGapsInQuery = flagHandler.getBooleanValue("omit_query_gaps");
-
-        //depth    
-        depth = flagHandler.getNonZeroIntValue("depth");
-
-        // skip_lines
-        int skipLines = flagHandler.getIntValue("skip_lines");
-
-        MSAReader* msaReader;
 
-        for(int f=0; f<files.size(); f++)
+        // manifest
+        if (!flagHandler.getFlagValue("manifest").empty())
         {
-            file = files[f];
-
-            string format = getFormat(file, !formats.empty()? formats[f] : "", "file");
-
-            if (format == "a2m")
-                msaReader = new MSAReader_a2m(file, alphabet, checkValidation, omitGapsInQuery, skipLines);
-            else if(format == "a3m")
-                msaReader = new MSAReader_a3m(file, alphabet, checkValidation, omitGapsInQuery, skipLines);
-            else if(format == "sto")
-                msaReader = new MSAReader_sto(file, alphabet, checkValidation, omitGapsInQuery, skipLines);
-            else if(format == "clustal")
-                msaReader = new MSAReader_clustal(file, alphabet, checkValidation, omitGapsInQuery, skipLines);
-            else if (format == "aln")
-                msaReader = new MSAReader_aln(file, alphabet, checkValidation, omitGapsInQuery, skipLines);
-            else if (format == "pfam")
-                msaReader = new MSAReader_pfam(file, alphabet, checkValidation, omitGapsInQuery, skipLines);
-            else if (find(FASTA_FORMATS.begin(), FASTA_FORMATS.end(), format) != FASTA_FORMATS.end())
-                msaReader = new MSAReader_fasta(file, alphabet, checkValidation, omitGapsInQuery, skipLines);
+            runManifest(flagHandler);
+            return 0;
+        }
 
-            sequences = msaReader->read();
+        // combine_states
+        if (!flagHandler.getFlagValue("combine_states").empty())
+        {
+            norm = getNormalization(flagHandler);
+            ResultTable table;
+            WeightState state = combineWeightStates(flagHandler.getFileArrayValue("combine_states"), norm, table);
+            int length = state.sequences[0].size();
+            string outputFormat = flagHandler.getFlagValue("output_format");
 
-            if(sequences.size() == 0)
+            if (printsText(flagHandler))
+            {
+                cout << "MSA sequence length: " << length << endl;
+            }
+            if (outputFormat == "text")
+            {
+                for (int f = 0; f < table.rows.size(); f++)
+                {
+                    cout << "NEFF after integrating " << table.rows[f][0] << " (depth=" << table.rows[f][1] << "): "
+                         << table.neff[f] << " (marginal NEFF: " << table.neff[f] - (f > 0 ? table.neff[f-1] : 0) << ")" << endl;
+                }
+            }
+            if (printsText(flagHandler))
             {
-                continue;
+                cout << "MSA depth:" << state.sequences.size() << endl;
             }
 
-            /// omit gap positions of query sequence in all sequences if omitGapsInQuery=true
-            if (omitGapsInQuery &&  sequences[0].sequence.find('-') != string::npos)
-            // if query sequence contains any gaps and they meant to be omitted
-            { 
-                keepNonGapPositionsOfQuerySequence(sequences);
+            string stateOutFile = flagHandler.getFlagValue("state_out");
+            if (!stateOutFile.empty())
+            {
+                state.write(stateOutFile);
             }
 
-            
-            if (files.size() == 1)
+            if (outputFormat == "text")
             {
-                integratedSequences = sequences;
-                break;
+                printResults(flagHandler, state.sequences, state.sequenceWeights, norm, length);
             }
-            
-            // integrate unique sequences from files when more than one file exists
-            integrateUniqueSequences(integratedSequences, sequences);         
+            else
+            {
+                NeffResults results = getNeffResults(flagHandler, state.sequences, state.sequenceWeights, norm, length);
+                results.tables.push_back(table);
+                writeResults(results, outputFormat, flagHandler.getFlagValue("out"));
+            }
+            return 0;
+        }
 
-            // no need to integrate if the depth of sequences so far is more than the given depth
-            if (depth < integratedSequences.size())
+        // weights from pair distances, without any MSA
+        if (!flagHandler.getFlagValue("distances").empty())
+        {
+            norm = getNormalization(flagHandler);
+            DistanceStore store(flagHandler.getFileValue("distances"));
+            if ((flagHandler.isGiven("is_symmetric") && flagHandler.getBooleanValue("is_symmetric") != store.getIsSymmetric())
+                || (flagHandler.isGiven("non_standard_option")
+                    && getNonStandardOptions(flagHandler)[0] != store.getNonStandardOption()))
             {
-                break;
+                throw runtime_error("Pair distances are not computed for the given 'is_symmetric' and 'non_standard_option'.");
             }
+            vector<int> rows = getDistanceRows(flagHandler, store.getDepth());
+            sequenceWeights = store.computeWeights(flagHandler.getFloatValue("threshold"), rows);
+
+            printMSAShape(flagHandler, store.getLength(), rows.size());
+
+            printResults(flagHandler, sequences2num, sequenceWeights, norm, store.getLength());
+            return 0;
+        }
+
+        // merge, without any MSA
+        if (!flagHandler.getFlagValue("merge").empty() && flagHandler.getFlagValue("file").empty())
+        {
+            norm = getNormalization(flagHandler);
+            PartialWeights merged = PartialWeights::merge(flagHandler.getFileArrayValue("merge"));
+            sequenceWeights = merged.getSequenceWeights();
+
+            printMSAShape(flagHandler, merged.length, sequenceWeights.size());
+
+            printResults(flagHandler, sequences2num, sequenceWeights, norm, merged.length);
+            return 0;
         }
 
-        sequences = integratedSequences;
+        sequences = readInputMSA(flagHandler);
+
+        // alphabet
+        alphabet = flagHandler.getAlphabet();
+
+        //depth    
+        depth = flagHandler.getNonZeroIntValue("depth");
 
         setDepth(sequences, depth);
 
+        // weight states find duplicate sequences as read, the same way as integrating MSA files
+        vector<uint64_t> sequenceDigests;
+        if (!flagHandler.getFlagValue("state_out").empty() || !flagHandler.getFlagValue("append").empty())
+        {
+            for (const Sequence& sequence : sequences)
+            {
+                sequenceDigests.push_back(WeightState::getSequenceDigest(sequence.sequence));
+            }
+        }
+
         getPositions(sequences, flagHandler);
 
         // non_standard_option
-        nonStandardOption = getNonStandardOption(flagHandler);
+        nonStandardOption = getNonStandardOptions(flagHandler)[0];
 
         standardLetters = getStandardLetters(alphabet);
         nonStandardLetters = getNonStandardLetters(alphabet);
@@ -860,53 +2466,138 @@ int main(int argc, char **argv)
         // norm
         norm = getNormalization(flagHandler);
 
+        // lists of similarity options
+        if (hasMultipleConfigs(flagHandler))
+        {
+            reportMultiConfigNeff(flagHandler, sequences, getSimilarityConfigs(flagHandler), standardLetters, nonStandardLetters,
+                                  gapCutoff, norm, flagHandler.getNonZeroIntValue("threads"));
+            return 0;
+        }
+
         // threshold
         threshold = flagHandler.getFloatValue("threshold");
         
         // is_symmetric
         isSymmetric = flagHandler.getBooleanValue("is_symmetric");
 
+        // threads
+        int threads = flagHandler.getNonZeroIntValue("threads");
+
+        // select_depth
+        if (!flagHandler.getFlagValue("select_depth").empty())
+        {
+            reportSelectedRows(flagHandler, sequences, sequences2num, threshold, isSymmetric, standardLetters, nonStandardOption, norm);
+            return 0;
+        }
+
+        // weighting
+        if (flagHandler.getFlagValue("weighting") == "henikoff")
+        {
+            reportHenikoffNeff(flagHandler, sequences2num, alphabet, nonStandardOption, norm, threads);
+            return 0;
+        }
+
+        // mask_frac
+        if (!flagHandler.getFlagValue("mask_frac").empty())
+        {
+            reportMaskTrialNeff(flagHandler, sequences, standardLetters, nonStandardLetters, nonStandardOption, gapCutoff,
+                                threshold, isSymmetric, norm, threads);
+            return 0;
+        }
+
+        // window
+        if (!flagHandler.getFlagValue("window").empty())
+        {
+            reportWindowNeff(flagHandler, sequences2num, threshold, isSymmetric, standardLetters, nonStandardOption, norm,
+                             flagHandler.getNonZeroIntValue("window"), threads);
+            return 0;
+        }
+
+        // regions
+        if (!flagHandler.getFlagValue("regions").empty())
+        {
+            reportRegionNeff(flagHandler, sequences, standardLetters, nonStandardLetters, nonStandardOption, gapCutoff,
+                             threshold, isSymmetric, norm, threads);
+            return 0;
+        }
+
+        // append, state_out
+        string appendFile = flagHandler.getFlagValue("append");
+        string stateOutFile = flagHandler.getFlagValue("state_out");
+        WeightState stateParameters = getWeightStateParameters(flagHandler, alphabet, nonStandardOption, threshold, isSymmetric);
+        int appendedCount = 0;
+
+        if (!appendFile.empty())
+        {
+            WeightState state = WeightState::read(flagHandler.getFileValue("append"));
+            state.checkCompatibility(stateParameters, "append");
+
+            // compare only the new sequences against all sequences of the state
+            appendedCount = state.append(sequences2num, sequenceDigests);
+            state.write(stateOutFile.empty() ? appendFile : stateOutFile);
+
+            sequences2num = state.sequences;
+            sequenceWeights = state.sequenceWeights;
+        }
+
         int length = sequences2num[0].size();
 
-        cout << "MSA sequence length: "<< length << endl;
-        cout << "MSA depth:" << sequences2num.size() << endl;
+        printMSAShape(flagHandler, length, sequences2num.size());
+        if (!appendFile.empty() && printsText(flagHandler))
+        {
+            cout << "Appended sequences: " << appendedCount << endl;
+        }
 
         float neff = 0.0;
 
         if (flagHandler.getBooleanValue("multimer_MSA"))
         {
             MultimerHandler multimerHandler(flagHandler.getFlagValue("stoichiom"));
+            bool printsNeff = flagHandler.getFlagValue("output_format") == "text";
+            ResultTable multimerTable = {"multimer", {"msa", "depth", "length"}, {true, false, false}};
 
-            if(multimerHandler.isHomomerFormat())
+            // heteromer MSAs are split first, so that invalid chain lengths fail before comparing any sequences
+            vector<vector<vector<int>>> msas;
+            if (!multimerHandler.isHomomerFormat())
+            {
+                multimerHandler.isHeteromerFormat(); // parses the number of each chain
+                msas = multimerHandler.getHetoromerMSAs(sequences2num, flagHandler.getIntArrayValue("chain_length"));
+            }
+
+            // Entire MSA
+            sequenceWeights = computeWeights(sequences2num, threshold, isSymmetric, standardLetters, nonStandardOption, threads);
+            neff = computeNeff(sequenceWeights, norm, sequences2num[0].size());
+            multimerTable.rows.push_back({"entire", to_string(sequences2num.size()), to_string(length)});
+            multimerTable.neff.push_back(neff);
+            if (printsNeff)
             {
-                // Entire MSA
-                sequenceWeights = computeWeights(sequences2num, threshold, isSymmetric, standardLetters, nonStandardOption);
-                neff = computeNeff(sequenceWeights, norm, sequences2num[0].size());
                 cout << "NEFF of entire MSA:" << neff << endl;
+            }
 
+            if(multimerHandler.isHomomerFormat())
+            {
                 // Individual MSA
                 vector<vector<int>> individualMSA = multimerHandler.getHomomerIndividualMSA(sequences2num);
-                sequenceWeights = computeWeights(individualMSA, threshold, isSymmetric, standardLetters, nonStandardOption);
+                sequenceWeights = computeWeights(individualMSA, threshold, isSymmetric, standardLetters, nonStandardOption, threads);
                 neff = computeNeff(sequenceWeights, norm, individualMSA[0].size());
-                cout << "NEFF of Individual MSA: " << neff << endl;
+                multimerTable.rows.push_back({"individual", to_string(individualMSA.size()), to_string(individualMSA[0].size())});
+                multimerTable.neff.push_back(neff);
+                if (printsNeff)
+                {
+                    cout << "NEFF of Individual MSA: " << neff << endl;
+                }
             }
             else //heteromer format
             {
-                bool isHeteromer = multimerHandler.isHeteromerFormat();
-                vector<int> chainLengths = flagHandler.getIntArrayValue("chain_length");
-
-                vector<vector<vector<int>>> msas = multimerHandler.getHetoromerMSAs(sequences2num, chainLengths);
-
-                // Entire MSA
-                sequenceWeights = computeWeights(sequences2num, threshold, isSymmetric, standardLetters, nonStandardOption);
-                neff = computeNeff(sequenceWeights, norm, sequences2num[0].size());
-                cout << "NEFF of entire MSA:" << neff << endl;
-
                 // Paired MSA
-                sequenceWeights = computeWeights(msas[0], threshold, isSymmetric, standardLetters, nonStandardOption);
+                sequenceWeights = computeWeights(msas[0], threshold, isSymmetric, standardLetters, nonStandardOption, threads);
                 neff = computeNeff(sequenceWeights, norm, msas[0][0].size());
-                cout << "NEFF of Paired MSA (depth=" << msas[0].size() << "): " << neff << endl;
-                            
+                multimerTable.rows.push_back({"paired", to_string(msas[0].size()), to_string(msas[0][0].size())});
+                multimerTable.neff.push_back(neff);
+                if (printsNeff)
+                {
+                    cout << "NEFF of Paired MSA (depth=" << msas[0].size() << "): " << neff << endl;
+                }
 
                 // Individual MSAs
                 for (int i=1; i< msas.size(); i++)
@@ -914,52 +2605,173 @@ int main(int argc, char **argv)
                     string chain = multimerHandler.chainIndexToStoichiomLetter(i-1);
                     if(msas[i].size() == 0)
                     {
-                        cout << "Chain " + chain + " does not have an individual MSA, skipping NEFF calculation..." << endl;
+                        multimerTable.rows.push_back({"individual_" + chain, "0", "0"});
+                        multimerTable.neff.push_back(NAN);
+                        if (printsNeff)
+                        {
+                            cout << "Chain " + chain + " does not have an individual MSA, skipping NEFF calculation..." << endl;
+                        }
                     }
                     else
                     {
-                        sequenceWeights = computeWeights(msas[i], threshold, isSymmetric, standardLetters, nonStandardOption);
+                        sequenceWeights = computeWeights(msas[i], threshold, isSymmetric, standardLetters, nonStandardOption, threads);
                         neff = computeNeff(sequenceWeights, norm, msas[i][0].size());
-                        cout << "NEFF of Individual MSA for Chain " << chain << " (depth=" << msas[i].size()-1 << "): " << neff << endl;
+                        multimerTable.rows.push_back({"individual_" + chain, to_string(msas[i].size()-1),
+                                                      to_string(msas[i][0].size())});
+                        multimerTable.neff.push_back(neff);
+                        if (printsNeff)
+                        {
+                            cout << "NEFF of Individual MSA for Chain " << chain << " (depth=" << msas[i].size()-1 << "): "
+                                 << neff << endl;
+                        }
                     }
                 }
             }
+
+            if (!printsNeff)
+            {
+                writeTableResults(flagHandler, length, sequences2num.size(), multimerTable);
+            }
             return 0;
         }
 
-        sequenceWeights = computeWeights(sequences2num, threshold, isSymmetric, standardLetters, nonStandardOption);
-
-        if(flagHandler.getBooleanValue("only_weights"))
+        if (!flagHandler.getFlagValue("merge").empty())
         {
-            cout << "Sequence weights:" << endl;
-            for (int i=0; i < sequenceWeights.size(); i++)
+            // weights are the sum of partial weights of all shards
+            PartialWeights merged = PartialWeights::merge(flagHandler.getFileArrayValue("merge"));
+            if (merged.inputHash != computeInputHash(sequences2num, threshold, isSymmetric, standardLetters, nonStandardOption))
             {
-                cout << 1./sequenceWeights[i] << ' ';
+                throw runtime_error("Shards are not computed for the given MSA and parameters.");
             }
-            cout << endl << flush;
+            sequenceWeights = merged.getSequenceWeights();
+        }
+        else if (!flagHandler.getFlagValue("shard").empty())
+        {
+            int shard, shardCount;
+            getShard(flagHandler, shard, shardCount);
+
+            PartialWeights partial;
+            partial.inputHash = computeInputHash(sequences2num, threshold, isSymmetric, standardLetters, nonStandardOption);
+            partial.shard = shard;
+            partial.shardCount = shardCount;
+            partial.length = length;
+            partial.sequenceWeights.assign(sequences2num.size(), 0);
+
+            // compare only pairs in the row tiles assigned to the shard
+            vector<int> tiles = getShardTiles(sequences2num.size(), shard, shardCount);
+            SimilarityCalculator similarityCalculator(sequences2num, threshold, isSymmetric, standardLetters, nonStandardOption);
+            similarityCalculator.countHomologsInTiles(tiles, threads, partial.sequenceWeights);
+
+            string shardFile = flagHandler.getFlagValue("shard_out");
+            partial.write(shardFile);
+            cout << "Shard " << shard + 1 << "/" << shardCount << " (" << tiles.size() << " of "
+                 << getTileCount(sequences2num.size()) << " row tiles) written to " << shardFile << endl;
             return 0;
         }
-
-        if(flagHandler.getBooleanValue("residue_neff"))
+        else if (!flagHandler.getFlagValue("depth_curve").empty())
         {
-            vector<float> residueNEFF = computeResidueNEFF(sequences2num, sequenceWeights, norm);
-            cout << "Per-residue (column-wise) NEFF:" << endl;
-            for (int col=0; col < residueNEFF.size(); col++)
+            // weights of all prefixes of the MSA in one pass over the pairs of sequences
+            vector<int> depths = flagHandler.getIntArrayValue("depth_curve");
+            vector<vector<int>> depthWeights = computeDepthCurveWeights(sequences2num, threshold, isSymmetric, standardLetters,
+                                                                        nonStandardOption, depths, threads);
+            ResultTable table = {"depth_curve", {"depth"}, {false}};
+            for (int d = 0; d < depths.size(); d++)
             {
-                cout << residueNEFF[col] << ' ';
+                table.rows.push_back({to_string(depths[d])});
+                table.neff.push_back(computeNeff(depthWeights[d], norm, length));
+            }
+            if (flagHandler.getFlagValue("output_format") != "text")
+            {
+                writeTableResults(flagHandler, length, sequences2num.size(), table);
+                return 0;
+            }
+            for (int d = 0; d < depths.size(); d++)
+            {
+                cout << "NEFF at depth " << depths[d] << ": " << table.neff[d] << endl;
             }
-            // Compute the median of residueNEFF
-            sort(residueNEFF.begin(), residueNEFF.end());
-            float median = residueNEFF.size() % 2 == 0 
-                    ? (residueNEFF[residueNEFF.size()/2 - 1] + residueNEFF[residueNEFF.size()/2]) / 2.0 
-                    : residueNEFF[residueNEFF.size()/2];
-
-            cout << "\nMedian of per-residue (column-wise) NEFF: " << median <<endl << flush;
             return 0;
         }
+        else if (appendFile.empty())
+        {
+            string checkpointFile = flagHandler.getFlagValue("checkpoint");
+            string distancesFile = flagHandler.getFlagValue("distances_out");
+            string neighborsFile = flagHandler.getFlagValue("neighbors_out");
+            if (!neighborsFile.empty())
+            {
+                // homolog graph as a by-product of computing weights
+                NeighborGraph graph;
+                sequenceWeights = computeWeightsAndNeighbors(sequences2num, threshold, isSymmetric, standardLetters, nonStandardOption,
+                                                             threads, flagHandler.getNonZeroIntValue("neighbors_top_k"), graph);
+                if (flagHandler.getFlagValue("neighbors_format") == "tsv")
+                {
+                    graph.writeTSV(neighborsFile);
+                }
+                else
+                {
+                    graph.write(neighborsFile);
+                }
+            }
+            else if (!distancesFile.empty())
+            {
+                // weights are computed from the written pair distances
+                DistanceStore::write(distancesFile, sequences2num, isSymmetric, standardLetters, nonStandardOption,
+                                     flagHandler.getNonZeroIntValue("distance_max"), threads);
+                DistanceStore store(distancesFile);
+                vector<int> rows(sequences2num.size());
+                iota(rows.begin(), rows.end(), 0);
+                sequenceWeights = store.computeWeights(threshold, rows);
+            }
+            else if (!checkpointFile.empty())
+            {
+                sequenceWeights = computeWeightsWithCheckpoint(sequences2num, threshold, isSymmetric, standardLetters, nonStandardOption,
+                                                               threads, checkpointFile, flagHandler.getNonZeroIntValue("checkpoint_interval"),
+                                                               flagHandler.getBooleanValue("resume"));
+            }
+            else if (flagHandler.getBooleanValue("reorder"))
+            {
+                // weights are independent of the order of columns
+                ReorderStats stats;
+                sequenceWeights = computeReorderedWeights(sequences2num, threshold, isSymmetric, standardLetters, nonStandardOption,
+                                                          threads, &stats);
+                if (!stats.denseRows)
+                {
+                    cerr << "Columns are not reordered, as pairs are compared by sparse rows or the block dictionary" << endl;
+                }
+                else
+                {
+                    cerr << "Average columns scanned per pair (sampled): " << stats.scannedBefore << " before reordering, "
+                         << stats.scannedAfter << " after reordering"
+                         << (stats.reordered ? "" : "; columns are not reordered, as too few scans are saved") << endl;
+                }
+            }
+            else
+            {
+                ResultCache cache = getResultCache(flagHandler);
+                sequenceWeights = cache.getWeights(sequences2num, threshold, isSymmetric, standardLetters, nonStandardOption, threads);
+            }
 
-        neff = computeNeff(sequenceWeights, norm, length);
-        cout << "NEFF: " << neff << endl;
+            if (!stateOutFile.empty())
+            {
+                WeightState state = stateParameters;
+                state.sequences = sequences2num;
+                state.sequenceWeights = sequenceWeights;
+                state.sequenceDigests = sequenceDigests;
+                state.write(stateOutFile);
+            }
+        }
+
+        if (!flagHandler.getFlagValue("profile_out").empty() || !flagHandler.getFlagValue("pair_stats_out").empty())
+        {
+            vector<float> weights(sequenceWeights.size());
+            for (int i = 0; i < sequenceWeights.size(); i++)
+            {
+                weights[i] = 1. / sequenceWeights[i];
+            }
+            writeProfile(flagHandler, sequences2num, weights, alphabet, threads);
+            writePairStatistics(flagHandler, sequences2num, weights, alphabet, threads);
+        }
+
+        printResults(flagHandler, sequences2num, sequenceWeights, norm, length);
         
         return 0;
     }
@@ -0,0 +1,1873 @@
+/**
+ * @file neffCalculator.cpp
+ * @brief This file contains the implementation of functions and classes used to compute sequence weights and NEFF.
+ */
+
+#include <vector>
+#include <string>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+#include <cstdlib>
+#include <algorithm>
+#include <numeric>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <exception>
+#include <map>
+#include <unordered_map>
+#include <cstdint>
+#include <random>
+#include <queue>
+#include <tuple>
+#include <limits>
+#include "common.h"
+#include "neffCalculator.h"
+
+using namespace std;
+
+int char2num(char c, const string& standardLetters, const string& nonStandardLetters, NonStandardHandler nonStandardOption)
+{
+    int position;
+    int standardLetterSize = standardLetters.size();
+
+    position = standardLetters.find(c);
+
+    if (position != string::npos) // standard
+    {
+        return position+1;
+    }
+    else if (nonStandardOption == AsStandard || nonStandardOption == ConsiderGapInCutoff) // behave like standard ones
+    {
+        position = nonStandardLetters.find(c);
+
+        if (position != string::npos)
+        {
+            return position + standardLetterSize + 1; // non-standard
+        }
+    }
+    return 0; // condier as gap
+}
+
+vector<int> getGappyPositions(const vector<vector<int>>& sequences, float gapCutoff)
+{
+    const vector<int>& querySequence = sequences[0];
+    int length = querySequence.size();
+    int depth = sequences.size();
+    int gapCutoffNo = depth * gapCutoff;
+    vector<int> removingPositions;
+    int i, j;
+
+    // find gappy positions
+    for(i = length-1; i >= 0; i--)
+    {
+        int gapCount = 0;
+        for(j = 0; j < depth; j++)
+        {
+            if(sequences[j][i] == 0)
+            {
+                gapCount++;
+            }
+        }
+        if(gapCount >= gapCutoffNo)
+        {
+            removingPositions.push_back(i);
+        }
+    }
+    return removingPositions;
+}
+
+void removeGappyPositions(vector<vector<int>>& sequences, float gapCutoff)
+{
+    vector<int> removingPositions = getGappyPositions(sequences, gapCutoff);
+
+    //remove gappy positions from all sequences
+    for (auto& sequence : sequences)
+    {
+        for (int pos : removingPositions)
+        {
+            sequence.erase(sequence.begin() + pos);
+        }
+    }
+}
+
+vector<vector<int>> processSequences(vector<Sequence> sequences, string standardLetters,
+                                    string nonStandardLetters, NonStandardHandler nonStandardOption, float gapCutoff)
+{
+    vector<vector<int>> sequences2num;
+    if(sequences.size() == 0)
+    {
+        return sequences2num;
+    }
+
+    string querySequence = sequences[0].sequence;
+
+
+    // map letters to numbers
+    vector<int> sequence2num;
+    int length = querySequence.length();
+
+    for (auto sequence : sequences)
+    {
+        sequence2num = {};
+        for (int position = 0; position < length; position++)
+        {
+            sequence2num.push_back(char2num(sequence.sequence[position], standardLetters,
+                                            nonStandardLetters, nonStandardOption));
+        }
+        sequences2num.push_back(sequence2num);
+    }
+
+    if(gapCutoff < 1)
+    {
+        removeGappyPositions(sequences2num, gapCutoff);
+    }
+
+    return sequences2num;
+}
+
+bool isCountedInCutoff(int residue, const string& standardLetters, NonStandardHandler nonStandardOption)
+{
+    return !((nonStandardOption == ConsiderGapInCutoff && (residue == 0 || residue > standardLetters.size()))
+             || (nonStandardOption != ConsiderGap && residue == 0));
+}
+
+int getTileCount(int depth)
+{
+    return (depth + TILE_SIZE - 1) / TILE_SIZE;
+}
+
+vector<int> getShardTiles(int depth, int shard, int shardCount)
+{
+    int tileCount = getTileCount(depth);
+
+    // number of pairs in each tile
+    vector<long long> pairs(tileCount, 0);
+    for (int i = 0; i < depth; i++)
+    {
+        pairs[i / TILE_SIZE] += depth - 1 - i;
+    }
+
+    // assign the largest remaining tile to the least loaded shard
+    vector<int> order(tileCount);
+    iota(order.begin(), order.end(), 0);
+    stable_sort(order.begin(), order.end(), [&](int a, int b) { return pairs[a] > pairs[b]; });
+
+    vector<long long> load(shardCount, 0);
+    vector<int> tiles;
+    for (int tile : order)
+    {
+        int leastLoaded = min_element(load.begin(), load.end()) - load.begin();
+        load[leastLoaded] += pairs[tile];
+        if (leastLoaded == shard)
+        {
+            tiles.push_back(tile);
+        }
+    }
+    sort(tiles.begin(), tiles.end());
+    return tiles;
+}
+
+// Number of columns of each block of the block dictionary
+const int DICTIONARY_BLOCK_SIZE = 32;
+// Largest number of distinct contents of blocks, relative to the number of blocks of all rows, to use the block dictionary
+const float DICTIONARY_MAX_RATIO = 0.25;
+// Largest number of entries of mismatch tables of all blocks to use the block dictionary
+const long long DICTIONARY_MAX_ENTRIES = 1LL << 28;
+
+// Largest average fraction of columns covered by sequences (from their first to last residue) to use sparse rows
+const float SPARSE_MAX_COVERAGE = 0.5;
+
+SimilarityCalculator::SimilarityCalculator(const vector<vector<int>>& _sequences, float threshold, bool _isSymmetric,
+                                           const string& standardLetters, NonStandardHandler nonStandardOption)
+    : sequences(_sequences), isSymmetric(_isSymmetric)
+{
+    if(sequences.size() == 0)
+    {
+        throw runtime_error("There is no sequence to compute weights for.");
+    }
+
+    length = sequences[0].size();
+
+    int position;
+    int non_gap_count;
+    vector <bool> non_gap_seq; // keeps positions of residues in a sequence
+    non_gap_seq.assign(length, 0);
+
+    // computeing cutoff for each sequence
+    // and keeping non-gap positions in non_gap_msa for asymmetric option
+    if (isSymmetric)
+    {
+        cutoff.push_back(length * (1-threshold));
+    }
+    else
+    {
+        for (const auto& sequence : sequences)
+        {
+            non_gap_count = 0;
+            // finding non-gap positions of the sequence
+            for (position = 0; position < length; position++)
+            {
+                if (isCountedInCutoff(sequence[position], standardLetters, nonStandardOption))
+                {
+                    non_gap_count++;
+                    non_gap_seq[position] = 1;
+                }
+                else
+                {
+                    non_gap_seq[position] = 0;
+                }
+            }
+            non_gap_msa.push_back(non_gap_seq);
+            cutoff.push_back(non_gap_count * (1-threshold));
+        }
+    }
+
+    // choose sparse rows when sequences cover less than SPARSE_MAX_COVERAGE of the columns on average
+    long long covered = 0;
+    for (const auto& sequence : sequences)
+    {
+        auto first = find_if(sequence.begin(), sequence.end(), [](int residue) { return residue != 0; });
+        auto last = find_if(sequence.rbegin(), sequence.rend(), [](int residue) { return residue != 0; });
+        covered += max<long long>(0, (sequence.rend() - last) - (first - sequence.begin()));
+    }
+    if (!buildBlockDictionary(standardLetters, nonStandardOption) && covered < SPARSE_MAX_COVERAGE * length * sequences.size())
+    {
+        buildSparseRows(standardLetters, nonStandardOption);
+    }
+}
+
+bool SimilarityCalculator::buildBlockDictionary(const string& standardLetters, NonStandardHandler nonStandardOption)
+{
+    int depth = sequences.size();
+    blockCount = (length + DICTIONARY_BLOCK_SIZE - 1) / DICTIONARY_BLOCK_SIZE;
+
+    // index of distinct contents of each block
+    vector<uint32_t> blocks((size_t)depth * blockCount);
+    vector<vector<string>> contents(blockCount);
+    long long distinctCount = 0, tableSize = 0;
+    for (int b = 0; b < blockCount; b++)
+    {
+        int blockStart = b * DICTIONARY_BLOCK_SIZE;
+        int blockEnd = min(blockStart + DICTIONARY_BLOCK_SIZE, length);
+        unordered_map<string, uint32_t> contentIndex;
+        for (int i = 0; i < depth; i++)
+        {
+            string content(sequences[i].begin() + blockStart, sequences[i].begin() + blockEnd);
+            auto inserted = contentIndex.emplace(content, contents[b].size());
+            if (inserted.second)
+            {
+                contents[b].push_back(content);
+            }
+            blocks[(size_t)i * blockCount + b] = inserted.first->second;
+        }
+        distinctCount += contents[b].size();
+        tableSize += (long long)contents[b].size() * contents[b].size();
+
+        // fall back when the rows are not compressed enough
+        if (distinctCount > DICTIONARY_MAX_RATIO * depth * blockCount || tableSize > DICTIONARY_MAX_ENTRIES)
+        {
+            return false;
+        }
+    }
+
+    dictionary = true;
+    rowBlocks = move(blocks);
+    for (int b = 0; b < blockCount; b++)
+    {
+        int distinct = contents[b].size();
+        distinctBlocks.push_back(distinct);
+        tableOffset.push_back(blockMismatches.size());
+        blockMismatches.resize(blockMismatches.size() + (size_t)distinct * distinct);
+        uint8_t* table = blockMismatches.data() + tableOffset[b];
+
+        for (int x = 0; x < distinct; x++)
+        {
+            const string& content_x = contents[b][x];
+            for (int y = 0; y < distinct; y++)
+            {
+                const string& content_y = contents[b][y];
+                int mismatch = 0;
+                for (int position = 0; position < content_x.size(); position++)
+                {
+                    if (content_x[position] != content_y[position])
+                    {
+                        mismatch += isSymmetric || isCountedInCutoff(content_x[position], standardLetters, nonStandardOption);
+                    }
+                }
+                table[(size_t)x * distinct + y] = mismatch;
+            }
+        }
+    }
+    return true;
+}
+
+void SimilarityCalculator::compareBlocks(int i, int j, int& mismatch_i, int& mismatch_j) const
+{
+    const uint32_t* blocks_i = rowBlocks.data() + (size_t)i * blockCount;
+    const uint32_t* blocks_j = rowBlocks.data() + (size_t)j * blockCount;
+
+    for (int b = 0; b < blockCount; b++)
+    {
+        uint32_t x = blocks_i[b], y = blocks_j[b];
+        if (x == y) // identical contents
+        {
+            continue;
+        }
+        const uint8_t* table = blockMismatches.data() + tableOffset[b];
+        size_t distinct = distinctBlocks[b];
+        mismatch_i += table[x * distinct + y];
+        if (isSymmetric)
+        {
+            if (mismatch_i > cutoff[0])
+            {
+                // no need to iterate more when already found cutoff mismatches this pair
+                break;
+            }
+        }
+        else
+        {
+            mismatch_j += table[y * distinct + x];
+            if ((mismatch_i > cutoff[i]) && (mismatch_j > cutoff[j]))
+            {
+                // no need to iterate more when found unsimilarity threshhold for this pair
+                break;
+            }
+        }
+    }
+    if (isSymmetric)
+    {
+        mismatch_j = mismatch_i;
+    }
+}
+
+void SimilarityCalculator::buildSparseRows(const string& standardLetters, NonStandardHandler nonStandardOption)
+{
+    sparse = true;
+    gapCounted = isCountedInCutoff(0, standardLetters, nonStandardOption);
+
+    for (int i = 0; i < sequences.size(); i++)
+    {
+        const vector<int>& sequence = sequences[i];
+        int start = 0, end = length;
+        while (start < length && sequence[start] == 0) start++;
+        while (end > start && sequence[end - 1] == 0) end--;
+
+        coverageStart.push_back(start);
+        coverageEnd.push_back(end);
+        coverageOffset.push_back(coveredResidues.size());
+
+        int residues = 0, counted = 0;
+        for (int position = start; position < end; position++)
+        {
+            residuePrefix.push_back(residues);
+            countedPrefix.push_back(counted);
+            coveredResidues.push_back(sequence[position]);
+            bool countedResidue = !isSymmetric && non_gap_msa[i][position];
+            coveredCounted.push_back(countedResidue);
+            residues += (sequence[position] != 0);
+            counted += (sequence[position] != 0) && countedResidue;
+        }
+        residuePrefix.push_back(residues);
+        countedPrefix.push_back(counted);
+    }
+}
+
+void SimilarityCalculator::compareSparse(int i, int j, int& mismatch_i, int& mismatch_j) const
+{
+    int start_i = coverageStart[i], end_i = coverageEnd[i];
+    int start_j = coverageStart[j], end_j = coverageEnd[j];
+    int overlapStart = max(start_i, start_j);
+    int overlapEnd = max(overlapStart, min(end_i, end_j));
+
+    // number of residues (or residues counted in mismatches) of a row in [start, end), within its interval
+    auto countIn = [&](const vector<int>& prefix, int row, int start, int end)
+    {
+        if (end <= start)
+        {
+            return 0;
+        }
+        size_t base = coverageOffset[row] + row - coverageStart[row];
+        return prefix[base + end] - prefix[base + start];
+    };
+
+    // outside the overlap, residues of each sequence are aligned to gaps of the other one
+    int onlyResidues_i = countIn(residuePrefix, i, start_i, end_i) - countIn(residuePrefix, i, overlapStart, overlapEnd);
+    int onlyResidues_j = countIn(residuePrefix, j, start_j, end_j) - countIn(residuePrefix, j, overlapStart, overlapEnd);
+
+    const uint8_t* residues_i = coveredResidues.data() + coverageOffset[i] - start_i;
+    const uint8_t* residues_j = coveredResidues.data() + coverageOffset[j] - start_j;
+
+    if (isSymmetric)
+    {
+        mismatch_i = onlyResidues_i + onlyResidues_j;
+        for (int position = overlapStart; position < overlapEnd && mismatch_i <= cutoff[0]; position++)
+        {
+            mismatch_i += (residues_i[position] != residues_j[position]);
+        }
+        mismatch_j = mismatch_i;
+        return;
+    }
+
+    mismatch_i = countIn(countedPrefix, i, start_i, end_i) - countIn(countedPrefix, i, overlapStart, overlapEnd)
+                 + gapCounted * onlyResidues_j;
+    mismatch_j = countIn(countedPrefix, j, start_j, end_j) - countIn(countedPrefix, j, overlapStart, overlapEnd)
+                 + gapCounted * onlyResidues_i;
+
+    const uint8_t* counted_i = coveredCounted.data() + coverageOffset[i] - start_i;
+    const uint8_t* counted_j = coveredCounted.data() + coverageOffset[j] - start_j;
+    for (int position = overlapStart; position < overlapEnd; position++)
+    {
+        if (residues_i[position] == residues_j[position])
+        {
+            continue;
+        }
+        mismatch_i += counted_i[position];
+        mismatch_j += counted_j[position];
+        if ((mismatch_i > cutoff[i]) && (mismatch_j > cutoff[j]))
+        {
+            // no need to iterate more when found unsimilarity threshhold for this pair
+            break;
+        }
+    }
+}
+
+void SimilarityCalculator::compare(int i, int j, bool& similarToI, bool& similarToJ) const
+{
+    int mismatch_i, mismatch_j; // # mismatches in i'th and j'th sequences
+    compare(i, j, similarToI, similarToJ, mismatch_i, mismatch_j);
+}
+
+void SimilarityCalculator::compare(int i, int j, bool& similarToI, bool& similarToJ, int& mismatch_i, int& mismatch_j) const
+{
+    const vector<int>& sequence_i = sequences[i];
+    const vector<int>& sequence_j = sequences[j];
+    mismatch_i = 0;
+    mismatch_j = 0;
+
+    if (dictionary)
+    {
+        compareBlocks(i, j, mismatch_i, mismatch_j);
+    }
+    else if (sparse)
+    {
+        compareSparse(i, j, mismatch_i, mismatch_j);
+    }
+    else
+    {
+        for (int position = 0; position < length; position++)
+        {
+            if (sequence_i[position] == sequence_j[position]) // position match
+            {
+                continue;
+            }
+            if (isSymmetric)
+            {
+                // increment both sequences when there is a position mismatch
+                mismatch_i++;
+                mismatch_j++;
+                if (mismatch_i > cutoff[0])
+                {
+                    // no need to iterate more when already found cutoff mismatches this pair
+                    break;
+                }
+            }
+            else //asymmetric
+            {
+                mismatch_i += non_gap_msa[i][position]; // increment mismatches if this position is non-gap
+                mismatch_j += non_gap_msa[j][position];
+
+                if ((mismatch_i > cutoff[i]) && (mismatch_j > cutoff[j]))
+                {
+                    // no need to iterate more when found unsimilarity threshhold for this pair
+                    break;
+                }
+            }
+        }
+    }
+    if(isSymmetric)
+    {
+        similarToI = (mismatch_i <= cutoff[0]);
+        similarToJ = (mismatch_j <= cutoff[0]);
+    }
+    else
+    {
+        similarToI = (mismatch_i <= cutoff[i]);
+        similarToJ = (mismatch_j <= cutoff[j]);
+    }
+}
+
+int SimilarityCalculator::countScannedPositions(int i, int j) const
+{
+    const vector<int>& sequence_i = sequences[i];
+    const vector<int>& sequence_j = sequences[j];
+    int mismatch_i = 0;
+    int mismatch_j = 0;
+
+    for (int position = 0; position < length; position++)
+    {
+        if (sequence_i[position] == sequence_j[position])
+        {
+            continue;
+        }
+        if (isSymmetric)
+        {
+            mismatch_i++;
+            if (mismatch_i > cutoff[0])
+            {
+                return position + 1;
+            }
+        }
+        else
+        {
+            mismatch_i += non_gap_msa[i][position];
+            mismatch_j += non_gap_msa[j][position];
+            if ((mismatch_i > cutoff[i]) && (mismatch_j > cutoff[j]))
+            {
+                return position + 1;
+            }
+        }
+    }
+    return length;
+}
+
+void SimilarityCalculator::countMismatches(int i, int j, int maxMismatches, int& mismatch_i, int& mismatch_j) const
+{
+    const vector<int>& sequence_i = sequences[i];
+    const vector<int>& sequence_j = sequences[j];
+    mismatch_i = 0;
+    mismatch_j = 0;
+
+    for (int position = 0; position < length; position++)
+    {
+        if (sequence_i[position] == sequence_j[position])
+        {
+            continue;
+        }
+        if (isSymmetric)
+        {
+            mismatch_i++;
+            mismatch_j++;
+        }
+        else
+        {
+            mismatch_i += non_gap_msa[i][position];
+            mismatch_j += non_gap_msa[j][position];
+        }
+        if (mismatch_i >= maxMismatches && mismatch_j >= maxMismatches)
+        {
+            break;
+        }
+    }
+}
+
+bool SimilarityCalculator::usesDenseRows() const
+{
+    return !dictionary && !sparse;
+}
+
+int SimilarityCalculator::getNonGapCount(int i) const
+{
+    return isSymmetric ? length : count(non_gap_msa[i].begin(), non_gap_msa[i].end(), true);
+}
+
+void SimilarityCalculator::countHomologs(int firstStart, int firstEnd, int secondStart, int secondEnd,
+                                         vector<int>& sequenceWeights) const
+{
+    bool similarToI, similarToJ;
+
+    for (int i = firstStart; i < firstEnd; i++)
+    {
+        bool iInSecond = (i >= secondStart && i < secondEnd);
+
+        for (int j = secondStart; j < secondEnd; j++)
+        {
+            // compare each pair once when both sequences are in both ranges
+            if (j == i || (iInSecond && j < i && j >= firstStart))
+            {
+                continue;
+            }
+            compare(i, j, similarToI, similarToJ);
+            sequenceWeights[i] += similarToI;
+            sequenceWeights[j] += similarToJ;
+        }
+    }
+}
+
+void SimilarityCalculator::countHomologsInTiles(const vector<int>& tiles, int threads, vector<int>& sequenceWeights,
+                                                const function<void(const TileProgress&)>& onProgress,
+                                                int progressInterval, chrono::steady_clock::time_point deadline) const
+{
+    int depth = sequences.size();
+    threads = max(1, min(threads, (int)tiles.size()));
+
+    // homologs found by each thread within its completed tiles;
+    // a tile is counted in a separate buffer first, so that the progress only includes completed tiles
+    struct ThreadProgress
+    {
+        mutex lock;
+        TileProgress progress;
+    };
+    vector<ThreadProgress> threadProgress(threads);
+
+    atomic<size_t> nextTile(0);
+    atomic<bool> expired(false);
+    bool hasDeadline = deadline != chrono::steady_clock::time_point::max();
+
+    auto countTiles = [&](int thread)
+    {
+        TileProgress& progress = threadProgress[thread].progress;
+        progress.sequenceWeights.assign(depth, 0);
+        vector<int> tileWeights(depth, 0);
+        bool similarToI, similarToJ;
+        size_t k;
+
+        while ((k = nextTile++) < tiles.size())
+        {
+            if (hasDeadline && (expired || chrono::steady_clock::now() >= deadline))
+            {
+                expired = true;
+                break;
+            }
+            int tileStart = tiles[k] * TILE_SIZE;
+            int tileEnd = min(tileStart + TILE_SIZE, depth);
+            for (int i = tileStart; i < tileEnd; i++)
+            {
+                for (int j = i+1; j < depth; j++)
+                {
+                    compare(i, j, similarToI, similarToJ);
+                    tileWeights[i] += similarToI;
+                    tileWeights[j] += similarToJ;
+                }
+            }
+
+            // only rows from the start of the tile are updated by its pairs
+            lock_guard<mutex> guard(threadProgress[thread].lock);
+            for (int i = tileStart; i < depth; i++)
+            {
+                progress.sequenceWeights[i] += tileWeights[i];
+                tileWeights[i] = 0;
+            }
+            progress.completedTiles.push_back(tiles[k]);
+        }
+    };
+
+    auto snapshot = [&]()
+    {
+        TileProgress total;
+        total.sequenceWeights.assign(depth, 0);
+        for (auto& thread : threadProgress)
+        {
+            lock_guard<mutex> guard(thread.lock);
+            const TileProgress& progress = thread.progress;
+            total.completedTiles.insert(total.completedTiles.end(), progress.completedTiles.begin(), progress.completedTiles.end());
+            for (int i = 0; i < progress.sequenceWeights.size(); i++)
+            {
+                total.sequenceWeights[i] += progress.sequenceWeights[i];
+            }
+        }
+        return total;
+    };
+
+    // report progress periodically from a separate thread; reporting (e.g. writing a file) is done without any lock held
+    mutex doneLock;
+    condition_variable doneCondition;
+    bool done = false;
+    exception_ptr progressError;
+    thread reporter;
+    if (onProgress && progressInterval > 0)
+    {
+        reporter = thread([&]()
+        {
+            unique_lock<mutex> doneGuard(doneLock);
+            while (!doneCondition.wait_for(doneGuard, chrono::seconds(progressInterval), [&]() { return done; }))
+            {
+                doneGuard.unlock();
+                try
+                {
+                    onProgress(snapshot());
+                }
+                catch (...)
+                {
+                    progressError = current_exception();
+                    return;
+                }
+                doneGuard.lock();
+            }
+        });
+    }
+
+    vector<thread> workers;
+    for (int t = 1; t < threads; t++)
+    {
+        workers.emplace_back(countTiles, t);
+    }
+    countTiles(0);
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+
+    if (reporter.joinable())
+    {
+        {
+            lock_guard<mutex> doneGuard(doneLock);
+            done = true;
+        }
+        doneCondition.notify_one();
+        reporter.join();
+    }
+    if (progressError)
+    {
+        rethrow_exception(progressError);
+    }
+    if (expired)
+    {
+        throw runtime_error("The computation of sequence weights exceeded its time limit.");
+    }
+
+    TileProgress total = snapshot();
+    if (onProgress)
+    {
+        onProgress(total);
+    }
+    for (int i = 0; i < depth; i++)
+    {
+        sequenceWeights[i] += total.sequenceWeights[i];
+    }
+}
+
+vector<int> computeWeights(const vector<vector<int>>& sequences, float threshold, bool isSymmetric,
+                     const string& standardLetters, NonStandardHandler nonStandardOption, int threads,
+                     chrono::steady_clock::time_point deadline)
+{
+    int msa_depth = sequences.size();
+
+    if(msa_depth == 0)
+    {
+        throw runtime_error("There is no sequence to compute weights for.");
+    }
+
+    SimilarityCalculator similarityCalculator(sequences, threshold, isSymmetric, standardLetters, nonStandardOption);
+
+    vector<int> sequence_weight(msa_depth, 1); // number of homolog sequences to each sequence
+
+    // iterate through each pair of sequence and compute sequence weights
+    vector<int> tiles(getTileCount(msa_depth));
+    iota(tiles.begin(), tiles.end(), 0);
+    similarityCalculator.countHomologsInTiles(tiles, threads, sequence_weight, nullptr, 0, deadline);
+
+    return sequence_weight;
+}
+
+// Maximum number of pairs of sequences sampled to compare the number of scanned positions
+const int SCAN_SAMPLE_PAIRS = 10000;
+// Largest ratio of scanned positions after and before reordering columns to reorder them; comparing reordered columns
+// mispredicts more branches, so fewer scanned positions alone do not make it faster
+const float REORDER_MAX_SCAN_RATIO = 0.75;
+
+vector<int> computeReorderedWeights(const vector<vector<int>>& sequences, float threshold, bool isSymmetric,
+                                    const string& standardLetters, NonStandardHandler nonStandardOption,
+                                    int threads, ReorderStats* stats)
+{
+    int depth = sequences.size();
+    if (depth == 0)
+    {
+        throw runtime_error("There is no sequence to compute weights for.");
+    }
+    int length = sequences[0].size();
+
+    vector<int> sequenceWeights(depth, 1); // number of homolog sequences to each sequence
+    vector<int> tiles(getTileCount(depth));
+    iota(tiles.begin(), tiles.end(), 0);
+
+    ReorderStats reorderStats = {false, 0, 0, false};
+    SimilarityCalculator originalCalculator(sequences, threshold, isSymmetric, standardLetters, nonStandardOption);
+    if (!originalCalculator.usesDenseRows())
+    {
+        if (stats != nullptr)
+        {
+            *stats = reorderStats;
+        }
+        originalCalculator.countHomologsInTiles(tiles, threads, sequenceWeights);
+        return sequenceWeights;
+    }
+
+    // columns in decreasing order of entropy of their residues (gaps included)
+    vector<float> entropy(length, 0);
+    for (int position = 0; position < length; position++)
+    {
+        map<int, int> counts;
+        for (const auto& sequence : sequences)
+        {
+            counts[sequence[position]]++;
+        }
+        for (const auto& count : counts)
+        {
+            float frequency = float(count.second) / depth;
+            entropy[position] -= frequency * log(frequency);
+        }
+    }
+    vector<int> columnOrder(length);
+    iota(columnOrder.begin(), columnOrder.end(), 0);
+    stable_sort(columnOrder.begin(), columnOrder.end(), [&](int a, int b) { return entropy[a] > entropy[b]; });
+
+    vector<vector<int>> reordered(depth, vector<int>(length));
+    for (int i = 0; i < depth; i++)
+    {
+        for (int position = 0; position < length; position++)
+        {
+            reordered[i][position] = sequences[i][columnOrder[position]];
+        }
+    }
+    SimilarityCalculator similarityCalculator(reordered, threshold, isSymmetric, standardLetters, nonStandardOption);
+
+    long long pairs = (long long)depth * (depth - 1) / 2;
+    long long samples = min<long long>(pairs, SCAN_SAMPLE_PAIRS);
+    mt19937 generator(0);
+    uniform_int_distribution<int> distribution(0, depth - 1);
+    long long scannedBefore = 0, scannedAfter = 0;
+    for (long long s = 0; s < samples; s++)
+    {
+        int i = distribution(generator);
+        int j = distribution(generator);
+        if (i == j)
+        {
+            // pairs are sampled among distinct rows
+            s--;
+            continue;
+        }
+        scannedBefore += originalCalculator.countScannedPositions(min(i, j), max(i, j));
+        scannedAfter += similarityCalculator.countScannedPositions(min(i, j), max(i, j));
+    }
+    reorderStats.denseRows = true;
+    reorderStats.scannedBefore = samples > 0 ? float(scannedBefore) / samples : 0;
+    reorderStats.scannedAfter = samples > 0 ? float(scannedAfter) / samples : 0;
+    reorderStats.reordered = scannedAfter <= REORDER_MAX_SCAN_RATIO * scannedBefore;
+    if (stats != nullptr)
+    {
+        *stats = reorderStats;
+    }
+
+    // weights are independent of the order of columns
+    (reorderStats.reordered ? similarityCalculator : originalCalculator).countHomologsInTiles(tiles, threads, sequenceWeights);
+    return sequenceWeights;
+}
+
+vector<vector<int>> computeDepthCurveWeights(const vector<vector<int>>& sequences, float threshold, bool isSymmetric,
+                                             const string& standardLetters, NonStandardHandler nonStandardOption,
+                                             const vector<int>& depths, int threads)
+{
+    SimilarityCalculator similarityCalculator(sequences, threshold, isSymmetric, standardLetters, nonStandardOption);
+
+    // distinct depths in increasing order; pairs of rows beyond the largest one are not compared
+    vector<int> sortedDepths;
+    for (int depth : depths)
+    {
+        sortedDepths.push_back(min(depth, (int)sequences.size()));
+    }
+    sort(sortedDepths.begin(), sortedDepths.end());
+    sortedDepths.erase(unique(sortedDepths.begin(), sortedDepths.end()), sortedDepths.end());
+
+    int maxDepth = sortedDepths.back();
+    int bucketCount = sortedDepths.size();
+    int tileCount = getTileCount(maxDepth);
+    threads = max(1, min(threads, tileCount));
+
+    // homologs found by pairs (i, j) with sortedDepths[b-1] <= j < sortedDepths[b], by each thread
+    atomic<int> nextTile(0);
+    // (both rows of such pairs are below sortedDepths[b])
+    vector<vector<vector<int>>> threadBuckets(threads, vector<vector<int>>(bucketCount));
+    for (auto& buckets : threadBuckets)
+    {
+        for (int b = 0; b < bucketCount; b++)
+        {
+            buckets[b].assign(sortedDepths[b], 0);
+        }
+    }
+
+    auto countTiles = [&](int thread)
+    {
+        vector<vector<int>>& buckets = threadBuckets[thread];
+        bool similarToI, similarToJ;
+        int tile;
+
+        while ((tile = nextTile++) < tileCount)
+        {
+            int tileEnd = min((tile + 1) * TILE_SIZE, maxDepth);
+            for (int i = tile * TILE_SIZE; i < tileEnd; i++)
+            {
+                int b = 0;
+                for (int j = i+1; j < maxDepth; j++)
+                {
+                    while (j >= sortedDepths[b])
+                    {
+                        b++;
+                    }
+                    similarityCalculator.compare(i, j, similarToI, similarToJ);
+                    buckets[b][i] += similarToI;
+                    buckets[b][j] += similarToJ;
+                }
+            }
+        }
+    };
+
+    vector<thread> workers;
+    for (int t = 1; t < threads; t++)
+    {
+        workers.emplace_back(countTiles, t);
+    }
+    countTiles(0);
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+
+    // weights at each depth are the sum of the buckets up to that depth
+    vector<vector<int>> bucketWeights(bucketCount);
+    vector<int> weights(maxDepth, 1); // number of homolog sequences to each sequence
+    for (int b = 0; b < bucketCount; b++)
+    {
+        for (const auto& buckets : threadBuckets)
+        {
+            for (int i = 0; i < sortedDepths[b]; i++)
+            {
+                weights[i] += buckets[b][i];
+            }
+        }
+        bucketWeights[b].assign(weights.begin(), weights.begin() + sortedDepths[b]);
+    }
+
+    vector<vector<int>> depthWeights;
+    for (int depth : depths)
+    {
+        int b = lower_bound(sortedDepths.begin(), sortedDepths.end(), min(depth, (int)sequences.size())) - sortedDepths.begin();
+        depthWeights.push_back(bucketWeights[b]);
+    }
+    return depthWeights;
+}
+
+vector<vector<int>> computeMultiConfigWeights(const vector<vector<int>>& sequences, const vector<SimilarityConfig>& configs,
+                                              const string& standardLetters, int threads)
+{
+    int depth = sequences.size();
+    if (depth == 0)
+    {
+        throw runtime_error("There is no sequence to compute weights for.");
+    }
+    int length = sequences[0].size();
+    int configCount = configs.size();
+
+    // positions counted in mismatches of asymmetric configurations, one mask for each non-standard option
+    vector<NonStandardHandler> maskOptions;
+    vector<int> configMask(configCount, -1);
+    for (int c = 0; c < configCount; c++)
+    {
+        if (!configs[c].isSymmetric)
+        {
+            auto option = find(maskOptions.begin(), maskOptions.end(), configs[c].nonStandardOption);
+            configMask[c] = option - maskOptions.begin();
+            if (option == maskOptions.end())
+            {
+                maskOptions.push_back(configs[c].nonStandardOption);
+            }
+        }
+    }
+    int maskCount = maskOptions.size();
+
+    vector<vector<vector<char>>> non_gap_msa(maskCount, vector<vector<char>>(depth, vector<char>(length, 0)));
+    vector<vector<int>> non_gap_count(maskCount, vector<int>(depth, 0));
+    for (int m = 0; m < maskCount; m++)
+    {
+        NonStandardHandler nonStandardOption = maskOptions[m];
+        for (int i = 0; i < depth; i++)
+        {
+            for (int position = 0; position < length; position++)
+            {
+                if (isCountedInCutoff(sequences[i][position], standardLetters, nonStandardOption))
+                {
+                    non_gap_msa[m][i][position] = 1;
+                    non_gap_count[m][i]++;
+                }
+            }
+        }
+    }
+
+    // cutoffs of each configuration, and the largest cutoffs to stop counting mismatches of a pair
+    vector<vector<int>> cutoff(configCount);
+    int maxSymmetricCutoff = -1;
+    vector<vector<int>> maxCutoff(maskCount, vector<int>(depth, -1));
+    for (int c = 0; c < configCount; c++)
+    {
+        float threshold = configs[c].threshold;
+        if (configs[c].isSymmetric)
+        {
+            cutoff[c].push_back(length * (1-threshold));
+            maxSymmetricCutoff = max(maxSymmetricCutoff, cutoff[c][0]);
+        }
+        else
+        {
+            int m = configMask[c];
+            for (int i = 0; i < depth; i++)
+            {
+                cutoff[c].push_back(non_gap_count[m][i] * (1-threshold));
+                maxCutoff[m][i] = max(maxCutoff[m][i], cutoff[c][i]);
+            }
+        }
+    }
+
+    int tileCount = getTileCount(depth);
+    threads = max(1, min(threads, tileCount));
+    atomic<int> nextTile(0);
+    vector<vector<vector<int>>> threadWeights(threads, vector<vector<int>>(configCount, vector<int>(depth, 0)));
+
+    auto countTiles = [&](int thread)
+    {
+        vector<vector<int>>& weights = threadWeights[thread];
+        vector<int> mismatch_i(maskCount), mismatch_j(maskCount); // # mismatches in i'th and j'th sequences of each mask
+        int tile;
+
+        while ((tile = nextTile++) < tileCount)
+        {
+            int tileEnd = min((tile + 1) * TILE_SIZE, depth);
+            for (int i = tile * TILE_SIZE; i < tileEnd; i++)
+            {
+                for (int j = i+1; j < depth; j++)
+                {
+                    const vector<int>& sequence_i = sequences[i];
+                    const vector<int>& sequence_j = sequences[j];
+                    int mismatch = 0;
+                    fill(mismatch_i.begin(), mismatch_i.end(), 0);
+                    fill(mismatch_j.begin(), mismatch_j.end(), 0);
+
+                    for (int position = 0; position < length; position++)
+                    {
+                        if (sequence_i[position] == sequence_j[position])
+                        {
+                            continue;
+                        }
+                        mismatch++;
+                        bool similarInAny = (mismatch <= maxSymmetricCutoff);
+                        for (int m = 0; m < maskCount; m++)
+                        {
+                            mismatch_i[m] += non_gap_msa[m][i][position];
+                            mismatch_j[m] += non_gap_msa[m][j][position];
+                            similarInAny |= (mismatch_i[m] <= maxCutoff[m][i]) || (mismatch_j[m] <= maxCutoff[m][j]);
+                        }
+                        if (!similarInAny)
+                        {
+                            // no need to iterate more when the pair is not similar in any configuration
+                            break;
+                        }
+                    }
+
+                    for (int c = 0; c < configCount; c++)
+                    {
+                        if (configs[c].isSymmetric)
+                        {
+                            bool similar = (mismatch <= cutoff[c][0]);
+                            weights[c][i] += similar;
+                            weights[c][j] += similar;
+                        }
+                        else
+                        {
+                            int m = configMask[c];
+                            weights[c][i] += (mismatch_i[m] <= cutoff[c][i]);
+                            weights[c][j] += (mismatch_j[m] <= cutoff[c][j]);
+                        }
+                    }
+                }
+            }
+        }
+    };
+
+    vector<thread> workers;
+    for (int t = 1; t < threads; t++)
+    {
+        workers.emplace_back(countTiles, t);
+    }
+    countTiles(0);
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+
+    vector<vector<int>> sequenceWeights(configCount, vector<int>(depth, 1)); // number of homolog sequences to each sequence
+    for (const auto& weights : threadWeights)
+    {
+        for (int c = 0; c < configCount; c++)
+        {
+            for (int i = 0; i < depth; i++)
+            {
+                sequenceWeights[c][i] += weights[c][i];
+            }
+        }
+    }
+    return sequenceWeights;
+}
+
+vector<vector<int>> computeRegionWeights(const vector<vector<int>>& sequences, float threshold, bool isSymmetric,
+                                         const string& standardLetters, NonStandardHandler nonStandardOption,
+                                         const vector<vector<int>>& regionColumns, int threads)
+{
+    int depth = sequences.size();
+    if (depth == 0)
+    {
+        throw runtime_error("There is no sequence to compute weights for.");
+    }
+    int length = sequences[0].size();
+    int regionCount = regionColumns.size();
+
+    // split columns into blocks of columns that belong to the same set of regions
+    vector<vector<bool>> inRegion(length, vector<bool>(regionCount, false));
+    for (int r = 0; r < regionCount; r++)
+    {
+        for (int column : regionColumns[r])
+        {
+            inRegion[column][r] = true;
+        }
+    }
+    map<vector<bool>, int> blockIndex;
+    vector<int> columns, columnBlock; // columns in any region and their block
+    vector<vector<int>> blockRegions;  // regions of each block
+    for (int column = 0; column < length; column++)
+    {
+        if (find(inRegion[column].begin(), inRegion[column].end(), true) == inRegion[column].end())
+        {
+            continue;
+        }
+        auto block = blockIndex.emplace(inRegion[column], blockIndex.size());
+        if (block.second)
+        {
+            blockRegions.emplace_back();
+            for (int r = 0; r < regionCount; r++)
+            {
+                if (inRegion[column][r])
+                {
+                    blockRegions.back().push_back(r);
+                }
+            }
+        }
+        columns.push_back(column);
+        columnBlock.push_back(block.first->second);
+    }
+
+    // cutoff of each sequence in each region, and positions counted in mismatches (asymmetric)
+    vector<vector<int>> cutoff(regionCount, vector<int>(depth));
+    vector<vector<char>> non_gap_msa(depth, vector<char>(length, 1));
+    for (int i = 0; i < depth; i++)
+    {
+        if (!isSymmetric)
+        {
+            for (int column : columns)
+            {
+                non_gap_msa[i][column] = isCountedInCutoff(sequences[i][column], standardLetters, nonStandardOption);
+            }
+        }
+        for (int r = 0; r < regionCount; r++)
+        {
+            int non_gap_count = 0;
+            for (int column : regionColumns[r])
+            {
+                non_gap_count += non_gap_msa[i][column];
+            }
+            cutoff[r][i] = non_gap_count * (1-threshold);
+        }
+    }
+
+    int tileCount = getTileCount(depth);
+    threads = max(1, min(threads, tileCount));
+    atomic<int> nextTile(0);
+    vector<vector<vector<int>>> threadWeights(threads, vector<vector<int>>(regionCount, vector<int>(depth, 0)));
+
+    auto countTiles = [&](int thread)
+    {
+        vector<vector<int>>& weights = threadWeights[thread];
+        vector<int> mismatch_i(regionCount), mismatch_j(regionCount); // # mismatches in i'th and j'th sequences of each region
+        int tile;
+
+        while ((tile = nextTile++) < tileCount)
+        {
+            int tileEnd = min((tile + 1) * TILE_SIZE, depth);
+            for (int i = tile * TILE_SIZE; i < tileEnd; i++)
+            {
+                for (int j = i+1; j < depth; j++)
+                {
+                    const vector<int>& sequence_i = sequences[i];
+                    const vector<int>& sequence_j = sequences[j];
+                    fill(mismatch_i.begin(), mismatch_i.end(), 0);
+                    fill(mismatch_j.begin(), mismatch_j.end(), 0);
+                    int similarRegions = regionCount; // regions the pair can still be similar in
+
+                    for (int c = 0; c < columns.size() && similarRegions > 0; c++)
+                    {
+                        int column = columns[c];
+                        if (sequence_i[column] == sequence_j[column])
+                        {
+                            continue;
+                        }
+                        for (int r : blockRegions[columnBlock[c]])
+                        {
+                            bool wasSimilar = (mismatch_i[r] <= cutoff[r][i]) || (mismatch_j[r] <= cutoff[r][j]);
+                            mismatch_i[r] += non_gap_msa[i][column];
+                            mismatch_j[r] += non_gap_msa[j][column];
+                            // no need to iterate more when the pair is not similar in any region
+                            similarRegions -= wasSimilar && (mismatch_i[r] > cutoff[r][i]) && (mismatch_j[r] > cutoff[r][j]);
+                        }
+                    }
+
+                    for (int r = 0; r < regionCount; r++)
+                    {
+                        weights[r][i] += (mismatch_i[r] <= cutoff[r][i]);
+                        weights[r][j] += (mismatch_j[r] <= cutoff[r][j]);
+                    }
+                }
+            }
+        }
+    };
+
+    vector<thread> workers;
+    for (int t = 1; t < threads; t++)
+    {
+        workers.emplace_back(countTiles, t);
+    }
+    countTiles(0);
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+
+    vector<vector<int>> sequenceWeights(regionCount, vector<int>(depth, 1)); // number of homolog sequences to each sequence
+    for (const auto& weights : threadWeights)
+    {
+        for (int r = 0; r < regionCount; r++)
+        {
+            for (int i = 0; i < depth; i++)
+            {
+                sequenceWeights[r][i] += weights[r][i];
+            }
+        }
+    }
+    return sequenceWeights;
+}
+
+// Number of locks of the sequences whose window weights are counted by the threads, each locking every
+// WEIGHT_STRIPES'th sequence
+const int WEIGHT_STRIPES = 64;
+
+vector<vector<int>> computeWindowWeights(const vector<vector<int>>& sequences, float threshold, bool isSymmetric,
+                                         const string& standardLetters, NonStandardHandler nonStandardOption,
+                                         int window, int threads)
+{
+    int depth = sequences.size();
+    if (depth == 0)
+    {
+        throw runtime_error("There is no sequence to compute weights for.");
+    }
+    int length = sequences[0].size();
+    int windowCount = length - window + 1;
+
+    // positions counted in mismatches, and cutoff of each sequence in each window
+    vector<vector<char>> non_gap_msa(depth, vector<char>(length, 1));
+    vector<vector<int>> cutoff(depth, vector<int>(windowCount, window * (1-threshold)));
+    if (!isSymmetric)
+    {
+        for (int i = 0; i < depth; i++)
+        {
+            int non_gap_count = 0;
+            for (int position = 0; position < length; position++)
+            {
+                non_gap_msa[i][position] = isCountedInCutoff(sequences[i][position], standardLetters, nonStandardOption);
+                non_gap_count += non_gap_msa[i][position];
+                if (position >= window)
+                {
+                    non_gap_count -= non_gap_msa[i][position - window];
+                }
+                if (position >= window - 1)
+                {
+                    cutoff[i][position - window + 1] = non_gap_count * (1-threshold);
+                }
+            }
+        }
+    }
+
+    int tileCount = getTileCount(depth);
+    threads = max(1, min(threads, tileCount));
+    atomic<int> nextTile(0);
+    // number of homologs of each sequence in each window, kept contiguous for each sequence and shared by the threads;
+    // each tile adds its counts of a sequence at once, under the lock of the stripe of the sequence
+    vector<vector<int>> weights(depth, vector<int>(windowCount, 0));
+    vector<mutex> stripeLocks(min(depth, WEIGHT_STRIPES));
+
+    auto addWeights = [&](int i, vector<int>& counts)
+    {
+        lock_guard<mutex> guard(stripeLocks[i % stripeLocks.size()]);
+        for (int w = 0; w < windowCount; w++)
+        {
+            weights[i][w] += counts[w];
+        }
+        fill(counts.begin(), counts.end(), 0);
+    };
+
+    auto countTiles = [&](int thread)
+    {
+        vector<vector<int>> tileWeights(TILE_SIZE, vector<int>(windowCount, 0)); // counts of the rows of the tile
+        vector<int> rowWeights(windowCount, 0); // counts of the j'th sequence among the rows of the tile
+        int tile;
+
+        while ((tile = nextTile++) < tileCount)
+        {
+            int tileStart = tile * TILE_SIZE;
+            int tileEnd = min((tile + 1) * TILE_SIZE, depth);
+            for (int j = tileStart+1; j < depth; j++)
+            {
+                const vector<int>& sequence_j = sequences[j];
+                for (int i = tileStart; i < min(j, tileEnd); i++)
+                {
+                    const vector<int>& sequence_i = sequences[i];
+                    vector<int>& weights_i = tileWeights[i - tileStart];
+                    int mismatch_i = 0; // # mismatches in i'th sequence within the window
+                    int mismatch_j = 0; // # mismatches in j'th sequence within the window
+
+                    for (int position = 0; position < length; position++)
+                    {
+                        // entering column
+                        if (sequence_i[position] != sequence_j[position])
+                        {
+                            mismatch_i += non_gap_msa[i][position];
+                            mismatch_j += non_gap_msa[j][position];
+                        }
+                        // leaving column
+                        int leaving = position - window;
+                        if (leaving >= 0 && sequence_i[leaving] != sequence_j[leaving])
+                        {
+                            mismatch_i -= non_gap_msa[i][leaving];
+                            mismatch_j -= non_gap_msa[j][leaving];
+                        }
+                        int start = position - window + 1;
+                        if (start >= 0)
+                        {
+                            weights_i[start] += (mismatch_i <= cutoff[i][start]);
+                            rowWeights[start] += (mismatch_j <= cutoff[j][start]);
+                        }
+                    }
+                }
+
+                if (j < tileEnd)
+                {
+                    vector<int>& weights_j = tileWeights[j - tileStart];
+                    for (int w = 0; w < windowCount; w++)
+                    {
+                        weights_j[w] += rowWeights[w];
+                    }
+                    fill(rowWeights.begin(), rowWeights.end(), 0);
+                }
+                else
+                {
+                    addWeights(j, rowWeights);
+                }
+            }
+            for (int i = tileStart; i < tileEnd; i++)
+            {
+                addWeights(i, tileWeights[i - tileStart]);
+            }
+        }
+    };
+
+    vector<thread> workers;
+    for (int t = 1; t < threads; t++)
+    {
+        workers.emplace_back(countTiles, t);
+    }
+    countTiles(0);
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+
+    vector<vector<int>> sequenceWeights(windowCount, vector<int>(depth, 1)); // number of homolog sequences to each sequence
+    for (int i = 0; i < depth; i++)
+    {
+        for (int w = 0; w < windowCount; w++)
+        {
+            sequenceWeights[w][i] += weights[i][w];
+        }
+        vector<int>().swap(weights[i]);
+    }
+    return sequenceWeights;
+}
+
+vector<vector<int>> computeMaskWeights(const vector<vector<int>>& sequences, float threshold, bool isSymmetric,
+                                       const string& standardLetters, NonStandardHandler nonStandardOption,
+                                       const vector<vector<bool>>& keptColumns, int threads)
+{
+    int depth = sequences.size();
+    if (depth == 0)
+    {
+        throw runtime_error("There is no sequence to compute weights for.");
+    }
+    int length = sequences[0].size();
+    int maskCount = keptColumns.size();
+    int blockCount = (length + 63) / 64;
+
+    // bits of kept columns of each mask, and of positions counted in mismatches of each sequence
+    vector<vector<uint64_t>> keptBits(maskCount, vector<uint64_t>(blockCount, 0));
+    for (int m = 0; m < maskCount; m++)
+    {
+        for (int position = 0; position < length; position++)
+        {
+            keptBits[m][position / 64] |= uint64_t(keptColumns[m][position]) << (position % 64);
+        }
+    }
+    vector<vector<uint64_t>> non_gap_msa(depth, vector<uint64_t>(blockCount, 0));
+    for (int i = 0; i < depth; i++)
+    {
+        for (int position = 0; position < length; position++)
+        {
+            bool counted = isSymmetric || isCountedInCutoff(sequences[i][position], standardLetters, nonStandardOption);
+            non_gap_msa[i][position / 64] |= uint64_t(counted) << (position % 64);
+        }
+    }
+
+    // cutoff of each sequence in each mask
+    vector<vector<int>> cutoff(depth, vector<int>(maskCount));
+    for (int i = 0; i < depth; i++)
+    {
+        for (int m = 0; m < maskCount; m++)
+        {
+            int non_gap_count = 0;
+            for (int block = 0; block < blockCount; block++)
+            {
+                non_gap_count += __builtin_popcountll(non_gap_msa[i][block] & keptBits[m][block]);
+            }
+            cutoff[i][m] = non_gap_count * (1-threshold);
+        }
+    }
+
+    int tileCount = getTileCount(depth);
+    threads = max(1, min(threads, tileCount));
+    atomic<int> nextTile(0);
+    vector<vector<vector<int>>> threadWeights(threads, vector<vector<int>>(depth, vector<int>(maskCount, 0)));
+
+    auto countTiles = [&](int thread)
+    {
+        vector<vector<int>>& weights = threadWeights[thread];
+        vector<uint64_t> mismatchBits(blockCount); // mismatched columns of the pair
+        int tile;
+
+        while ((tile = nextTile++) < tileCount)
+        {
+            int tileEnd = min((tile + 1) * TILE_SIZE, depth);
+            for (int i = tile * TILE_SIZE; i < tileEnd; i++)
+            {
+                for (int j = i+1; j < depth; j++)
+                {
+                    const vector<int>& sequence_i = sequences[i];
+                    const vector<int>& sequence_j = sequences[j];
+                    fill(mismatchBits.begin(), mismatchBits.end(), 0);
+                    for (int position = 0; position < length; position++)
+                    {
+                        mismatchBits[position / 64] |= uint64_t(sequence_i[position] != sequence_j[position]) << (position % 64);
+                    }
+
+                    for (int m = 0; m < maskCount; m++)
+                    {
+                        int mismatch_i = 0; // # mismatches in i'th sequence within kept columns
+                        int mismatch_j = 0; // # mismatches in j'th sequence within kept columns
+                        for (int block = 0; block < blockCount; block++)
+                        {
+                            uint64_t keptMismatches = mismatchBits[block] & keptBits[m][block];
+                            mismatch_i += __builtin_popcountll(keptMismatches & non_gap_msa[i][block]);
+                            mismatch_j += __builtin_popcountll(keptMismatches & non_gap_msa[j][block]);
+                        }
+                        weights[i][m] += (mismatch_i <= cutoff[i][m]);
+                        weights[j][m] += (mismatch_j <= cutoff[j][m]);
+                    }
+                }
+            }
+        }
+    };
+
+    vector<thread> workers;
+    for (int t = 1; t < threads; t++)
+    {
+        workers.emplace_back(countTiles, t);
+    }
+    countTiles(0);
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+
+    vector<vector<int>> sequenceWeights(maskCount, vector<int>(depth, 1)); // number of homolog sequences to each sequence
+    for (const auto& weights : threadWeights)
+    {
+        for (int i = 0; i < depth; i++)
+        {
+            for (int m = 0; m < maskCount; m++)
+            {
+                sequenceWeights[m][i] += weights[i][m];
+            }
+        }
+    }
+    return sequenceWeights;
+}
+
+vector<int> selectDepth(const vector<vector<int>>& sequences, float threshold, bool isSymmetric,
+                        const string& standardLetters, NonStandardHandler nonStandardOption, int depth,
+                        vector<int>& sequenceWeights, long long* comparisons)
+{
+    SimilarityCalculator similarityCalculator(sequences, threshold, isSymmetric, standardLetters, nonStandardOption);
+    int msaDepth = sequences.size();
+    depth = min(depth, msaDepth);
+
+    vector<int> selected = {0};
+    vector<int> homologs = {1};    // number of homologs of each selected row within the selected rows (including itself)
+    vector<int> checked(msaDepth, 0);                 // number of selected rows each row is compared with
+    vector<vector<int>> homologsOfRow(msaDepth);       // selected rows similar to each row (indices in 'selected')
+    vector<vector<int>> rowIsHomologOf(msaDepth);      // selected rows each row is similar to (indices in 'selected')
+    vector<vector<int>> rowsHomologTo(1);              // rows similar to each selected row (inverse of 'rowIsHomologOf')
+    vector<bool> isSelected(msaDepth, false);
+    isSelected[0] = true;
+    long long comparedPairs = 0;
+
+    // gain of NEFF by adding the row, considering the selected rows it is compared with
+    auto getComparedGain = [&](int k)
+    {
+        double gain = 1. / (1 + homologsOfRow[k].size());
+        for (int s : rowIsHomologOf[k])
+        {
+            gain += 1. / (homologs[s] + 1) - 1. / homologs[s];
+        }
+        return gain;
+    };
+
+    // compare the row with the rows selected since its last evaluation, and get the gain of NEFF by adding it;
+    // as similar rows only decrease the gain, comparisons stop once the gain is below the given limit
+    auto getGain = [&](int k, double limit)
+    {
+        bool similarToSelected, similarToK;
+        double gain = getComparedGain(k);
+        for (; checked[k] < selected.size() && gain >= limit; checked[k]++)
+        {
+            similarityCalculator.compare(selected[checked[k]], k, similarToSelected, similarToK);
+            comparedPairs++;
+            if (similarToK)
+            {
+                homologsOfRow[k].push_back(checked[k]);
+            }
+            if (similarToSelected)
+            {
+                rowIsHomologOf[k].push_back(checked[k]);
+                rowsHomologTo[checked[k]].push_back(k);
+            }
+            if (similarToK || similarToSelected)
+            {
+                gain = getComparedGain(k);
+            }
+        }
+        return gain;
+    };
+
+    // The gain of a row decreases by selecting rows similar to it, but increases when a selected row it is similar to
+    // gets more homologs (its penalty 1/(h+1) - 1/h shrinks). The queue keeps an upper bound of the gain of each row:
+    // its gain over the selected rows it is compared with, plus the increases of the penalties of its homologs since,
+    // so that the top row with an up-to-date gain is the row with the highest gain (as exhaustive greedy selection).
+    // rows by the bound of their gain (and by their order for equal gains), with the number of selected rows when
+    // their gain was computed over all selected rows (-1 if not) and the version of their bound
+    priority_queue<tuple<double, int, int, int>> queue;
+    vector<double> bound(msaDepth);
+    vector<int> version(msaDepth, 0);
+    for (int k = 1; k < msaDepth; k++)
+    {
+        bound[k] = getGain(k, -numeric_limits<double>::infinity());
+        queue.emplace(bound[k], -k, selected.size(), 0);
+    }
+
+    vector<double> increase(msaDepth, 0);
+    vector<int> increasedRows;
+    while (selected.size() < depth && !queue.empty())
+    {
+        auto [gain, negativeK, evaluatedAt, rowVersion] = queue.top();
+        queue.pop();
+        int k = -negativeK;
+        if (rowVersion != version[k])
+        {
+            // replaced by a higher bound
+            continue;
+        }
+        if (evaluatedAt != selected.size())
+        {
+            // outdated gain; comparisons stop once the row is not on top anymore
+            double limit = queue.empty() ? -numeric_limits<double>::infinity() : get<0>(queue.top());
+            bound[k] = getGain(k, limit);
+            queue.emplace(bound[k], negativeK, checked[k] == selected.size() ? (int)selected.size() : -1, ++version[k]);
+            continue;
+        }
+
+        // raise the bounds of the rows whose known homologs get one more homolog
+        for (int s : rowIsHomologOf[k])
+        {
+            double penaltyIncrease = (1. / (homologs[s] + 2) - 1. / (homologs[s] + 1))
+                                     - (1. / (homologs[s] + 1) - 1. / homologs[s]);
+            for (int j : rowsHomologTo[s])
+            {
+                if (isSelected[j] || j == k)
+                {
+                    continue;
+                }
+                if (increase[j] == 0)
+                {
+                    increasedRows.push_back(j);
+                }
+                increase[j] += penaltyIncrease;
+            }
+            homologs[s]++;
+        }
+        for (int j : increasedRows)
+        {
+            bound[j] += increase[j];
+            increase[j] = 0;
+            // still compared with the rows selected until its last evaluation only, so its gain is recomputed if on top
+            queue.emplace(bound[j], -j, -1, ++version[j]);
+        }
+        increasedRows.clear();
+
+        homologs.push_back(1 + homologsOfRow[k].size());
+        selected.push_back(k);
+        rowsHomologTo.emplace_back();
+        isSelected[k] = true;
+    }
+
+    sequenceWeights = homologs;
+    if (comparisons != nullptr)
+    {
+        *comparisons = comparedPairs;
+    }
+    return selected;
+}
+
+// Number of columns of each block of columns whose residues are counted by a thread (Henikoff weights)
+const int COLUMN_BLOCK_SIZE = 64;
+
+vector<float> computeHenikoffWeights(const vector<vector<int>>& sequences, const string& standardLetters,
+                                     NonStandardHandler nonStandardOption, int threads)
+{
+    int depth = sequences.size();
+    if (depth == 0)
+    {
+        throw runtime_error("There is no sequence to compute weights for.");
+    }
+    int length = sequences[0].size();
+
+    int symbols = 1;
+    for (const auto& sequence : sequences)
+    {
+        symbols = max(symbols, *max_element(sequence.begin(), sequence.end()) + 1);
+    }
+    vector<bool> counted(symbols);
+    for (int residue = 0; residue < symbols; residue++)
+    {
+        counted[residue] = (residue != 0) && isCountedInCutoff(residue, standardLetters, nonStandardOption);
+    }
+
+    // share of each residue of each column: 1 / (# distinct residues * # the residue), counted over blocks of columns
+    vector<vector<double>> share(length, vector<double>(symbols, 0));
+    int blockCount = (length + COLUMN_BLOCK_SIZE - 1) / COLUMN_BLOCK_SIZE;
+    atomic<int> nextBlock(0);
+    auto countBlocks = [&]()
+    {
+        vector<vector<int>> counts(COLUMN_BLOCK_SIZE, vector<int>(symbols));
+        int block;
+        while ((block = nextBlock++) < blockCount)
+        {
+            int blockStart = block * COLUMN_BLOCK_SIZE;
+            int blockEnd = min(blockStart + COLUMN_BLOCK_SIZE, length);
+            for (auto& columnCounts : counts)
+            {
+                fill(columnCounts.begin(), columnCounts.end(), 0);
+            }
+            for (const auto& sequence : sequences)
+            {
+                for (int position = blockStart; position < blockEnd; position++)
+                {
+                    counts[position - blockStart][sequence[position]]++;
+                }
+            }
+            for (int position = blockStart; position < blockEnd; position++)
+            {
+                const vector<int>& columnCounts = counts[position - blockStart];
+                int distinct = 0;
+                for (int residue = 0; residue < symbols; residue++)
+                {
+                    distinct += counted[residue] && columnCounts[residue] > 0;
+                }
+                for (int residue = 0; residue < symbols; residue++)
+                {
+                    if (counted[residue] && columnCounts[residue] > 0)
+                    {
+                        share[position][residue] = 1. / (distinct * columnCounts[residue]);
+                    }
+                }
+            }
+        }
+    };
+
+    threads = max(1, min(threads, blockCount));
+    vector<thread> workers;
+    for (int t = 1; t < threads; t++)
+    {
+        workers.emplace_back(countBlocks);
+    }
+    countBlocks();
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+
+    vector<double> weights(depth, 0);
+    double sum = 0, squaredSum = 0;
+    for (int i = 0; i < depth; i++)
+    {
+        for (int position = 0; position < length; position++)
+        {
+            weights[i] += share[position][sequences[i][position]];
+        }
+        weights[i] /= length;
+        sum += weights[i];
+        squaredSum += weights[i] * weights[i];
+    }
+
+    // scale weights to sum to the effective count of sequences
+    vector<float> sequenceWeights(depth, 0);
+    if (sum > 0)
+    {
+        double scale = sum / squaredSum;
+        for (int i = 0; i < depth; i++)
+        {
+            sequenceWeights[i] = weights[i] * scale;
+        }
+    }
+    return sequenceWeights;
+}
+
+float computeNeff(const vector<int>& sequenceWeights, Normalization norm, int length)
+{
+    float neff = 0;
+    for (int i=0; i < sequenceWeights.size(); i++)
+    {
+        neff += 1./sequenceWeights[i];
+    }
+
+    switch(norm) // normalizing Nf
+    {
+        case Sqrt_L:
+            neff = neff/sqrt(length);
+            break;
+        case L:
+            neff = neff/length;
+            break;
+        default:
+            break;
+    }
+    return neff;
+}
+
+vector<float> computeResidueNEFF
+(const vector<vector<int>>& sequences, const vector<int>& sequenceWeights, Normalization norm) {
+    int numSequences = sequences.size();
+    if (numSequences == 0) {
+        return {};
+    }
+    int sequenceLength = sequences[0].size();
+
+    vector<float> residueNEFF(sequenceLength, 0.0);
+
+    for (int col = 0; col < sequenceLength; ++col) {
+        float sumWeights = 0.0;
+        for (int row = 0; row < numSequences; ++row) {
+            // include sequence weight of the current seqeunce in the residue NEFF, if residue is not corresponding to a gap position
+            if (sequences[row][col] != 0)
+            {
+                sumWeights += 1./ sequenceWeights[row];
+            }
+        }
+
+        switch(norm) // normalizing Nf
+        {
+            case Sqrt_L:
+                residueNEFF[col] = sumWeights/sqrt(sequenceLength);
+                break;
+            case L:
+                residueNEFF[col] = sumWeights/sequenceLength;
+                break;
+            default:
+                residueNEFF[col] = sumWeights;
+                break;
+        }
+    }
+
+    return residueNEFF;
+}
+
+float computeNeff(const vector<float>& weights, Normalization norm, int length)
+{
+    float neff = 0;
+    for (float weight : weights)
+    {
+        neff += weight;
+    }
+
+    switch(norm) // normalizing Nf
+    {
+        case Sqrt_L:
+            neff = neff/sqrt(length);
+            break;
+        case L:
+            neff = neff/length;
+            break;
+        default:
+            break;
+    }
+    return neff;
+}
+
+vector<float> computeResidueNEFF(const vector<vector<int>>& sequences, const vector<float>& weights, Normalization norm)
+{
+    int numSequences = sequences.size();
+    if (numSequences == 0) {
+        return {};
+    }
+    int sequenceLength = sequences[0].size();
+
+    vector<float> residueNEFF(sequenceLength, 0.0);
+
+    for (int col = 0; col < sequenceLength; ++col) {
+        float sumWeights = 0.0;
+        for (int row = 0; row < numSequences; ++row) {
+            // include weight of the current seqeunce in the residue NEFF, if residue is not corresponding to a gap position
+            if (sequences[row][col] != 0)
+            {
+                sumWeights += weights[row];
+            }
+        }
+
+        switch(norm) // normalizing Nf
+        {
+            case Sqrt_L:
+                residueNEFF[col] = sumWeights/sqrt(sequenceLength);
+                break;
+            case L:
+                residueNEFF[col] = sumWeights/sequenceLength;
+                break;
+            default:
+                residueNEFF[col] = sumWeights;
+                break;
+        }
+    }
+
+    return residueNEFF;
+}
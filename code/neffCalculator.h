@@ -0,0 +1,381 @@
+/**
+ * @file neffCalculator.h
+ * @brief This file contains the declaration of functions and classes used to compute sequence weights and NEFF.
+ *
+ * Sequences are first mapped to digits (gap = 0) based on the alphabet and the option chosen for non-standard letters.
+ * Two sequences are considered similar (homologs) when the number of mismatched positions between them
+ * does not exceed a cutoff derived from the similarity threshold.
+ * The weight of each sequence is the inverse of the number of its homologs (including itself) in the MSA.
+ */
+
+#ifndef NEFF_CALCULATOR_H
+#define NEFF_CALCULATOR_H
+
+#include <vector>
+#include <string>
+#include <functional>
+#include <chrono>
+#include <cstdint>
+#include "common.h"
+
+/// @brief Map char residues to digit based on given 'nonStandardOption'
+/// @param c input letter
+/// @param standardLetters
+/// @param nonStandardLetters
+/// @param nonStandardOption
+/// @return
+int char2num(char c, const std::string& standardLetters, const std::string& nonStandardLetters, NonStandardHandler nonStandardOption);
+
+/// @brief Get gappy positions of sequences based on given 'gapCutoff', when #gaps in position >= depth * gapCutoff
+/// @param sequences
+/// @param gapCutoff
+/// @return gappy positions, in decreasing order
+std::vector<int> getGappyPositions(const std::vector<std::vector<int>>& sequences, float gapCutoff);
+
+/// @brief Remove gappy positions from sequences based on given 'gapCutoff'
+/// @param sequences
+/// @param gapCutoff
+void removeGappyPositions(std::vector<std::vector<int>>& sequences, float gapCutoff);
+
+/// @brief Map chars to digits based on provided 'nonStandardOption' and also remove gappy positions based on given 'gapCutoff'
+/// @param sequences
+/// @param standardLetters
+/// @param nonStandardLetters
+/// @param nonStandardOption
+/// @param gapCutoff
+/// @return
+std::vector<std::vector<int>> processSequences(std::vector<Sequence> sequences, std::string standardLetters,
+                                    std::string nonStandardLetters, NonStandardHandler nonStandardOption, float gapCutoff);
+
+/// @brief Whether a position of a sequence with the given residue is counted in its similarity cutoff (asymmetric)
+/// and in its mismatches with other sequences
+/// @param residue encoded residue
+/// @param standardLetters
+/// @param nonStandardOption
+/// @return
+bool isCountedInCutoff(int residue, const std::string& standardLetters, NonStandardHandler nonStandardOption);
+
+// Number of rows in each tile of the triangle of sequence pairs;
+// tile t covers pairs (i, j) with i in rows [t * TILE_SIZE, (t+1) * TILE_SIZE) and j > i
+const int TILE_SIZE = 64;
+
+/// @brief Get the number of row tiles of the triangle of sequence pairs
+/// @param depth
+/// @return
+int getTileCount(int depth);
+
+/// @brief Deterministically assign row tiles of the triangle of sequence pairs to shards, balancing the number of pairs
+/// @param depth
+/// @param shard index of the shard (starting from 0)
+/// @param shardCount
+/// @return tiles assigned to the given shard, in increasing order
+std::vector<int> getShardTiles(int depth, int shard, int shardCount);
+
+// Progress of a pass over row tiles of the triangle of sequence pairs
+struct TileProgress
+{
+    std::vector<int> completedTiles;  // tiles whose pairs are all compared
+    std::vector<int> sequenceWeights; // number of homologs of each sequence found within completed tiles (excluding itself)
+};
+
+class SimilarityCalculator
+{
+public:
+    /// @brief Constructor; computes the similarity cutoff of each sequence
+    /// @param sequences encoded sequences (kept by reference, should outlive the calculator)
+    /// @param threshold
+    /// @param isSymmetric
+    /// @param standardLetters
+    /// @param nonStandardOption
+    SimilarityCalculator(const std::vector<std::vector<int>>& sequences, float threshold, bool isSymmetric,
+                         const std::string& standardLetters, NonStandardHandler nonStandardOption);
+
+    /// @brief Compare the i'th and j'th sequences
+    /// @param i
+    /// @param j
+    /// @param similarToI whether j'th sequence is a homolog of the i'th sequence
+    /// @param similarToJ whether i'th sequence is a homolog of the j'th sequence
+    void compare(int i, int j, bool& similarToI, bool& similarToJ) const;
+
+    /// @brief Compare the i'th and j'th sequences, also giving their number of mismatches;
+    /// the number of mismatches of a sequence is exact when the other sequence is its homolog
+    /// @param i
+    /// @param j
+    /// @param similarToI whether j'th sequence is a homolog of the i'th sequence
+    /// @param similarToJ whether i'th sequence is a homolog of the j'th sequence
+    /// @param mismatch_i number of mismatches at non-gap positions of the i'th sequence (all positions, if symmetric)
+    /// @param mismatch_j number of mismatches at non-gap positions of the j'th sequence (all positions, if symmetric)
+    void compare(int i, int j, bool& similarToI, bool& similarToJ, int& mismatch_i, int& mismatch_j) const;
+
+    /// @brief Count mismatches between the i'th and j'th sequences, stopping when both counts reach 'maxMismatches'
+    /// @param i
+    /// @param j
+    /// @param maxMismatches
+    /// @param mismatch_i number of mismatches at non-gap positions of the i'th sequence (all positions, if symmetric)
+    /// @param mismatch_j number of mismatches at non-gap positions of the j'th sequence (all positions, if symmetric)
+    void countMismatches(int i, int j, int maxMismatches, int& mismatch_i, int& mismatch_j) const;
+
+    /// @brief Get the number of positions scanned when comparing the i'th and j'th sequences,
+    /// until the pair is found not to be similar (or all positions)
+    /// @param i
+    /// @param j
+    /// @return
+    int countScannedPositions(int i, int j) const;
+
+    /// @brief Whether pairs are compared column by column, i.e. neither by sparse rows nor by the block dictionary
+    /// @return
+    bool usesDenseRows() const;
+
+    /// @brief Get the number of positions counted in mismatches of the i'th sequence for the asymmetric cutoff
+    /// @param i
+    /// @return
+    int getNonGapCount(int i) const;
+
+    /// @brief Add the homologs found between sequences in rows [firstStart, firstEnd) and rows [secondStart, secondEnd)
+    /// to the number of homologs of each sequence; pairs are only compared once when the two ranges overlap
+    /// @param firstStart
+    /// @param firstEnd
+    /// @param secondStart
+    /// @param secondEnd
+    /// @param sequenceWeights number of homologs of each sequence, updated in place
+    void countHomologs(int firstStart, int firstEnd, int secondStart, int secondEnd, std::vector<int>& sequenceWeights) const;
+
+    /// @brief Add the homologs found in the given row tiles of the triangle of sequence pairs
+    /// to the number of homologs of each sequence, distributing tiles among threads
+    /// @param tiles
+    /// @param threads
+    /// @param sequenceWeights number of homologs of each sequence, updated in place
+    /// @param onProgress if given, called from a separate thread every 'progressInterval' seconds with a snapshot of the
+    /// completed tiles (and once at the end), so that compute threads are only blocked while the snapshot is copied
+    /// @param progressInterval
+    /// @param deadline threads stop taking tiles after this time, and the computation fails
+    void countHomologsInTiles(const std::vector<int>& tiles, int threads, std::vector<int>& sequenceWeights,
+                              const std::function<void(const TileProgress&)>& onProgress = nullptr,
+                              int progressInterval = 0,
+                              std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max()) const;
+
+private:
+    const std::vector<std::vector<int>>& sequences;
+    bool isSymmetric;
+    int length;
+    std::vector<int> cutoff; // keeps max num of mismatches for a sequence to be considered homolog
+    std::vector<std::vector<bool>> non_gap_msa; // keeps positions of non-gap residues in all sequences (asymmetric)
+
+    // Sparse rows, used when sequences cover a small part of the columns on average (e.g. hits of local alignments):
+    // each row keeps the interval [start, end) between its first and last residues, its residues within the interval,
+    // and prefix counts of its residues, so that mismatches of a pair outside the overlap of their intervals
+    // (residues against gaps) are counted arithmetically and only the residues within the overlap are compared
+    bool sparse = false;
+    bool gapCounted;                         // whether gaps are counted in mismatches (asymmetric)
+    std::vector<int> coverageStart, coverageEnd;
+    std::vector<size_t> coverageOffset;      // offset of the residues of each row in the pools below
+    std::vector<uint8_t> coveredResidues;    // residues of rows within their intervals
+    std::vector<uint8_t> coveredCounted;     // whether each of the residues is counted in mismatches (asymmetric)
+    std::vector<int> residuePrefix;          // # residues before each position of the interval (offset + row index)
+    std::vector<int> countedPrefix;          // # residues counted in mismatches before each position (asymmetric)
+
+    // Block dictionary, used when many rows share identical blocks of columns (e.g. highly redundant MSAs):
+    // distinct contents of each block of columns are kept once, rows are kept as the indices of their blocks,
+    // and the mismatches of each pair of distinct contents of a block are computed once and reused for all pairs of rows
+    bool dictionary = false;
+    int blockCount;
+    std::vector<uint32_t> rowBlocks;         // index of the content of each block of each row (depth x blockCount)
+    std::vector<int> distinctBlocks;         // number of distinct contents of each block
+    std::vector<size_t> tableOffset;         // offset of the mismatch table of each block
+    std::vector<uint8_t> blockMismatches;    // # mismatches (counted for the first content, if asymmetric) of content pairs
+
+    /// @brief Keep the block dictionary of sequences, if it compresses the rows enough
+    /// @param standardLetters
+    /// @param nonStandardOption
+    /// @return whether the block dictionary is used
+    bool buildBlockDictionary(const std::string& standardLetters, NonStandardHandler nonStandardOption);
+
+    /// @brief Compare the i'th and j'th sequences using the block dictionary, with the same results as 'compare'
+    void compareBlocks(int i, int j, int& mismatch_i, int& mismatch_j) const;
+
+    /// @brief Keep the sparse rows of sequences
+    /// @param standardLetters
+    /// @param nonStandardOption
+    void buildSparseRows(const std::string& standardLetters, NonStandardHandler nonStandardOption);
+
+    /// @brief Compare the i'th and j'th sequences using sparse rows, with the same results as 'compare'
+    void compareSparse(int i, int j, int& mismatch_i, int& mismatch_j) const;
+};
+
+/// @brief Compute sequence weights based on given options
+/// @param sequences
+/// @param threshold
+/// @param isSymmetric
+/// @param standardLetters
+/// @param nonStandardOption
+/// @param threads
+/// @param deadline the computation fails when it is not done by this time
+/// @return inverse of sequence weights
+std::vector<int> computeWeights(const std::vector<std::vector<int>>& sequences, float threshold, bool isSymmetric,
+                     const std::string& standardLetters, NonStandardHandler nonStandardOption, int threads = 1,
+                     std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max());
+
+/// @brief Compute sequence weights of the MSA prefixes of the given depths, in one pass over the pairs of sequences;
+/// homologs found by pair (i, j) with i < j are added to all depths greater than j
+/// @param sequences
+/// @param threshold
+/// @param isSymmetric
+/// @param standardLetters
+/// @param nonStandardOption
+/// @param depths depths of the prefixes (considering the depth of the MSA, if a given depth is greater than that)
+/// @param threads
+/// @return inverse of sequence weights of the rows of each prefix, in the order of given depths
+std::vector<std::vector<int>> computeDepthCurveWeights(const std::vector<std::vector<int>>& sequences, float threshold, bool isSymmetric,
+                                                       const std::string& standardLetters, NonStandardHandler nonStandardOption,
+                                                       const std::vector<int>& depths, int threads = 1);
+
+// Average number of positions scanned per pair of sequences (over sampled pairs) when computing weights,
+// in the original order of columns and after reordering them, and whether the columns are reordered
+struct ReorderStats
+{
+    bool denseRows;      // false when pairs are compared by sparse rows or the block dictionary (nothing is sampled)
+    float scannedBefore;
+    float scannedAfter;
+    bool reordered;
+};
+
+/// @brief Compute sequence weights as 'computeWeights', after reordering columns by decreasing entropy, so that dissimilar
+/// pairs reach their cutoff within the first columns. Columns are only reordered when pairs are compared column by
+/// column (sparse rows need the intervals of residues of the original order, and the block dictionary is faster) and
+/// the sampled number of scanned positions drops enough to pay for less predictable comparisons
+/// @param sequences
+/// @param threshold
+/// @param isSymmetric
+/// @param standardLetters
+/// @param nonStandardOption
+/// @param threads
+/// @param stats if given, filled with the average number of positions scanned per pair before and after reordering
+/// @return inverse of sequence weights
+std::vector<int> computeReorderedWeights(const std::vector<std::vector<int>>& sequences, float threshold, bool isSymmetric,
+                                         const std::string& standardLetters, NonStandardHandler nonStandardOption,
+                                         int threads = 1, ReorderStats* stats = nullptr);
+
+// Similarity parameters of a configuration of sequence weights
+struct SimilarityConfig
+{
+    float threshold;
+    bool isSymmetric;
+    NonStandardHandler nonStandardOption;
+};
+
+/// @brief Compute sequence weights of several configurations in one pass over the pairs of sequences;
+/// mismatches of each pair are counted once (until the pair is not similar in any configuration) and update all configurations
+/// @param sequences sequences encoded the same for non-standard options of all configurations
+/// @param configs
+/// @param standardLetters
+/// @param threads
+/// @return inverse of sequence weights of each configuration, in the given order
+std::vector<std::vector<int>> computeMultiConfigWeights(const std::vector<std::vector<int>>& sequences,
+                                                        const std::vector<SimilarityConfig>& configs,
+                                                        const std::string& standardLetters, int threads = 1);
+
+/// @brief Compute sequence weights of several regions (sets of columns) of the MSA in one pass over the pairs of sequences;
+/// columns are split into blocks of columns belonging to the same regions, and each mismatched column of a pair
+/// is added to the regions of its block (until the pair is not similar in any region)
+/// @param sequences
+/// @param threshold
+/// @param isSymmetric
+/// @param standardLetters
+/// @param nonStandardOption
+/// @param regionColumns columns of each region, in increasing order (regions can overlap)
+/// @param threads
+/// @return inverse of sequence weights of each region, in the given order
+std::vector<std::vector<int>> computeRegionWeights(const std::vector<std::vector<int>>& sequences, float threshold, bool isSymmetric,
+                                                   const std::string& standardLetters, NonStandardHandler nonStandardOption,
+                                                   const std::vector<std::vector<int>>& regionColumns, int threads = 1);
+
+/// @brief Compute sequence weights of each window of 'window' consecutive columns of the MSA in one pass over the pairs
+/// of sequences; mismatches of each pair are updated as the window slides, adding the entering column and subtracting
+/// the leaving one
+/// @param sequences
+/// @param threshold
+/// @param isSymmetric
+/// @param standardLetters
+/// @param nonStandardOption
+/// @param window number of columns of each window (not greater than the length of sequences)
+/// @param threads
+/// @return inverse of sequence weights of each window, in the order of their first column
+std::vector<std::vector<int>> computeWindowWeights(const std::vector<std::vector<int>>& sequences, float threshold, bool isSymmetric,
+                                                   const std::string& standardLetters, NonStandardHandler nonStandardOption,
+                                                   int window, int threads = 1);
+
+/// @brief Compute sequence weights of several masks of columns of the MSA in one pass over the pairs of sequences;
+/// mismatched columns of each pair are kept as bits in blocks of 64 columns, so the mismatches of each mask are
+/// counted by the bits of the pair that the mask keeps
+/// @param sequences
+/// @param threshold
+/// @param isSymmetric
+/// @param standardLetters
+/// @param nonStandardOption
+/// @param keptColumns whether each column is kept (not masked) by each mask
+/// @param threads
+/// @return inverse of sequence weights of each mask, in the given order
+std::vector<std::vector<int>> computeMaskWeights(const std::vector<std::vector<int>>& sequences, float threshold, bool isSymmetric,
+                                                 const std::string& standardLetters, NonStandardHandler nonStandardOption,
+                                                 const std::vector<std::vector<bool>>& keptColumns, int threads = 1);
+
+/// @brief Greedily select rows maximizing NEFF of the selected subset, starting from the query (first) sequence;
+/// the gain of adding a row is maintained lazily: rows are kept in a priority queue by an upper bound of their gain
+/// (their last computed gain, raised when selected rows they are similar to get more homologs), and the gain of the top
+/// row is only recomputed, comparing it to the rows selected since its last evaluation, when it is outdated; the
+/// selected rows are the same as recomputing all gains at each step
+/// @param sequences
+/// @param threshold
+/// @param isSymmetric
+/// @param standardLetters
+/// @param nonStandardOption
+/// @param depth number of rows to select (considering all rows, if greater than the depth of the MSA)
+/// @param sequenceWeights inverse of sequence weights of the selected subset
+/// @param comparisons if given, number of compared pairs of sequences
+/// @return selected rows, in the order of selection
+std::vector<int> selectDepth(const std::vector<std::vector<int>>& sequences, float threshold, bool isSymmetric,
+                             const std::string& standardLetters, NonStandardHandler nonStandardOption, int depth,
+                             std::vector<int>& sequenceWeights, long long* comparisons = nullptr);
+
+/// @brief Compute Henikoff position-based sequence weights in O(N*L), from the number of each residue in each column:
+/// each column gives 1 / (# distinct residues * # the residue) to each sequence with a residue counted in the column
+/// (not a gap, and not a non-standard letter considered as gap by 'nonStandardOption'), divided by the length;
+/// weights are scaled to sum to the effective count of sequences (sum of weights)^2 / (sum of squared weights).
+/// Residues are counted in parallel over blocks of columns.
+/// @param sequences
+/// @param standardLetters
+/// @param nonStandardOption
+/// @param threads
+/// @return sequence weights (not inverse)
+std::vector<float> computeHenikoffWeights(const std::vector<std::vector<int>>& sequences, const std::string& standardLetters,
+                                          NonStandardHandler nonStandardOption, int threads = 1);
+
+/// @brief Cumpote NEFF values based on sequence weights and given normalization
+/// @param sequenceWeights
+/// @param norm
+/// @param length
+/// @return
+float computeNeff(const std::vector<int>& sequenceWeights, Normalization norm, int length);
+
+/// @brief Compute per-residue (column-wise) NEFF
+/// @param sequences
+/// @param sequenceWeights
+/// @param norm
+/// @return
+std::vector<float> computeResidueNEFF(const std::vector<std::vector<int>>& sequences, const std::vector<int>& sequenceWeights, Normalization norm);
+
+/// @brief Compute NEFF values based on (not inverse) sequence weights, e.g. Henikoff weights, and given normalization
+/// @param weights
+/// @param norm
+/// @param length
+/// @return
+float computeNeff(const std::vector<float>& weights, Normalization norm, int length);
+
+/// @brief Compute per-residue (column-wise) NEFF based on (not inverse) sequence weights, e.g. Henikoff weights
+/// @param sequences
+/// @param weights
+/// @param norm
+/// @return
+std::vector<float> computeResidueNEFF(const std::vector<std::vector<int>>& sequences, const std::vector<float>& weights, Normalization norm);
+
+#endif
@@ -0,0 +1,385 @@
+/**
+ * @file neffServer.cpp
+ * @brief This file contains the implementation of the NeffServer class.
+ */
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <thread>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <stdexcept>
+#include "neffServer.h"
+#include "resultWriter.h"
+
+#ifndef _WIN32
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0 // SIGPIPE is ignored while serving
+#endif
+
+using namespace std;
+
+// Upper bounds (seconds) of the buckets of the latency histogram
+static const vector<double> LATENCY_BUCKETS = {0.001, 0.005, 0.01, 0.05, 0.1, 0.5, 1, 5, 10, 60};
+// Maximum size of a request, to refuse a corrupted length prefix instead of allocating it
+static const uint32_t MAX_REQUEST_SIZE = 1u << 30;
+// Milliseconds between checks of stopping the server while waiting for connections or requests
+static const int POLL_INTERVAL = 200;
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void requestStop(int)
+{
+    stopRequested = 1;
+}
+
+/// @brief Format a message as a JSON object of an error
+/// @param message
+/// @return
+static string formatError(const string& message)
+{
+    return "{\"error\": \"" + escapeJSON(message) + "\"}\n";
+}
+
+#ifndef _WIN32
+
+/// @brief Wait until the connection has data to read
+/// @param connection
+/// @param deadline
+/// @param stopping
+/// @return false if the deadline is passed or the server is stopping
+static bool waitReadable(int connection, chrono::steady_clock::time_point deadline, const atomic<bool>& stopping)
+{
+    while (!stopping)
+    {
+        auto now = chrono::steady_clock::now();
+        if (now >= deadline)
+        {
+            return false;
+        }
+        int wait = min<long long>(POLL_INTERVAL, chrono::duration_cast<chrono::milliseconds>(deadline - now).count() + 1);
+        pollfd descriptor = {connection, POLLIN, 0};
+        int ready = poll(&descriptor, 1, wait);
+        if (ready > 0)
+        {
+            return true;
+        }
+        if (ready < 0 && errno != EINTR)
+        {
+            return false;
+        }
+    }
+    return false;
+}
+
+/// @brief Receive the given number of bytes
+/// @param connection
+/// @param data
+/// @param size
+/// @param deadline
+/// @param stopping
+/// @return false if the connection is closed, the deadline is passed or the server is stopping
+static bool receiveBytes(int connection, char* data, size_t size, chrono::steady_clock::time_point deadline,
+                         const atomic<bool>& stopping)
+{
+    size_t received = 0;
+    while (received < size)
+    {
+        if (!waitReadable(connection, deadline, stopping))
+        {
+            return false;
+        }
+        ssize_t count = recv(connection, data + received, size - received, 0);
+        if (count == 0 || (count < 0 && errno != EINTR && errno != EAGAIN))
+        {
+            return false;
+        }
+        received += max<ssize_t>(count, 0);
+    }
+    return true;
+}
+
+/// @brief Send a message, prefixed by its length
+/// @param connection
+/// @param message
+/// @return false if the connection is closed (or the send timeout of the socket is passed)
+static bool sendMessage(int connection, const string& message)
+{
+    uint32_t size = message.size();
+    unsigned char prefix[4] = {(unsigned char)size, (unsigned char)(size >> 8), (unsigned char)(size >> 16),
+                               (unsigned char)(size >> 24)};
+    string data((const char*)prefix, 4);
+    data += message;
+
+    size_t sent = 0;
+    while (sent < data.size())
+    {
+        ssize_t count = send(connection, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (count < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (count <= 0)
+        {
+            return false;
+        }
+        sent += count;
+    }
+    return true;
+}
+
+#endif
+
+NeffServer::NeffServer(const ServerOptions& _options, RequestHandler _handler)
+: options(_options), handler(_handler), latencyCounts(LATENCY_BUCKETS.size() + 1, 0) {}
+
+void NeffServer::recordRequest(double seconds, const string& status, long long pairs)
+{
+    lock_guard<mutex> guard(statisticsLock);
+    if (status == "ok")
+    {
+        succeededRequests++;
+    }
+    else if (status == "timeout")
+    {
+        timedOutRequests++;
+    }
+    else
+    {
+        failedRequests++;
+    }
+    int bucket = lower_bound(LATENCY_BUCKETS.begin(), LATENCY_BUCKETS.end(), seconds) - LATENCY_BUCKETS.begin();
+    latencyCounts[bucket]++;
+    latencySum += seconds;
+    if (status == "ok")
+    {
+        comparedPairs += pairs;
+        computeSeconds += seconds;
+    }
+}
+
+string NeffServer::getMetrics() const
+{
+    lock_guard<mutex> guard(statisticsLock);
+    ostringstream metrics;
+    metrics << "# TYPE neff_requests counter\n"
+            << "# HELP neff_requests Requests answered, by status.\n"
+            << "neff_requests_total{status=\"ok\"} " << succeededRequests << '\n'
+            << "neff_requests_total{status=\"error\"} " << failedRequests << '\n'
+            << "neff_requests_total{status=\"timeout\"} " << timedOutRequests << '\n'
+            << "# TYPE neff_rejected_connections counter\n"
+            << "# HELP neff_rejected_connections Connections refused because the queue was full.\n"
+            << "neff_rejected_connections_total " << rejectedConnections << '\n'
+            << "# TYPE neff_request_duration_seconds histogram\n"
+            << "# HELP neff_request_duration_seconds Time to compute the response of requests.\n";
+    long long cumulative = 0;
+    for (size_t b = 0; b < LATENCY_BUCKETS.size(); b++)
+    {
+        cumulative += latencyCounts[b];
+        metrics << "neff_request_duration_seconds_bucket{le=\"" << formatFloat(LATENCY_BUCKETS[b]) << "\"} " << cumulative << '\n';
+    }
+    cumulative += latencyCounts.back();
+    metrics << "neff_request_duration_seconds_bucket{le=\"+Inf\"} " << cumulative << '\n'
+            << "neff_request_duration_seconds_sum " << latencySum << '\n'
+            << "neff_request_duration_seconds_count " << cumulative << '\n'
+            << "# TYPE neff_compared_pairs counter\n"
+            << "# HELP neff_compared_pairs Pairs of sequences compared to compute sequence weights.\n"
+            << "neff_compared_pairs_total " << comparedPairs << '\n'
+            << "# TYPE neff_pairs_per_second gauge\n"
+            << "# HELP neff_pairs_per_second Pairs of sequences compared per second of computing successful requests.\n"
+            << "neff_pairs_per_second " << (computeSeconds > 0 ? comparedPairs / computeSeconds : 0) << '\n'
+            << "# TYPE neff_busy_workers gauge\n"
+            << "neff_busy_workers " << busyWorkers << '\n'
+            << "# TYPE neff_workers gauge\n"
+            << "neff_workers " << options.workers << '\n'
+            << "# EOF\n";
+    return metrics.str();
+}
+
+#ifndef _WIN32
+
+void NeffServer::serveConnection(int connection)
+{
+    while (true)
+    {
+        // an idle connection is closed after the timeout
+        auto idleDeadline = chrono::steady_clock::now() + chrono::seconds(options.timeout);
+        unsigned char prefix[4];
+        if (!receiveBytes(connection, (char*)prefix, 4, idleDeadline, stopping))
+        {
+            return;
+        }
+        uint32_t size = prefix[0] | prefix[1] << 8 | prefix[2] << 16 | (uint32_t)prefix[3] << 24;
+        if (size > MAX_REQUEST_SIZE)
+        {
+            sendMessage(connection, formatError("Request of " + to_string(size) + " bytes exceeds the maximum size."));
+            return;
+        }
+
+        auto start = chrono::steady_clock::now();
+        auto deadline = start + chrono::seconds(options.timeout);
+        string request(size, '\0');
+        if (!receiveBytes(connection, &request[0], size, deadline, stopping))
+        {
+            return;
+        }
+
+        busyWorkers++;
+        string response, status = "ok";
+        long long pairs = 0;
+        try
+        {
+            response = handler(request, deadline, pairs);
+        }
+        catch (const exception& e)
+        {
+            status = chrono::steady_clock::now() >= deadline ? "timeout" : "error";
+            response = formatError(e.what());
+        }
+        busyWorkers--;
+        recordRequest(chrono::duration<double>(chrono::steady_clock::now() - start).count(), status, pairs);
+
+        if (!sendMessage(connection, response))
+        {
+            return;
+        }
+    }
+}
+
+void NeffServer::serveConnections()
+{
+    while (true)
+    {
+        int connection;
+        {
+            unique_lock<mutex> guard(queueLock);
+            queueCondition.wait(guard, [&]() { return stopping || !connections.empty(); });
+            if (connections.empty())
+            {
+                return;
+            }
+            connection = connections.front();
+            connections.pop_front();
+        }
+        serveConnection(connection);
+        close(connection);
+    }
+}
+
+void NeffServer::run()
+{
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (options.socketPath.size() >= sizeof(address.sun_path))
+    {
+        throw runtime_error("Socket path '" + options.socketPath + "' is too long.");
+    }
+    strcpy(address.sun_path, options.socketPath.c_str());
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0)
+    {
+        throw runtime_error("Failed to create the socket: " + string(strerror(errno)));
+    }
+
+    // a socket file left by a stopped server is replaced, but not the socket of a running one
+    struct stat status;
+    if (stat(address.sun_path, &status) == 0 && S_ISSOCK(status.st_mode))
+    {
+        if (connect(listener, (sockaddr*)&address, sizeof(address)) == 0)
+        {
+            close(listener);
+            throw runtime_error("Another server is listening on socket '" + options.socketPath + "'.");
+        }
+        close(listener);
+        unlink(address.sun_path);
+        listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    }
+    if (bind(listener, (sockaddr*)&address, sizeof(address)) < 0 || listen(listener, options.queueSize) < 0)
+    {
+        string error = strerror(errno);
+        close(listener);
+        throw runtime_error("Failed to listen on socket '" + options.socketPath + "': " + error);
+    }
+
+    struct sigaction stopAction = {};
+    stopAction.sa_handler = requestStop;
+    sigaction(SIGINT, &stopAction, nullptr);
+    sigaction(SIGTERM, &stopAction, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+
+    vector<thread> workers;
+    for (int w = 0; w < options.workers; w++)
+    {
+        workers.emplace_back(&NeffServer::serveConnections, this);
+    }
+
+    timeval sendTimeout = {options.timeout, 0};
+    while (!stopRequested)
+    {
+        pollfd descriptor = {listener, POLLIN, 0};
+        if (poll(&descriptor, 1, POLL_INTERVAL) <= 0)
+        {
+            continue;
+        }
+        int connection = accept(listener, nullptr, nullptr);
+        if (connection < 0)
+        {
+            continue;
+        }
+        // a client that does not read its responses cannot block a worker for longer than the timeout
+        setsockopt(connection, SOL_SOCKET, SO_SNDTIMEO, &sendTimeout, sizeof(sendTimeout));
+
+        unique_lock<mutex> guard(queueLock);
+        if (connections.size() >= options.queueSize)
+        {
+            guard.unlock();
+            sendMessage(connection, formatError("Server is busy; " + to_string(options.queueSize)
+                                                + " connections are waiting for a worker. Try again later."));
+            close(connection);
+            lock_guard<mutex> statisticsGuard(statisticsLock);
+            rejectedConnections++;
+            continue;
+        }
+        connections.push_back(connection);
+        guard.unlock();
+        queueCondition.notify_one();
+    }
+
+    // stop accepting connections; workers answer the requests being computed and close their connections
+    close(listener);
+    unlink(address.sun_path);
+    {
+        lock_guard<mutex> guard(queueLock);
+        stopping = true;
+    }
+    queueCondition.notify_all();
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+#else
+
+void NeffServer::serveConnection(int connection) {}
+
+void NeffServer::serveConnections() {}
+
+void NeffServer::run()
+{
+    throw runtime_error("'serve' is only supported on systems with Unix domain sockets.");
+}
+
+#endif
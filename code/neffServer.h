@@ -0,0 +1,92 @@
+/**
+ * @file neffServer.h
+ * @brief This file contains the declaration of the NeffServer class, serving NEFF requests over a Unix domain socket.
+ *
+ * Each message (request or response) is a 4-byte little-endian length followed by that many bytes. Accepted
+ * connections wait in a bounded queue for one of a fixed number of worker threads; when the queue is full, the
+ * connection is answered with an error and closed, so that clients back off instead of piling up. A worker serves the
+ * requests of a connection until it is closed, or idle for the request timeout. Failed requests are answered with a
+ * JSON object '{"error": "<message>"}'.
+ */
+
+#ifndef NEFF_SERVER_H
+#define NEFF_SERVER_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+// Options of the server
+struct ServerOptions
+{
+    std::string socketPath;
+    int workers;   // number of worker threads serving connections
+    int queueSize; // maximum number of accepted connections waiting for a worker
+    int timeout;   // seconds to receive a request and compute its result (and to keep an idle connection)
+};
+
+/// @brief Compute the response of a request; the computation should fail when it is not done by the deadline
+/// @param request
+/// @param deadline
+/// @param comparedPairs set to the number of pairs of sequences compared for the request
+/// @return response
+using RequestHandler = std::function<std::string(const std::string& request, std::chrono::steady_clock::time_point deadline,
+                                                 long long& comparedPairs)>;
+
+class NeffServer
+{
+public:
+    /// @brief Constructor
+    /// @param _options
+    /// @param _handler
+    NeffServer(const ServerOptions& _options, RequestHandler _handler);
+
+    /// @brief Serve requests until SIGINT or SIGTERM is received; requests being computed are answered before returning
+    void run();
+
+    /// @brief Get statistics of the served requests in the OpenMetrics text format
+    /// @return
+    std::string getMetrics() const;
+
+private:
+    ServerOptions options;
+    RequestHandler handler;
+
+    // accepted connections waiting for a worker
+    std::mutex queueLock;
+    std::condition_variable queueCondition;
+    std::deque<int> connections;
+    std::atomic<bool> stopping{false};
+
+    // statistics
+    mutable std::mutex statisticsLock;
+    long long succeededRequests = 0;
+    long long failedRequests = 0;
+    long long timedOutRequests = 0;
+    long long rejectedConnections = 0;
+    std::vector<long long> latencyCounts; // number of requests within each latency bucket (not cumulative)
+    double latencySum = 0;
+    long long comparedPairs = 0;
+    double computeSeconds = 0;            // time spent computing requests, for the rate of compared pairs
+    std::atomic<int> busyWorkers{0};
+
+    /// @brief Serve queued connections until the server is stopping
+    void serveConnections();
+
+    /// @brief Serve the requests of a connection until it is closed, idle for the timeout or the server is stopping
+    /// @param connection
+    void serveConnection(int connection);
+
+    /// @brief Add a served request to the statistics
+    /// @param seconds
+    /// @param status ok, error or timeout
+    /// @param pairs
+    void recordRequest(double seconds, const std::string& status, long long pairs);
+};
+
+#endif
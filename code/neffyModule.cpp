@@ -0,0 +1,440 @@
+/**
+ * @file neffyModule.cpp
+ * @brief This file contains the implementation of the neffy._neffy Python extension module, backed by the C API of
+ * libneffy.
+ *
+ * An MSA is loaded from a file path, a list of aligned sequences or a two-dimensional buffer of letters (e.g. a NumPy
+ * uint8 matrix of ASCII codes), without writing it to disk. Sequence weights and per-residue NEFF are returned as
+ * FloatArray objects exporting their values through the buffer protocol, so that numpy.frombuffer wraps them without
+ * copying. The GIL is released while loading files and computing; a lock of each MSA object keeps calls of different
+ * threads on the same handle sequential.
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include "libneffy.h"
+
+using namespace std;
+
+// Array of float32 values exported through the buffer protocol
+struct FloatArrayObject
+{
+    PyObject_HEAD
+    float* values;
+    Py_ssize_t size;
+};
+
+// Loaded MSA
+struct MSAObject
+{
+    PyObject_HEAD
+    neffy_msa* msa;
+    PyThread_type_lock lock;
+};
+
+static void FloatArray_dealloc(FloatArrayObject* self)
+{
+    PyMem_Free(self->values);
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+static Py_ssize_t FloatArray_length(FloatArrayObject* self)
+{
+    return self->size;
+}
+
+static int FloatArray_getbuffer(FloatArrayObject* self, Py_buffer* view, int flags)
+{
+    if (PyBuffer_FillInfo(view, (PyObject*)self, self->values, self->size * sizeof(float), 0, flags) < 0)
+    {
+        return -1;
+    }
+    view->format = (flags & PyBUF_FORMAT) ? (char*)"f" : nullptr;
+    view->itemsize = sizeof(float);
+    view->shape = (flags & PyBUF_ND) == PyBUF_ND ? &self->size : nullptr;
+    view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? &view->itemsize : nullptr;
+    return 0;
+}
+
+static PySequenceMethods FloatArray_sequence = {
+    (lenfunc)FloatArray_length,
+};
+
+static PyBufferProcs FloatArray_buffer = {
+    (getbufferproc)FloatArray_getbuffer,
+    nullptr,
+};
+
+static PyTypeObject FloatArrayType = {
+    PyVarObject_HEAD_INIT(nullptr, 0)
+    "neffy._neffy.FloatArray",
+};
+
+/// @brief Create an array with room for the given number of values
+/// @param capacity
+/// @return new reference, or NULL with an exception set
+static FloatArrayObject* newFloatArray(Py_ssize_t capacity)
+{
+    FloatArrayObject* array = PyObject_New(FloatArrayObject, &FloatArrayType);
+    if (array == nullptr)
+    {
+        return nullptr;
+    }
+    array->size = 0;
+    array->values = (float*)PyMem_Malloc(max<Py_ssize_t>(capacity, 1) * sizeof(float));
+    if (array->values == nullptr)
+    {
+        Py_DECREF(array);
+        return (FloatArrayObject*)PyErr_NoMemory();
+    }
+    return array;
+}
+
+/// @brief Raise RuntimeError with the last error of libneffy in the calling thread
+/// @return NULL
+static PyObject* raiseLastError()
+{
+    PyErr_SetString(PyExc_RuntimeError, neffy_last_error());
+    return nullptr;
+}
+
+/// @brief Load an MSA from a two-dimensional buffer of one-byte letters
+/// @param source
+/// @param alphabet
+/// @param checkValidation
+/// @param omitQueryGaps
+/// @return handle, or NULL with an exception set
+static neffy_msa* loadMatrix(PyObject* source, int alphabet, int checkValidation, int omitQueryGaps)
+{
+    Py_buffer view;
+    if (PyObject_GetBuffer(source, &view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) < 0)
+    {
+        return nullptr;
+    }
+    if (view.ndim != 2 || view.itemsize != 1)
+    {
+        PyBuffer_Release(&view);
+        PyErr_SetString(PyExc_ValueError, "A matrix of letters should be a two-dimensional array of one-byte values (e.g. uint8).");
+        return nullptr;
+    }
+
+    neffy_msa* msa;
+    Py_BEGIN_ALLOW_THREADS
+    msa = neffy_msa_from_matrix((const unsigned char*)view.buf, view.shape[0], view.shape[1], alphabet, checkValidation,
+                                omitQueryGaps);
+    Py_END_ALLOW_THREADS
+    PyBuffer_Release(&view);
+    return msa == nullptr ? (neffy_msa*)raiseLastError() : msa;
+}
+
+/// @brief Load an MSA from a sequence of aligned strings
+/// @param source
+/// @param alphabet
+/// @param checkValidation
+/// @param omitQueryGaps
+/// @return handle, or NULL with an exception set
+static neffy_msa* loadSequences(PyObject* source, int alphabet, int checkValidation, int omitQueryGaps)
+{
+    PyObject* items = PySequence_Fast(source, "The MSA should be a file path, a list of aligned sequences or a matrix of letters.");
+    if (items == nullptr)
+    {
+        return nullptr;
+    }
+
+    Py_ssize_t count = PySequence_Fast_GET_SIZE(items);
+    vector<const char*> sequences(count);
+    for (Py_ssize_t i = 0; i < count; i++)
+    {
+        sequences[i] = PyUnicode_AsUTF8(PySequence_Fast_GET_ITEM(items, i));
+        if (sequences[i] == nullptr)
+        {
+            Py_DECREF(items);
+            return nullptr;
+        }
+    }
+
+    // sequences are copied while holding the GIL, since the list can be changed by other threads
+    neffy_msa* msa = neffy_msa_from_sequences(sequences.data(), count, alphabet, checkValidation, omitQueryGaps);
+    Py_DECREF(items);
+    return msa == nullptr ? (neffy_msa*)raiseLastError() : msa;
+}
+
+/// @brief Load an MSA file
+/// @param source
+/// @param format
+/// @param alphabet
+/// @param checkValidation
+/// @param omitQueryGaps
+/// @param skipLines
+/// @return handle, or NULL with an exception set
+static neffy_msa* loadFile(PyObject* source, const char* format, int alphabet, int checkValidation, int omitQueryGaps,
+                           int skipLines)
+{
+    PyObject* path;
+    if (!PyUnicode_FSConverter(source, &path))
+    {
+        return nullptr;
+    }
+
+    neffy_msa* msa;
+    Py_BEGIN_ALLOW_THREADS
+    msa = neffy_msa_load(PyBytes_AS_STRING(path), format, alphabet, checkValidation, omitQueryGaps, skipLines);
+    Py_END_ALLOW_THREADS
+    Py_DECREF(path);
+    return msa == nullptr ? (neffy_msa*)raiseLastError() : msa;
+}
+
+static int MSA_init(MSAObject* self, PyObject* args, PyObject* kwargs)
+{
+    static const char* keywords[] = {"source", "format", "alphabet", "check_validation", "omit_query_gaps", "skip_lines", nullptr};
+    PyObject* source;
+    const char* format = nullptr;
+    int alphabet = 0, checkValidation = 0, omitQueryGaps = 1, skipLines = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|zippi", (char**)keywords, &source, &format, &alphabet,
+                                     &checkValidation, &omitQueryGaps, &skipLines))
+    {
+        return -1;
+    }
+
+    neffy_msa* msa;
+    if (PyUnicode_Check(source) || PyBytes_Check(source) || PyObject_HasAttrString(source, "__fspath__"))
+    {
+        msa = loadFile(source, format, alphabet, checkValidation, omitQueryGaps, skipLines);
+    }
+    else if (PyObject_CheckBuffer(source))
+    {
+        msa = loadMatrix(source, alphabet, checkValidation, omitQueryGaps);
+    }
+    else
+    {
+        msa = loadSequences(source, alphabet, checkValidation, omitQueryGaps);
+    }
+    if (msa == nullptr)
+    {
+        return -1;
+    }
+
+    neffy_msa_free(self->msa);
+    self->msa = msa;
+    return 0;
+}
+
+static PyObject* MSA_new(PyTypeObject* type, PyObject* args, PyObject* kwargs)
+{
+    MSAObject* self = (MSAObject*)type->tp_alloc(type, 0);
+    if (self == nullptr)
+    {
+        return nullptr;
+    }
+    self->msa = nullptr;
+    self->lock = PyThread_allocate_lock();
+    if (self->lock == nullptr)
+    {
+        Py_DECREF(self);
+        return PyErr_NoMemory();
+    }
+    return (PyObject*)self;
+}
+
+static void MSA_dealloc(MSAObject* self)
+{
+    neffy_msa_free(self->msa);
+    if (self->lock != nullptr)
+    {
+        PyThread_free_lock(self->lock);
+    }
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+/// @brief Parse the parameters of a computation, with the defaults of libneffy
+/// @param self
+/// @param args
+/// @param kwargs
+/// @param params
+/// @return whether the MSA is loaded and parameters are parsed; otherwise an exception is set
+static bool parseParams(MSAObject* self, PyObject* args, PyObject* kwargs, neffy_params* params)
+{
+    static const char* keywords[] = {"threshold", "is_symmetric", "non_standard_option", "gap_cutoff", "norm", "depth",
+                                     "threads", nullptr};
+    if (self->msa == nullptr)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "The MSA is not loaded.");
+        return false;
+    }
+    neffy_default_params(params);
+    return PyArg_ParseTupleAndKeywords(args, kwargs, "|fpifiii", (char**)keywords, &params->threshold, &params->is_symmetric,
+                                       &params->non_standard_option, &params->gap_cutoff, &params->norm, &params->depth,
+                                       &params->threads);
+}
+
+/// @brief Number of the considered sequences of the MSA
+/// @param self
+/// @param params
+/// @return
+static int getConsideredDepth(MSAObject* self, const neffy_params* params)
+{
+    int depth = neffy_msa_depth(self->msa);
+    return params->depth == 0 ? depth : min(params->depth, depth);
+}
+
+// Run a computation on the handle without the GIL, one thread at a time
+#define RUN_LOCKED(self, status, call)                     \
+    Py_BEGIN_ALLOW_THREADS                                 \
+    PyThread_acquire_lock((self)->lock, WAIT_LOCK);        \
+    status = call;                                         \
+    PyThread_release_lock((self)->lock);                   \
+    Py_END_ALLOW_THREADS
+
+static PyObject* MSA_neff(MSAObject* self, PyObject* args, PyObject* kwargs)
+{
+    neffy_params params;
+    if (!parseParams(self, args, kwargs, &params))
+    {
+        return nullptr;
+    }
+
+    float neff;
+    int length, status;
+    RUN_LOCKED(self, status, neffy_compute_neff(self->msa, &params, &neff, &length));
+    if (status != NEFFY_OK)
+    {
+        return raiseLastError();
+    }
+    return Py_BuildValue("iid", length, getConsideredDepth(self, &params), (double)neff);
+}
+
+static PyObject* MSA_weights(MSAObject* self, PyObject* args, PyObject* kwargs)
+{
+    neffy_params params;
+    if (!parseParams(self, args, kwargs, &params))
+    {
+        return nullptr;
+    }
+
+    FloatArrayObject* weights = newFloatArray(neffy_msa_depth(self->msa));
+    if (weights == nullptr)
+    {
+        return nullptr;
+    }
+    float neff;
+    int depth, length, status;
+    // NEFF is computed from the weights kept in the handle, to get the length after removing gappy positions
+    RUN_LOCKED(self, status, neffy_compute_weights(self->msa, &params, weights->values, &depth) == NEFFY_OK
+                                 ? neffy_compute_neff(self->msa, &params, &neff, &length)
+                                 : NEFFY_ERROR);
+    if (status != NEFFY_OK)
+    {
+        Py_DECREF(weights);
+        return raiseLastError();
+    }
+    weights->size = depth;
+    return Py_BuildValue("iiN", length, depth, weights);
+}
+
+static PyObject* MSA_residue_neff(MSAObject* self, PyObject* args, PyObject* kwargs)
+{
+    neffy_params params;
+    if (!parseParams(self, args, kwargs, &params))
+    {
+        return nullptr;
+    }
+
+    FloatArrayObject* residueNeff = newFloatArray(neffy_msa_length(self->msa));
+    if (residueNeff == nullptr)
+    {
+        return nullptr;
+    }
+    int length, status;
+    RUN_LOCKED(self, status, neffy_compute_residue_neff(self->msa, &params, residueNeff->values, &length));
+    if (status != NEFFY_OK)
+    {
+        Py_DECREF(residueNeff);
+        return raiseLastError();
+    }
+    residueNeff->size = length;
+    return Py_BuildValue("iiN", length, getConsideredDepth(self, &params), residueNeff);
+}
+
+static PyObject* MSA_get_depth(MSAObject* self, void*)
+{
+    return self->msa == nullptr ? PyLong_FromLong(0) : PyLong_FromLong(neffy_msa_depth(self->msa));
+}
+
+static PyObject* MSA_get_length(MSAObject* self, void*)
+{
+    return self->msa == nullptr ? PyLong_FromLong(0) : PyLong_FromLong(neffy_msa_length(self->msa));
+}
+
+static PyMethodDef MSA_methods[] = {
+    {"neff", (PyCFunction)(void (*)(void))MSA_neff, METH_VARARGS | METH_KEYWORDS,
+     "neff(threshold=0.8, is_symmetric=True, non_standard_option=0, gap_cutoff=1, norm=0, depth=0, threads=1)\n"
+     "Return (length, depth, NEFF) of the MSA."},
+    {"weights", (PyCFunction)(void (*)(void))MSA_weights, METH_VARARGS | METH_KEYWORDS,
+     "weights(threshold=0.8, is_symmetric=True, non_standard_option=0, gap_cutoff=1, norm=0, depth=0, threads=1)\n"
+     "Return (length, depth, weights) of the MSA, with weights as a FloatArray."},
+    {"residue_neff", (PyCFunction)(void (*)(void))MSA_residue_neff, METH_VARARGS | METH_KEYWORDS,
+     "residue_neff(threshold=0.8, is_symmetric=True, non_standard_option=0, gap_cutoff=1, norm=0, depth=0, threads=1)\n"
+     "Return (length, depth, per-residue NEFF) of the MSA, with per-residue NEFF as a FloatArray."},
+    {nullptr},
+};
+
+static PyGetSetDef MSA_getset[] = {
+    {"depth", (getter)MSA_get_depth, nullptr, "Number of sequences of the MSA.", nullptr},
+    {"length", (getter)MSA_get_length, nullptr, "Length of sequences of the MSA.", nullptr},
+    {nullptr},
+};
+
+static PyTypeObject MSAType = {
+    PyVarObject_HEAD_INIT(nullptr, 0)
+    "neffy._neffy.MSA",
+};
+
+static PyModuleDef neffyModule = {
+    PyModuleDef_HEAD_INIT,
+    "_neffy",
+    "Native interface of NEFFy, backed by libneffy.",
+    -1,
+};
+
+PyMODINIT_FUNC PyInit__neffy(void)
+{
+    FloatArrayType.tp_basicsize = sizeof(FloatArrayObject);
+    FloatArrayType.tp_dealloc = (destructor)FloatArray_dealloc;
+    FloatArrayType.tp_as_sequence = &FloatArray_sequence;
+    FloatArrayType.tp_as_buffer = &FloatArray_buffer;
+    FloatArrayType.tp_flags = Py_TPFLAGS_DEFAULT;
+    FloatArrayType.tp_doc = "Array of float32 values, exported through the buffer protocol (e.g. to numpy.frombuffer).";
+
+    MSAType.tp_basicsize = sizeof(MSAObject);
+    MSAType.tp_new = MSA_new;
+    MSAType.tp_init = (initproc)MSA_init;
+    MSAType.tp_dealloc = (destructor)MSA_dealloc;
+    MSAType.tp_methods = MSA_methods;
+    MSAType.tp_getset = MSA_getset;
+    MSAType.tp_flags = Py_TPFLAGS_DEFAULT;
+    MSAType.tp_doc = "MSA(source, format=None, alphabet=0, check_validation=False, omit_query_gaps=True, skip_lines=0)\n"
+                     "MSA loaded from a file path, a list of aligned sequences or a two-dimensional uint8 matrix of letters.";
+
+    if (PyType_Ready(&FloatArrayType) < 0 || PyType_Ready(&MSAType) < 0)
+    {
+        return nullptr;
+    }
+
+    PyObject* module = PyModule_Create(&neffyModule);
+    if (module == nullptr)
+    {
+        return nullptr;
+    }
+    Py_INCREF(&FloatArrayType);
+    Py_INCREF(&MSAType);
+    if (PyModule_AddObject(module, "FloatArray", (PyObject*)&FloatArrayType) < 0
+        || PyModule_AddObject(module, "MSA", (PyObject*)&MSAType) < 0)
+    {
+        Py_DECREF(module);
+        return nullptr;
+    }
+    return module;
+}
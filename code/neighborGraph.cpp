@@ -0,0 +1,201 @@
+/**
+ * @file neighborGraph.cpp
+ * @brief This file contains the implementation of the NeighborGraph class.
+ *
+ * File layout (little-endian):
+ *   magic "NEFFNBRS", version (uint32), depth (int32), number of edges (uint64),
+ *   row offsets ((depth + 1) x uint64), neighbors (edges x uint32), mismatches (edges x uint16)
+ */
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <tuple>
+#include <filesystem>
+#include <stdexcept>
+#include "common.h"
+#include "neffCalculator.h"
+#include "neighborGraph.h"
+#include "binaryIO.h"
+
+using namespace std;
+
+static const char NEIGHBORS_MAGIC[8] = {'N', 'E', 'F', 'F', 'N', 'B', 'R', 'S'};
+static const uint32_t NEIGHBORS_VERSION = 1;
+
+// Edge of the graph found by a thread
+struct NeighborEdge
+{
+    uint32_t row;
+    uint32_t neighbor;
+    uint16_t mismatches;
+};
+
+void NeighborGraph::write(const string& file) const
+{
+    string tempFile = file + ".tmp";
+    {
+        ofstream output(tempFile, ios::binary);
+        if (!output)
+        {
+            throw runtime_error("Failed to create file: " + tempFile);
+        }
+
+        output.write(NEIGHBORS_MAGIC, sizeof(NEIGHBORS_MAGIC));
+        writeValue<uint32_t>(output, NEIGHBORS_VERSION);
+        writeValue<int32_t>(output, rowOffsets.size() - 1);
+        writeValue<uint64_t>(output, neighbors.size());
+        output.write(reinterpret_cast<const char*>(rowOffsets.data()), rowOffsets.size() * sizeof(uint64_t));
+        output.write(reinterpret_cast<const char*>(neighbors.data()), neighbors.size() * sizeof(uint32_t));
+        output.write(reinterpret_cast<const char*>(mismatches.data()), mismatches.size() * sizeof(uint16_t));
+
+        if (!output)
+        {
+            throw runtime_error("Failed to write file: " + tempFile);
+        }
+    }
+    filesystem::rename(tempFile, file);
+}
+
+void NeighborGraph::writeTSV(const string& file) const
+{
+    string tempFile = file + ".tmp";
+    {
+        ofstream output(tempFile);
+        if (!output)
+        {
+            throw runtime_error("Failed to create file: " + tempFile);
+        }
+
+        output << "row\tneighbor\tmismatches\n";
+        for (size_t i = 0; i + 1 < rowOffsets.size(); i++)
+        {
+            for (uint64_t e = rowOffsets[i]; e < rowOffsets[i+1]; e++)
+            {
+                output << i + 1 << '\t' << neighbors[e] + 1 << '\t' << mismatches[e] << '\n';
+            }
+        }
+
+        if (!output)
+        {
+            throw runtime_error("Failed to write file: " + tempFile);
+        }
+    }
+    filesystem::rename(tempFile, file);
+}
+
+vector<int> computeWeightsAndNeighbors(const vector<vector<int>>& sequences, float threshold, bool isSymmetric,
+                                       const string& standardLetters, NonStandardHandler nonStandardOption,
+                                       int threads, int topK, NeighborGraph& graph)
+{
+    SimilarityCalculator similarityCalculator(sequences, threshold, isSymmetric, standardLetters, nonStandardOption);
+
+    int depth = sequences.size();
+    int tileCount = getTileCount(depth);
+    threads = max(1, min(threads, tileCount));
+
+    atomic<int> nextTile(0);
+    vector<vector<NeighborEdge>> threadEdges(threads); // edges found by each thread
+
+    auto countTiles = [&](int thread)
+    {
+        vector<NeighborEdge>& edges = threadEdges[thread];
+        bool similarToI, similarToJ;
+        int mismatch_i, mismatch_j;
+        int tile;
+
+        while ((tile = nextTile++) < tileCount)
+        {
+            int tileEnd = min((tile + 1) * TILE_SIZE, depth);
+            for (int i = tile * TILE_SIZE; i < tileEnd; i++)
+            {
+                for (int j = i+1; j < depth; j++)
+                {
+                    similarityCalculator.compare(i, j, similarToI, similarToJ, mismatch_i, mismatch_j);
+                    if (similarToI)
+                    {
+                        edges.push_back({(uint32_t)i, (uint32_t)j, (uint16_t)min(mismatch_i, (int)UINT16_MAX)});
+                    }
+                    if (similarToJ)
+                    {
+                        edges.push_back({(uint32_t)j, (uint32_t)i, (uint16_t)min(mismatch_j, (int)UINT16_MAX)});
+                    }
+                }
+            }
+        }
+    };
+
+    vector<thread> workers;
+    for (int t = 1; t < threads; t++)
+    {
+        workers.emplace_back(countTiles, t);
+    }
+    countTiles(0);
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+
+    // merge edges of all threads in CSR form
+    vector<uint64_t> offsets(depth + 1, 0);
+    for (const auto& edges : threadEdges)
+    {
+        for (const auto& edge : edges)
+        {
+            offsets[edge.row + 1]++;
+        }
+    }
+    vector<int> sequenceWeights(depth);
+    for (int i = 0; i < depth; i++)
+    {
+        sequenceWeights[i] = offsets[i + 1] + 1; // each sequence is a homolog of itself
+        offsets[i + 1] += offsets[i];
+    }
+
+    vector<pair<uint16_t, uint32_t>> rowEdges(offsets[depth]); // mismatches and neighbor of each edge
+    vector<uint64_t> next(offsets.begin(), offsets.end() - 1);
+    for (auto& edges : threadEdges)
+    {
+        for (const auto& edge : edges)
+        {
+            rowEdges[next[edge.row]++] = {edge.mismatches, edge.neighbor};
+        }
+        vector<NeighborEdge>().swap(edges);
+    }
+
+    graph.rowOffsets.assign(1, 0);
+    graph.neighbors.clear();
+    graph.mismatches.clear();
+    for (int i = 0; i < depth; i++)
+    {
+        auto first = rowEdges.begin() + offsets[i];
+        auto last = rowEdges.begin() + offsets[i + 1];
+        if (last - first > topK)
+        {
+            // keep the most similar neighbors
+            partial_sort(first, first + topK, last);
+            last = first + topK;
+        }
+        else if (topK < depth)
+        {
+            sort(first, last);
+        }
+        else
+        {
+            sort(first, last, [](const pair<uint16_t, uint32_t>& a, const pair<uint16_t, uint32_t>& b)
+                              { return a.second < b.second; });
+        }
+        for (auto edge = first; edge != last; edge++)
+        {
+            graph.neighbors.push_back(edge->second);
+            graph.mismatches.push_back(edge->first);
+        }
+        graph.rowOffsets.push_back(graph.neighbors.size());
+    }
+
+    return sequenceWeights;
+}
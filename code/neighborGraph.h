@@ -0,0 +1,49 @@
+/**
+ * @file neighborGraph.h
+ * @brief This file contains the declaration of the NeighborGraph class.
+ *
+ * The neighbor graph keeps, for each sequence, the sequences that are its homologs (excluding itself)
+ * with their number of mismatches, in compressed sparse row (CSR) form. In the asymmetric version,
+ * j'th sequence is a neighbor of the i'th sequence when it is a homolog of the i'th sequence.
+ */
+
+#ifndef NEIGHBOR_GRAPH_H
+#define NEIGHBOR_GRAPH_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include "common.h"
+
+class NeighborGraph
+{
+public:
+    std::vector<uint64_t> rowOffsets; // neighbors of the i'th sequence are in [rowOffsets[i], rowOffsets[i+1])
+    std::vector<uint32_t> neighbors;  // indices of neighbor sequences (starting from 0)
+    std::vector<uint16_t> mismatches; // number of mismatches of the sequence with each neighbor (saturated at 65535)
+
+    /// @brief Write the graph in a binary CSR file; the file is replaced atomically
+    /// @param file
+    void write(const std::string& file) const;
+
+    /// @brief Write the graph in a TSV file, one line for each edge as 'row, neighbor, mismatches' (rows starting from 1)
+    /// @param file
+    void writeTSV(const std::string& file) const;
+};
+
+/// @brief Compute sequence weights and the neighbor graph of sequences in the same pass over the pairs of sequences;
+/// each thread keeps the edges it finds in its own buffer, and buffers are merged at the end
+/// @param sequences
+/// @param threshold
+/// @param isSymmetric
+/// @param standardLetters
+/// @param nonStandardOption
+/// @param threads
+/// @param topK maximum number of neighbors kept for each sequence, with the least mismatches (ties by index)
+/// @param graph neighbor graph, with neighbors of each sequence in increasing order of index (or of mismatches, if limited by topK)
+/// @return inverse of sequence weights (counting all homologs)
+std::vector<int> computeWeightsAndNeighbors(const std::vector<std::vector<int>>& sequences, float threshold, bool isSymmetric,
+                                            const std::string& standardLetters, NonStandardHandler nonStandardOption,
+                                            int threads, int topK, NeighborGraph& graph);
+
+#endif
@@ -0,0 +1,245 @@
+/**
+ * @file pairStatistics.cpp
+ * @brief This file contains the implementation of the PairStatistics class.
+ *
+ * File layout (little-endian), with all arrays starting at multiples of 4 bytes:
+ *   header (64 bytes): magic "NEFFPAIR", version (uint32), length (int32), number of letters (int32),
+ *     has mutual information (uint32), sum of weights (float64), letters (gap first, zero-padded to 32 bytes),
+ *   single frequencies (length x letters float32),
+ *   pair frequencies (length * (length - 1) / 2 pairs i < j, in the order of (0,1), (0,2), ..., (1,2), ...,
+ *     letters x letters float32 for each pair),
+ *   mutual information with APC (length x length float32, if computed)
+ */
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <filesystem>
+#include <stdexcept>
+#include "common.h"
+#include "pairStatistics.h"
+#include "binaryIO.h"
+
+using namespace std;
+
+static const char PAIRS_MAGIC[8] = {'N', 'E', 'F', 'F', 'P', 'A', 'I', 'R'};
+static const uint32_t PAIRS_VERSION = 1;
+static const int PAIRS_LETTERS_SIZE = 32;
+
+// Number of columns of each block of columns; pairs of two blocks of columns are counted by a thread
+static const int PAIR_BLOCK_SIZE = 16;
+
+size_t PairStatistics::getPairIndex(int i, int j) const
+{
+    return (size_t)i * length - (size_t)i * (i + 1) / 2 + (j - i - 1);
+}
+
+void PairStatistics::write(const string& file) const
+{
+    string tempFile = file + ".tmp";
+    {
+        ofstream output(tempFile, ios::binary);
+        if (!output)
+        {
+            throw runtime_error("Failed to create file: " + tempFile);
+        }
+
+        string paddedLetters = letters;
+        paddedLetters.resize(PAIRS_LETTERS_SIZE, '\0');
+
+        output.write(PAIRS_MAGIC, sizeof(PAIRS_MAGIC));
+        writeValue<uint32_t>(output, PAIRS_VERSION);
+        writeValue<int32_t>(output, length);
+        writeValue<int32_t>(output, letters.size());
+        writeValue<uint32_t>(output, !mutualInformation.empty());
+        writeValue<double>(output, sumWeights);
+        output.write(paddedLetters.data(), PAIRS_LETTERS_SIZE);
+        output.write(reinterpret_cast<const char*>(singleFrequencies.data()), singleFrequencies.size() * sizeof(float));
+        output.write(reinterpret_cast<const char*>(pairFrequencies.data()), pairFrequencies.size() * sizeof(float));
+        output.write(reinterpret_cast<const char*>(mutualInformation.data()), mutualInformation.size() * sizeof(float));
+
+        if (!output)
+        {
+            throw runtime_error("Failed to write file: " + tempFile);
+        }
+    }
+    filesystem::rename(tempFile, file);
+}
+
+PairStatistics computePairStatistics(const vector<vector<int>>& sequences, const vector<float>& weights, Alphabet alphabet,
+                                     bool withMutualInformation, int threads)
+{
+    if (sequences.empty())
+    {
+        throw runtime_error("There is no sequence to compute pair statistics of.");
+    }
+    int depth = sequences.size();
+    int length = sequences[0].size();
+    string standardLetters = getStandardLetters(alphabet);
+    int letterCount = standardLetters.size() + 1;
+    int squaredLetters = letterCount * letterCount;
+
+    PairStatistics statistics;
+    statistics.letters = GAP.substr(0, 1) + standardLetters;
+    statistics.length = length;
+    statistics.sumWeights = 0;
+    for (float weight : weights)
+    {
+        statistics.sumWeights += weight;
+    }
+    double scale = statistics.sumWeights > 0 ? 1 / statistics.sumWeights : 0;
+
+    // residues with non-standard letters counted with gaps
+    vector<vector<uint8_t>> residues(depth, vector<uint8_t>(length));
+    for (int row = 0; row < depth; row++)
+    {
+        for (int position = 0; position < length; position++)
+        {
+            int residue = sequences[row][position];
+            residues[row][position] = residue < letterCount ? residue : 0;
+        }
+    }
+
+    vector<double> singleCounts((size_t)length * letterCount, 0);
+    for (int row = 0; row < depth; row++)
+    {
+        for (int position = 0; position < length; position++)
+        {
+            singleCounts[(size_t)position * letterCount + residues[row][position]] += weights[row];
+        }
+    }
+    statistics.singleFrequencies.resize(singleCounts.size());
+    for (size_t k = 0; k < singleCounts.size(); k++)
+    {
+        statistics.singleFrequencies[k] = singleCounts[k] * scale;
+    }
+
+    statistics.pairFrequencies.assign((size_t)length * (length - 1) / 2 * squaredLetters, 0);
+    vector<float> rawInformation;
+    if (withMutualInformation)
+    {
+        rawInformation.assign((size_t)length * length, 0);
+    }
+
+    // blocks (I, J) with I <= J, each counting the pairs i < j with i in block I and j in block J
+    int blockCount = (length + PAIR_BLOCK_SIZE - 1) / PAIR_BLOCK_SIZE;
+    vector<pair<int, int>> blockPairs;
+    for (int blockI = 0; blockI < blockCount; blockI++)
+    {
+        for (int blockJ = blockI; blockJ < blockCount; blockJ++)
+        {
+            blockPairs.push_back({blockI, blockJ});
+        }
+    }
+
+    atomic<int> nextBlockPair(0);
+    auto countBlockPairs = [&]()
+    {
+        vector<double> counts((size_t)PAIR_BLOCK_SIZE * PAIR_BLOCK_SIZE * squaredLetters);
+        int k;
+        while ((k = nextBlockPair++) < blockPairs.size())
+        {
+            int startI = blockPairs[k].first * PAIR_BLOCK_SIZE;
+            int endI = min(startI + PAIR_BLOCK_SIZE, length);
+            int startJ = blockPairs[k].second * PAIR_BLOCK_SIZE;
+            int endJ = min(startJ + PAIR_BLOCK_SIZE, length);
+            fill(counts.begin(), counts.end(), 0);
+
+            for (int row = 0; row < depth; row++)
+            {
+                const uint8_t* residue = residues[row].data();
+                double weight = weights[row];
+                if (weight == 0)
+                {
+                    continue;
+                }
+                for (int i = startI; i < endI; i++)
+                {
+                    double* pairCounts = &counts[(size_t)(i - startI) * PAIR_BLOCK_SIZE * squaredLetters]
+                                         + residue[i] * letterCount;
+                    for (int j = max(i + 1, startJ); j < endJ; j++)
+                    {
+                        pairCounts[(size_t)(j - startJ) * squaredLetters + residue[j]] += weight;
+                    }
+                }
+            }
+
+            for (int i = startI; i < endI; i++)
+            {
+                for (int j = max(i + 1, startJ); j < endJ; j++)
+                {
+                    const double* pairCounts = &counts[((size_t)(i - startI) * PAIR_BLOCK_SIZE + (j - startJ)) * squaredLetters];
+                    float* pairFrequencies = &statistics.pairFrequencies[statistics.getPairIndex(i, j) * squaredLetters];
+                    double information = 0;
+                    for (int a = 0; a < letterCount; a++)
+                    {
+                        for (int b = 0; b < letterCount; b++)
+                        {
+                            double frequency = pairCounts[a * letterCount + b] * scale;
+                            pairFrequencies[a * letterCount + b] = frequency;
+                            if (withMutualInformation && frequency > 0)
+                            {
+                                information += frequency * log(frequency / (singleCounts[(size_t)i * letterCount + a] * scale
+                                                                            * singleCounts[(size_t)j * letterCount + b] * scale));
+                            }
+                        }
+                    }
+                    if (withMutualInformation)
+                    {
+                        rawInformation[(size_t)i * length + j] = information;
+                        rawInformation[(size_t)j * length + i] = information;
+                    }
+                }
+            }
+        }
+    };
+
+    threads = max(1, min(threads, (int)blockPairs.size()));
+    vector<thread> workers;
+    for (int t = 1; t < threads; t++)
+    {
+        workers.emplace_back(countBlockPairs);
+    }
+    countBlockPairs();
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+
+    if (withMutualInformation && length > 1)
+    {
+        // average product correction: MI(i,j) - mean MI(i,.) * mean MI(.,j) / mean MI
+        vector<double> columnMeans(length, 0);
+        double mean = 0;
+        for (int i = 0; i < length; i++)
+        {
+            for (int j = 0; j < length; j++)
+            {
+                columnMeans[i] += rawInformation[(size_t)i * length + j];
+            }
+            mean += columnMeans[i];
+            columnMeans[i] /= length - 1;
+        }
+        mean /= (double)length * (length - 1);
+
+        statistics.mutualInformation.assign((size_t)length * length, 0);
+        for (int i = 0; i < length; i++)
+        {
+            for (int j = 0; j < length; j++)
+            {
+                if (i != j)
+                {
+                    double correction = mean > 0 ? columnMeans[i] * columnMeans[j] / mean : 0;
+                    statistics.mutualInformation[(size_t)i * length + j] = rawInformation[(size_t)i * length + j] - correction;
+                }
+            }
+        }
+    }
+
+    return statistics;
+}
@@ -0,0 +1,51 @@
+/**
+ * @file pairStatistics.h
+ * @brief This file contains the declaration of the PairStatistics class.
+ *
+ * Pair statistics keep the frequencies of the gap and standard letters of each column and of each pair of columns of
+ * an MSA, weighted by sequence weights, as the inputs of coevolution methods; the mutual information of pairs of
+ * columns, with average product correction (APC), can be kept along with them.
+ */
+
+#ifndef PAIR_STATISTICS_H
+#define PAIR_STATISTICS_H
+
+#include <vector>
+#include <string>
+#include <cstddef>
+#include "common.h"
+
+class PairStatistics
+{
+public:
+    std::string letters;                  // gap followed by the standard letters, in the order of frequencies
+    int length;                           // number of columns
+    double sumWeights;                    // sum of sequence weights, that weighted counts are divided by
+    std::vector<float> singleFrequencies; // length x letters weighted frequencies f_i(a) (row-major)
+    std::vector<float> pairFrequencies;   // weighted frequencies f_ij(a,b) of pairs i < j, letters x letters for each pair
+    std::vector<float> mutualInformation; // length x length mutual information with APC (empty if not computed)
+
+    /// @brief Get the index of the pair of columns i < j, in the order of pairs of pairFrequencies
+    /// @param i
+    /// @param j
+    /// @return
+    size_t getPairIndex(int i, int j) const;
+
+    /// @brief Write the statistics in a binary file, with arrays aligned to be memory-mapped;
+    /// the file is replaced atomically
+    /// @param file
+    void write(const std::string& file) const;
+};
+
+/// @brief Compute weighted frequencies of columns and pairs of columns of the MSA; blocks of pairs of columns are
+/// counted by threads, pulling blocks from a shared counter. Non-standard letters are counted with gaps.
+/// @param sequences encoded sequences
+/// @param weights weight of each sequence
+/// @param alphabet
+/// @param withMutualInformation compute the mutual information of pairs of columns, with APC
+/// @param threads
+/// @return
+PairStatistics computePairStatistics(const std::vector<std::vector<int>>& sequences, const std::vector<float>& weights,
+                                     Alphabet alphabet, bool withMutualInformation, int threads);
+
+#endif
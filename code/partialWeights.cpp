@@ -0,0 +1,187 @@
+/**
+ * @file partialWeights.cpp
+ * @brief This file contains the implementation of the PartialWeights class.
+ *
+ * File layout (little-endian):
+ *   magic "NEFFPART", version (uint32), input hash (uint64),
+ *   shard, shard count, depth, length (int32 each),
+ *   number of homologs (depth x uint32)
+ */
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include "common.h"
+#include "partialWeights.h"
+#include "binaryIO.h"
+
+using namespace std;
+
+static const char PARTIAL_MAGIC[8] = {'N', 'E', 'F', 'F', 'P', 'A', 'R', 'T'};
+static const uint32_t PARTIAL_VERSION = 1;
+
+/// @brief FNV-1a hash of the given bytes
+static uint64_t hashBytes(uint64_t hash, const void* data, size_t size)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+uint64_t computeInputHash(const vector<vector<int>>& sequences, float threshold, bool isSymmetric,
+                          const string& standardLetters, NonStandardHandler nonStandardOption)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    int depth = sequences.size();
+    int length = depth > 0 ? sequences[0].size() : 0;
+    int standardLetterSize = standardLetters.size();
+    int option = nonStandardOption;
+
+    hash = hashBytes(hash, &depth, sizeof(depth));
+    hash = hashBytes(hash, &length, sizeof(length));
+    hash = hashBytes(hash, &threshold, sizeof(threshold));
+    hash = hashBytes(hash, &isSymmetric, sizeof(isSymmetric));
+    hash = hashBytes(hash, &standardLetterSize, sizeof(standardLetterSize));
+    hash = hashBytes(hash, &option, sizeof(option));
+
+    vector<uint8_t> row(length);
+    for (const auto& sequence : sequences)
+    {
+        copy(sequence.begin(), sequence.end(), row.begin());
+        hash = hashBytes(hash, row.data(), length);
+    }
+    return hash;
+}
+
+vector<int> PartialWeights::getSequenceWeights() const
+{
+    vector<int> weights(sequenceWeights);
+    for (int& weight : weights)
+    {
+        weight++; // each sequence is a homolog of itself
+    }
+    return weights;
+}
+
+PartialWeights PartialWeights::merge(const vector<string>& files)
+{
+    PartialWeights merged;
+    vector<bool> seen;
+
+    for (int f = 0; f < files.size(); f++)
+    {
+        PartialWeights partial = read(files[f]);
+
+        if (f == 0)
+        {
+            merged = partial;
+            merged.shard = 0;
+            merged.sequenceWeights.assign(partial.sequenceWeights.size(), 0);
+            seen.assign(partial.shardCount, false);
+        }
+        else if (partial.inputHash != merged.inputHash || partial.shardCount != merged.shardCount)
+        {
+            throw runtime_error("'" + files[f] + "' is not a shard of the same MSA, parameters and shard count as '" + files[0] + "'.");
+        }
+
+        if (seen[partial.shard])
+        {
+            throw runtime_error("Shard " + to_string(partial.shard + 1) + " is given more than once.");
+        }
+        seen[partial.shard] = true;
+
+        for (int i = 0; i < partial.sequenceWeights.size(); i++)
+        {
+            merged.sequenceWeights[i] += partial.sequenceWeights[i];
+        }
+    }
+
+    for (int shard = 0; shard < seen.size(); shard++)
+    {
+        if (!seen[shard])
+        {
+            throw runtime_error("Shard " + to_string(shard + 1) + "/" + to_string(merged.shardCount) + " is missing.");
+        }
+    }
+
+    merged.shardCount = 1;
+    return merged;
+}
+
+void PartialWeights::write(const string& file) const
+{
+    string tempFile = file + ".tmp";
+    {
+        ofstream output(tempFile, ios::binary);
+        if (!output)
+        {
+            throw runtime_error("Failed to create file: " + tempFile);
+        }
+
+        output.write(PARTIAL_MAGIC, sizeof(PARTIAL_MAGIC));
+        writeValue<uint32_t>(output, PARTIAL_VERSION);
+        writeValue<uint64_t>(output, inputHash);
+        writeValue<int32_t>(output, shard);
+        writeValue<int32_t>(output, shardCount);
+        writeValue<int32_t>(output, sequenceWeights.size());
+        writeValue<int32_t>(output, length);
+
+        vector<uint32_t> weights(sequenceWeights.begin(), sequenceWeights.end());
+        output.write(reinterpret_cast<const char*>(weights.data()), weights.size() * sizeof(uint32_t));
+
+        if (!output)
+        {
+            throw runtime_error("Failed to write file: " + tempFile);
+        }
+    }
+    // other nodes only see the file when it is completely written
+    filesystem::rename(tempFile, file);
+}
+
+PartialWeights PartialWeights::read(const string& file)
+{
+    ifstream input(file, ios::binary);
+    if (!input)
+    {
+        throw runtime_error("Failed to open the partial weights file '" + file + "'.");
+    }
+
+    char magic[sizeof(PARTIAL_MAGIC)];
+    if (!input.read(magic, sizeof(magic)) || memcmp(magic, PARTIAL_MAGIC, sizeof(magic)) != 0)
+    {
+        throw runtime_error("'" + file + "' is not a partial weights file.");
+    }
+    if (readValue<uint32_t>(input, file) != PARTIAL_VERSION)
+    {
+        throw runtime_error("Unsupported version of the partial weights file '" + file + "'.");
+    }
+
+    PartialWeights partial;
+    partial.inputHash = readValue<uint64_t>(input, file);
+    partial.shard = readValue<int32_t>(input, file);
+    partial.shardCount = readValue<int32_t>(input, file);
+    int depth = readValue<int32_t>(input, file);
+    partial.length = readValue<int32_t>(input, file);
+
+    if (partial.shardCount <= 0 || partial.shard < 0 || partial.shard >= partial.shardCount || depth < 0)
+    {
+        throw runtime_error("Partial weights file '" + file + "' is corrupted.");
+    }
+
+    vector<uint32_t> weights(depth);
+    if (!input.read(reinterpret_cast<char*>(weights.data()), depth * sizeof(uint32_t)))
+    {
+        throw runtime_error("File '" + file + "' is truncated.");
+    }
+    partial.sequenceWeights.assign(weights.begin(), weights.end());
+
+    return partial;
+}
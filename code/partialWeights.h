@@ -0,0 +1,56 @@
+/**
+ * @file partialWeights.h
+ * @brief This file contains the declaration of the PartialWeights class.
+ *
+ * Partial weights keep the number of homologs of each sequence found within a subset of the pairs of sequences,
+ * e.g. the row tiles of the triangle of sequence pairs assigned to one shard of a multi-node run.
+ * Partial weights of all shards are summed to get the sequence weights of the MSA.
+ */
+
+#ifndef PARTIAL_WEIGHTS_H
+#define PARTIAL_WEIGHTS_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include "common.h"
+
+/// @brief Compute a hash of the encoded sequences and of the parameters the number of homologs depends on
+/// @param sequences
+/// @param threshold
+/// @param isSymmetric
+/// @param standardLetters
+/// @param nonStandardOption
+/// @return
+uint64_t computeInputHash(const std::vector<std::vector<int>>& sequences, float threshold, bool isSymmetric,
+                          const std::string& standardLetters, NonStandardHandler nonStandardOption);
+
+class PartialWeights
+{
+public:
+    uint64_t inputHash; // hash of the encoded sequences and parameters the weights are computed for
+    int shard;          // index of the shard (starting from 0)
+    int shardCount;
+    int length;         // length of the encoded sequences
+    std::vector<int> sequenceWeights; // number of homologs of each sequence found within the pairs (excluding itself)
+
+    /// @brief Write the partial weights in a binary file; the file is replaced atomically
+    /// @param file
+    void write(const std::string& file) const;
+
+    /// @brief Read partial weights from a binary file
+    /// @param file
+    /// @return
+    static PartialWeights read(const std::string& file);
+
+    /// @brief Get the number of homologs of each sequence (including itself), when weights cover all pairs of sequences
+    /// @return
+    std::vector<int> getSequenceWeights() const;
+
+    /// @brief Sum partial weights of all shards of an MSA
+    /// @param files files of all shards, in any order
+    /// @return partial weights covering all pairs of sequences
+    static PartialWeights merge(const std::vector<std::string>& files);
+};
+
+#endif
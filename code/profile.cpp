@@ -0,0 +1,218 @@
+/**
+ * @file profile.cpp
+ * @brief This file contains the implementation of the Profile class.
+ *
+ * File layout (little-endian):
+ *   magic "NEFFPROF", version (uint32), length (int32), number of letters (int32), letters (gap first),
+ *   pseudocount (float32), frequencies (length x letters float32), entropy (length x float32),
+ *   scores (length x (letters - 1) float32)
+ */
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <filesystem>
+#include <stdexcept>
+#include "common.h"
+#include "profile.h"
+#include "binaryIO.h"
+
+using namespace std;
+
+static const char PROFILE_MAGIC[8] = {'N', 'E', 'F', 'F', 'P', 'R', 'O', 'F'};
+static const uint32_t PROFILE_VERSION = 1;
+
+// Number of columns of each block of columns whose residues are counted by a thread
+static const int PROFILE_BLOCK_SIZE = 64;
+
+int Profile::getLength() const
+{
+    return letters.empty() ? 0 : frequencies.size() / letters.size();
+}
+
+void Profile::write(const string& file) const
+{
+    string tempFile = file + ".tmp";
+    {
+        ofstream output(tempFile, ios::binary);
+        if (!output)
+        {
+            throw runtime_error("Failed to create file: " + tempFile);
+        }
+
+        output.write(PROFILE_MAGIC, sizeof(PROFILE_MAGIC));
+        writeValue<uint32_t>(output, PROFILE_VERSION);
+        writeValue<int32_t>(output, getLength());
+        writeValue<int32_t>(output, letters.size());
+        output.write(letters.data(), letters.size());
+        writeValue<float>(output, pseudocount);
+        output.write(reinterpret_cast<const char*>(frequencies.data()), frequencies.size() * sizeof(float));
+        output.write(reinterpret_cast<const char*>(entropy.data()), entropy.size() * sizeof(float));
+        output.write(reinterpret_cast<const char*>(scores.data()), scores.size() * sizeof(float));
+
+        if (!output)
+        {
+            throw runtime_error("Failed to write file: " + tempFile);
+        }
+    }
+    filesystem::rename(tempFile, file);
+}
+
+void Profile::writeTSV(const string& file) const
+{
+    string tempFile = file + ".tmp";
+    {
+        ofstream output(tempFile);
+        if (!output)
+        {
+            throw runtime_error("Failed to create file: " + tempFile);
+        }
+
+        int length = getLength();
+        int letterCount = letters.size();
+
+        output << "position";
+        for (char letter : letters)
+        {
+            output << "\tf_" << letter;
+        }
+        output << "\tentropy";
+        for (int a = 1; a < letterCount; a++)
+        {
+            output << "\ts_" << letters[a];
+        }
+        output << '\n';
+
+        for (int position = 0; position < length; position++)
+        {
+            output << position + 1;
+            for (int a = 0; a < letterCount; a++)
+            {
+                output << '\t' << frequencies[(size_t)position * letterCount + a];
+            }
+            output << '\t' << entropy[position];
+            for (int a = 0; a < letterCount - 1; a++)
+            {
+                output << '\t' << scores[(size_t)position * (letterCount - 1) + a];
+            }
+            output << '\n';
+        }
+
+        if (!output)
+        {
+            throw runtime_error("Failed to write file: " + tempFile);
+        }
+    }
+    filesystem::rename(tempFile, file);
+}
+
+vector<double> getBackgroundFrequencies(Alphabet alphabet)
+{
+    if (alphabet == protein)
+    {
+        // in the order of STANDARD_AMINO_ACIDS: ACDEFGHIKLMNPQRSTVWY
+        return {0.074, 0.025, 0.054, 0.054, 0.047, 0.074, 0.026, 0.068, 0.058, 0.099,
+                0.025, 0.045, 0.039, 0.034, 0.052, 0.057, 0.051, 0.073, 0.013, 0.032};
+    }
+    int size = getStandardLetters(alphabet).size();
+    return vector<double>(size, 1.0 / size);
+}
+
+Profile computeProfile(const vector<vector<int>>& sequences, const vector<float>& weights, Alphabet alphabet,
+                       float pseudocount, int threads)
+{
+    if (sequences.empty())
+    {
+        throw runtime_error("There is no sequence to compute the profile of.");
+    }
+    int length = sequences[0].size();
+    string standardLetters = getStandardLetters(alphabet);
+    int letterCount = standardLetters.size() + 1;
+    vector<double> background = getBackgroundFrequencies(alphabet);
+
+    Profile profile;
+    profile.letters = GAP.substr(0, 1) + standardLetters;
+    profile.pseudocount = pseudocount;
+    profile.frequencies.assign((size_t)length * letterCount, 0);
+    profile.entropy.assign(length, 0);
+    profile.scores.assign((size_t)length * (letterCount - 1), 0);
+
+    double sumWeights = 0;
+    for (float weight : weights)
+    {
+        sumWeights += weight;
+    }
+
+    // weighted counts of each block of columns; columns of different blocks are written by one thread only
+    int blockCount = (length + PROFILE_BLOCK_SIZE - 1) / PROFILE_BLOCK_SIZE;
+    atomic<int> nextBlock(0);
+    auto countBlocks = [&]()
+    {
+        vector<double> counts(PROFILE_BLOCK_SIZE * letterCount);
+        int block;
+        while ((block = nextBlock++) < blockCount)
+        {
+            int blockStart = block * PROFILE_BLOCK_SIZE;
+            int blockEnd = min(blockStart + PROFILE_BLOCK_SIZE, length);
+            fill(counts.begin(), counts.end(), 0);
+            for (int row = 0; row < sequences.size(); row++)
+            {
+                const vector<int>& sequence = sequences[row];
+                double weight = weights[row];
+                for (int position = blockStart; position < blockEnd; position++)
+                {
+                    // non-standard letters are counted with gaps
+                    int residue = sequence[position] < letterCount ? sequence[position] : 0;
+                    counts[(position - blockStart) * letterCount + residue] += weight;
+                }
+            }
+
+            for (int position = blockStart; position < blockEnd; position++)
+            {
+                const double* columnCounts = &counts[(position - blockStart) * letterCount];
+                float* columnFrequencies = &profile.frequencies[(size_t)position * letterCount];
+                float* columnScores = &profile.scores[(size_t)position * (letterCount - 1)];
+
+                double residueCount = 0;
+                for (int a = 0; a < letterCount; a++)
+                {
+                    columnFrequencies[a] = sumWeights > 0 ? columnCounts[a] / sumWeights : 0;
+                    residueCount += a > 0 ? columnCounts[a] : 0;
+                }
+
+                double entropy = 0;
+                for (int a = 1; a < letterCount; a++)
+                {
+                    if (columnCounts[a] > 0)
+                    {
+                        double frequency = columnCounts[a] / residueCount;
+                        entropy -= frequency * log2(frequency);
+                    }
+                    // residue counts mixed with pseudocounts of background frequencies
+                    double probability = (columnCounts[a] + pseudocount * background[a-1]) / (residueCount + pseudocount);
+                    columnScores[a-1] = log2(probability / background[a-1]);
+                }
+                profile.entropy[position] = entropy;
+            }
+        }
+    };
+
+    threads = max(1, min(threads, blockCount));
+    vector<thread> workers;
+    for (int t = 1; t < threads; t++)
+    {
+        workers.emplace_back(countBlocks);
+    }
+    countBlocks();
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+
+    return profile;
+}
@@ -0,0 +1,56 @@
+/**
+ * @file profile.h
+ * @brief This file contains the declaration of the Profile class.
+ *
+ * A profile keeps, for each column of an MSA, the frequencies of the gap and standard letters weighted by sequence
+ * weights, the entropy of the residues and the log-odds scores (PSSM) of standard letters with pseudocounts.
+ */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <vector>
+#include <string>
+#include "common.h"
+
+class Profile
+{
+public:
+    std::string letters;             // gap followed by the standard letters, in the order of frequencies
+    float pseudocount;               // weight of background frequencies added to the residue counts of each column
+    std::vector<float> frequencies;  // length x letters.size() weighted frequencies (row-major), summing to 1 for each column
+    std::vector<float> entropy;      // entropy (bits) of the standard letters of each column
+    std::vector<float> scores;       // length x (letters.size() - 1) log-odds scores (bits) of standard letters (row-major)
+
+    /// @brief Get the number of columns of the profile
+    /// @return
+    int getLength() const;
+
+    /// @brief Write the profile in a binary file; the file is replaced atomically
+    /// @param file
+    void write(const std::string& file) const;
+
+    /// @brief Write the profile in a TSV file, one line for each column as 'position, frequencies, entropy, scores'
+    /// (positions starting from 1)
+    /// @param file
+    void writeTSV(const std::string& file) const;
+};
+
+/// @brief Get the background frequencies of the standard letters of the alphabet
+/// (BLOSUM62 frequencies for proteins, uniform for nucleotides)
+/// @param alphabet
+/// @return frequencies in the order of standard letters
+std::vector<double> getBackgroundFrequencies(Alphabet alphabet);
+
+/// @brief Compute the weighted profile of the MSA; blocks of columns are counted by threads, pulling blocks from a shared counter.
+/// Non-standard letters are counted with gaps.
+/// @param sequences encoded sequences
+/// @param weights weight of each sequence
+/// @param alphabet
+/// @param pseudocount weight of background frequencies added to the (weighted) residue counts of each column
+/// @param threads
+/// @return
+Profile computeProfile(const std::vector<std::vector<int>>& sequences, const std::vector<float>& weights, Alphabet alphabet,
+                       float pseudocount, int threads);
+
+#endif
@@ -0,0 +1,246 @@
+/**
+ * @file resultCache.cpp
+ * @brief This file contains the implementation of the ResultCache class.
+ *
+ * Entry layout (little-endian):
+ *   magic "NEFFCACH", version (uint32), key (uint64), second hash of the encoded sequences (uint64),
+ *   threshold (float32), is_symmetric (uint8), number of standard letters, non-standard option, depth, length
+ *   (int32 each), number of homologs including each sequence itself (depth x uint32)
+ */
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <sstream>
+#include <iomanip>
+#include <random>
+#include <algorithm>
+#include <stdexcept>
+#include "resultCache.h"
+#include "partialWeights.h"
+#include "neffCalculator.h"
+#include "binaryIO.h"
+
+using namespace std;
+namespace fs = std::filesystem;
+
+static const string ENTRY_EXTENSION = ".weights";
+static const char ENTRY_MAGIC[8] = {'N', 'E', 'F', 'F', 'C', 'A', 'C', 'H'};
+static const uint32_t ENTRY_VERSION = 1;
+
+/// @brief Hash of the encoded sequences computed independently of computeInputHash (multiply-xorshift instead of
+/// FNV-1a), so that two MSAs colliding in one are told apart by the other
+/// @param sequences
+/// @return
+static uint64_t computeCheckHash(const vector<vector<int>>& sequences)
+{
+    uint64_t hash = 0x9e3779b97f4a7c15ULL;
+    for (const auto& sequence : sequences)
+    {
+        for (int residue : sequence)
+        {
+            hash = (hash ^ (uint32_t)residue) * 0xbf58476d1ce4e5b9ULL;
+            hash ^= hash >> 31;
+        }
+    }
+    return hash;
+}
+
+bool ResultCache::EntryInfo::operator==(const EntryInfo& other) const
+{
+    return key == other.key && checkHash == other.checkHash && threshold == other.threshold
+           && isSymmetric == other.isSymmetric && standardLetterCount == other.standardLetterCount
+           && nonStandardOption == other.nonStandardOption && depth == other.depth && length == other.length;
+}
+
+ResultCache::ResultCache(const string& _directory, long long _maxSize)
+: directory(_directory), maxSize(_maxSize)
+{
+    if (!directory.empty())
+    {
+        fs::create_directories(directory);
+    }
+}
+
+fs::path ResultCache::getEntryFile(uint64_t key) const
+{
+    ostringstream name;
+    name << hex << setw(16) << setfill('0') << key << ENTRY_EXTENSION;
+    return directory / name.str();
+}
+
+bool ResultCache::lookup(const EntryInfo& info, vector<int>& sequenceWeights) const
+{
+    fs::path file = getEntryFile(info.key);
+    ifstream input(file, ios::binary);
+    if (!input)
+    {
+        // no entry, or removed by another process
+        return false;
+    }
+
+    EntryInfo entry;
+    vector<uint32_t> weights;
+    try
+    {
+        char magic[sizeof(ENTRY_MAGIC)];
+        if (!input.read(magic, sizeof(magic)) || memcmp(magic, ENTRY_MAGIC, sizeof(magic)) != 0
+            || readValue<uint32_t>(input, file.string()) != ENTRY_VERSION)
+        {
+            return false;
+        }
+        entry.key = readValue<uint64_t>(input, file.string());
+        entry.checkHash = readValue<uint64_t>(input, file.string());
+        entry.threshold = readValue<float>(input, file.string());
+        entry.isSymmetric = readValue<uint8_t>(input, file.string());
+        entry.standardLetterCount = readValue<int32_t>(input, file.string());
+        entry.nonStandardOption = readValue<int32_t>(input, file.string());
+        entry.depth = readValue<int32_t>(input, file.string());
+        entry.length = readValue<int32_t>(input, file.string());
+        if (!(entry == info))
+        {
+            return false;
+        }
+
+        weights.resize(entry.depth);
+        if (!input.read(reinterpret_cast<char*>(weights.data()), entry.depth * sizeof(uint32_t)))
+        {
+            return false;
+        }
+    }
+    catch (const runtime_error& e)
+    {
+        // truncated entry
+        return false;
+    }
+
+    // recently used entries are kept when the cache is full
+    error_code error;
+    fs::last_write_time(file, fs::file_time_type::clock::now(), error);
+    sequenceWeights.assign(weights.begin(), weights.end());
+    return true;
+}
+
+void ResultCache::store(const EntryInfo& info, const vector<int>& sequenceWeights) const
+{
+    // a name of the temporary file unique to this process, as other processes may store the same entry
+    random_device random;
+    fs::path tempFile = getEntryFile(info.key);
+    tempFile += "." + to_string(random()) + ".tmp";
+    try
+    {
+        {
+            ofstream output(tempFile, ios::binary);
+            if (!output)
+            {
+                throw runtime_error("Failed to create file: " + tempFile.string());
+            }
+
+            output.write(ENTRY_MAGIC, sizeof(ENTRY_MAGIC));
+            writeValue<uint32_t>(output, ENTRY_VERSION);
+            writeValue<uint64_t>(output, info.key);
+            writeValue<uint64_t>(output, info.checkHash);
+            writeValue<float>(output, info.threshold);
+            writeValue<uint8_t>(output, info.isSymmetric);
+            writeValue<int32_t>(output, info.standardLetterCount);
+            writeValue<int32_t>(output, info.nonStandardOption);
+            writeValue<int32_t>(output, info.depth);
+            writeValue<int32_t>(output, info.length);
+
+            vector<uint32_t> weights(sequenceWeights.begin(), sequenceWeights.end());
+            output.write(reinterpret_cast<const char*>(weights.data()), weights.size() * sizeof(uint32_t));
+            if (!output)
+            {
+                throw runtime_error("Failed to write file: " + tempFile.string());
+            }
+        }
+        fs::rename(tempFile, getEntryFile(info.key));
+        evict();
+    }
+    catch (const exception& e)
+    {
+        error_code error;
+        fs::remove(tempFile, error);
+        cerr << "Failed to add the result to the cache: " << e.what() << endl;
+    }
+}
+
+void ResultCache::evict() const
+{
+    vector<pair<fs::file_time_type, fs::path>> entries;
+    long long totalSize = 0;
+    error_code error;
+    for (const auto& item : fs::directory_iterator(directory, error))
+    {
+        if (item.path().extension() != ENTRY_EXTENSION)
+        {
+            continue;
+        }
+        // entries may be removed by other processes meanwhile
+        uintmax_t size = item.file_size(error);
+        if (error)
+        {
+            continue;
+        }
+        fs::file_time_type time = item.last_write_time(error);
+        if (error)
+        {
+            continue;
+        }
+        totalSize += size;
+        entries.push_back({time, item.path()});
+    }
+
+    sort(entries.begin(), entries.end());
+    for (const auto& entry : entries)
+    {
+        if (totalSize <= maxSize)
+        {
+            break;
+        }
+        uintmax_t size = fs::file_size(entry.second, error);
+        if (!error && fs::remove(entry.second, error))
+        {
+            totalSize -= size;
+        }
+    }
+}
+
+vector<int> ResultCache::getWeights(const vector<vector<int>>& sequences, float threshold, bool isSymmetric,
+                                    const string& standardLetters, NonStandardHandler nonStandardOption, int threads,
+                                    chrono::steady_clock::time_point deadline, bool* hit) const
+{
+    if (hit != nullptr)
+    {
+        *hit = false;
+    }
+    if (directory.empty() || sequences.empty())
+    {
+        return computeWeights(sequences, threshold, isSymmetric, standardLetters, nonStandardOption, threads, deadline);
+    }
+
+    EntryInfo info;
+    info.key = computeInputHash(sequences, threshold, isSymmetric, standardLetters, nonStandardOption);
+    info.checkHash = computeCheckHash(sequences);
+    info.threshold = threshold;
+    info.isSymmetric = isSymmetric;
+    info.standardLetterCount = standardLetters.size();
+    info.nonStandardOption = nonStandardOption;
+    info.depth = sequences.size();
+    info.length = sequences[0].size();
+    vector<int> sequenceWeights;
+    if (lookup(info, sequenceWeights))
+    {
+        if (hit != nullptr)
+        {
+            *hit = true;
+        }
+        return sequenceWeights;
+    }
+
+    sequenceWeights = computeWeights(sequences, threshold, isSymmetric, standardLetters, nonStandardOption, threads, deadline);
+    store(info, sequenceWeights);
+    return sequenceWeights;
+}
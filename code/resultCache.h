@@ -0,0 +1,90 @@
+/**
+ * @file resultCache.h
+ * @brief This file contains the declaration of the ResultCache class.
+ *
+ * The result cache keeps the number of homologs of each sequence of computed MSAs in a directory, to be reused by
+ * later runs on the same MSA. Entries are addressed by the hash of the encoded sequences (after omitting query gaps,
+ * limiting the depth and positions and removing gappy positions) and of the similarity parameters (threshold,
+ * is_symmetric, the number of standard letters of the alphabet and non_standard_option), so that NEFF, weights and
+ * per-residue NEFF of any normalization are computed from the same entry without comparing sequences. Each entry
+ * also keeps its parameters, shape and a second hash of the encoded sequences, independent of the address, which are
+ * verified when it is read, so that a collision of addresses is computed again instead of reusing another MSA.
+ *
+ * Entries are written to a temporary file and renamed, so concurrent processes only read complete entries.
+ * Reading an entry updates its modification time; when the entries exceed the maximum size of the cache, the least
+ * recently used entries are removed.
+ */
+
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include "common.h"
+
+class ResultCache
+{
+public:
+    /// @brief Constructor
+    /// @param _directory directory of the entries (created if it does not exist); empty to disable the cache
+    /// @param _maxSize maximum total size of the entries in bytes
+    ResultCache(const std::string& _directory, long long _maxSize);
+
+    /// @brief Get the number of homologs of each sequence from the cache, or compute them and add them to the cache
+    /// @param sequences encoded sequences
+    /// @param threshold
+    /// @param isSymmetric
+    /// @param standardLetters
+    /// @param nonStandardOption
+    /// @param threads
+    /// @param deadline
+    /// @param hit set to whether the weights are read from the cache (may be nullptr)
+    /// @return
+    std::vector<int> getWeights(const std::vector<std::vector<int>>& sequences, float threshold, bool isSymmetric,
+                                const std::string& standardLetters, NonStandardHandler nonStandardOption, int threads,
+                                std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max(),
+                                bool* hit = nullptr) const;
+
+private:
+    /// @brief Address and content of an entry, other than the number of homologs
+    struct EntryInfo
+    {
+        uint64_t key;             // address of the entry (hash of the encoded sequences and parameters)
+        uint64_t checkHash;       // hash of the encoded sequences, independent of the key
+        float threshold;
+        bool isSymmetric;
+        int standardLetterCount;  // encoded sequences are only compared by the number of standard letters
+        int nonStandardOption;
+        int depth;
+        int length;
+
+        bool operator==(const EntryInfo& other) const;
+    };
+
+    std::filesystem::path directory;
+    long long maxSize;
+
+    /// @brief Get the file of the entry of a key
+    /// @param key
+    /// @return
+    std::filesystem::path getEntryFile(uint64_t key) const;
+
+    /// @brief Read the number of homologs of each sequence of an entry
+    /// @param info
+    /// @param sequenceWeights
+    /// @return false if there is no entry of the key, or if its parameters, shape or second hash differ
+    bool lookup(const EntryInfo& info, std::vector<int>& sequenceWeights) const;
+
+    /// @brief Add an entry; failures of writing the entry are reported without failing the computation
+    /// @param info
+    /// @param sequenceWeights
+    void store(const EntryInfo& info, const std::vector<int>& sequenceWeights) const;
+
+    /// @brief Remove the least recently used entries until their total size is within the maximum size
+    void evict() const;
+};
+
+#endif
@@ -0,0 +1,337 @@
+/**
+ * @file resultWriter.cpp
+ * @brief This file contains the implementation of functions to write NEFF results in machine-readable formats.
+ */
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <cstdint>
+#include <cstdio>
+#include <cmath>
+#include <charconv>
+#include <filesystem>
+#include <algorithm>
+#include <stdexcept>
+#include "resultWriter.h"
+#include "binaryIO.h"
+
+using namespace std;
+
+// Number of characters formatted before writing them to the output
+static const size_t FORMAT_BUFFER_SIZE = 1 << 16;
+
+string formatFloat(float value)
+{
+    char buffer[32];
+    to_chars_result result = to_chars(buffer, buffer + sizeof(buffer), value);
+    return string(buffer, result.ptr);
+}
+
+/// @brief Write values separated by the given separator, formatted with std::to_chars in chunks
+/// @param output
+/// @param values
+/// @param separator
+static void writeFloats(ostream& output, const vector<float>& values, char separator)
+{
+    string chunk;
+    chunk.reserve(FORMAT_BUFFER_SIZE + 32);
+    char buffer[32];
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        if (i > 0)
+        {
+            chunk += separator;
+        }
+        to_chars_result result = to_chars(buffer, buffer + sizeof(buffer), values[i]);
+        chunk.append(buffer, result.ptr);
+        if (chunk.size() >= FORMAT_BUFFER_SIZE)
+        {
+            output.write(chunk.data(), chunk.size());
+            chunk.clear();
+        }
+    }
+    output.write(chunk.data(), chunk.size());
+}
+
+void writeNpy(ostream& output, const vector<float>& values)
+{
+    string header = "{'descr': '<f4', 'fortran_order': False, 'shape': (" + to_string(values.size()) + ",), }";
+    // magic, version and header length take 10 bytes; the header is padded so that the data is aligned to 64 bytes
+    size_t headerLength = (10 + header.size() + 1 + 63) / 64 * 64 - 10;
+    header.resize(headerLength - 1, ' ');
+    header += '\n';
+
+    output.write("\x93NUMPY", 6);
+    writeValue<uint8_t>(output, 1);
+    writeValue<uint8_t>(output, 0);
+    writeValue<uint16_t>(output, headerLength);
+    output.write(header.data(), header.size());
+    output.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(float));
+}
+
+string escapeJSON(const string& text)
+{
+    string escaped;
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            escaped += '\\';
+            escaped += c;
+        }
+        else if ((unsigned char)c < 0x20)
+        {
+            char buffer[8];
+            snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+            escaped += buffer;
+        }
+        else
+        {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+/// @brief Format NEFF of a row of a table, as 'null' in JSON if it is not computed
+/// @param value
+/// @param isJSON
+/// @return
+static string formatTableNeff(float value, bool isJSON)
+{
+    return isJSON && isnan(value) ? "null" : formatFloat(value);
+}
+
+/// @brief Write a table as a JSON member, as a list of one object for each row
+/// @param output
+/// @param table
+static void writeJSONTable(ostream& output, const ResultTable& table)
+{
+    output << ", \"" << table.name << "\": [";
+    for (size_t r = 0; r < table.rows.size(); r++)
+    {
+        output << (r > 0 ? ", {" : "{");
+        for (size_t c = 0; c < table.columns.size(); c++)
+        {
+            output << '"' << table.columns[c] << "\": ";
+            if (table.textColumns[c])
+            {
+                output << '"' << escapeJSON(table.rows[r][c]) << '"';
+            }
+            else
+            {
+                output << table.rows[r][c];
+            }
+            output << ", ";
+        }
+        output << "\"neff\": " << formatTableNeff(table.neff[r], true) << '}';
+    }
+    output << ']';
+}
+
+/// @brief Write a table as TSV, one line for each column as '<table>_<column>\t<values>'
+/// @param output
+/// @param table
+static void writeTSVTable(ostream& output, const ResultTable& table)
+{
+    for (size_t c = 0; c < table.columns.size(); c++)
+    {
+        output << table.name << '_' << table.columns[c];
+        for (const auto& row : table.rows)
+        {
+            output << '\t' << row[c];
+        }
+        output << '\n';
+    }
+    output << table.name << "_neff";
+    for (float neff : table.neff)
+    {
+        output << '\t' << formatTableNeff(neff, false);
+    }
+    output << '\n';
+}
+
+/// @brief Write results as the members of a JSON object, without its braces
+/// @param output
+/// @param results
+static void writeJSONMembers(ostream& output, const NeffResults& results)
+{
+    output << "\"length\": " << results.length << ", \"depth\": " << results.depth;
+    if (results.hasNeff)
+    {
+        output << ", \"neff\": " << formatFloat(results.neff);
+    }
+    if (!results.weights.empty())
+    {
+        output << ", \"weights\": [";
+        writeFloats(output, results.weights, ',');
+        output << ']';
+    }
+    if (!results.residueNeff.empty())
+    {
+        output << ", \"residue_neff\": [";
+        writeFloats(output, results.residueNeff, ',');
+        output << "], \"median_residue_neff\": " << formatFloat(results.medianResidueNeff);
+    }
+    if (!results.localNeff.empty())
+    {
+        output << ", \"window\": " << results.window << ", \"local_neff\": [";
+        writeFloats(output, results.localNeff, ',');
+        output << "], \"median_local_neff\": " << formatFloat(results.medianLocalNeff);
+    }
+    for (const ResultTable& table : results.tables)
+    {
+        writeJSONTable(output, table);
+    }
+}
+
+/// @brief Write results as a JSON object
+/// @param output
+/// @param results
+static void writeJSON(ostream& output, const NeffResults& results)
+{
+    output << '{';
+    writeJSONMembers(output, results);
+    output << "}\n";
+}
+
+/// @brief Write results as TSV, one line for each value or list of values as '<name>\t<values>'
+/// @param output
+/// @param results
+static void writeTSV(ostream& output, const NeffResults& results)
+{
+    output << "length\t" << results.length << "\ndepth\t" << results.depth << '\n';
+    if (results.hasNeff)
+    {
+        output << "neff\t" << formatFloat(results.neff) << '\n';
+    }
+    if (!results.weights.empty())
+    {
+        output << "weights\t";
+        writeFloats(output, results.weights, '\t');
+        output << '\n';
+    }
+    if (!results.residueNeff.empty())
+    {
+        output << "residue_neff\t";
+        writeFloats(output, results.residueNeff, '\t');
+        output << "\nmedian_residue_neff\t" << formatFloat(results.medianResidueNeff) << '\n';
+    }
+    if (!results.localNeff.empty())
+    {
+        output << "window\t" << results.window << "\nlocal_neff\t";
+        writeFloats(output, results.localNeff, '\t');
+        output << "\nmedian_local_neff\t" << formatFloat(results.medianLocalNeff) << '\n';
+    }
+    for (const ResultTable& table : results.tables)
+    {
+        writeTSVTable(output, table);
+    }
+}
+
+void writeResults(ostream& output, const NeffResults& results, const string& format)
+{
+    if (format == "json")
+    {
+        writeJSON(output, results);
+    }
+    else if (format == "tsv")
+    {
+        writeTSV(output, results);
+    }
+    else if (!results.weights.empty())
+    {
+        writeNpy(output, results.weights);
+    }
+    else if (!results.residueNeff.empty())
+    {
+        writeNpy(output, results.residueNeff);
+    }
+    else if (!results.localNeff.empty())
+    {
+        writeNpy(output, results.localNeff);
+    }
+    else if (!results.tables.empty())
+    {
+        writeNpy(output, results.tables[0].neff);
+    }
+    else
+    {
+        writeNpy(output, {results.neff});
+    }
+}
+
+void writeResults(const NeffResults& results, const string& format, const string& file)
+{
+    if (file.empty())
+    {
+        writeResults(cout, results, format);
+        cout << flush;
+        return;
+    }
+
+    string tempFile = file + ".tmp";
+    {
+        ofstream output(tempFile, ios::binary);
+        if (!output)
+        {
+            throw runtime_error("Failed to create file: " + tempFile);
+        }
+
+        writeResults(output, results, format);
+
+        if (!output)
+        {
+            throw runtime_error("Failed to write file: " + tempFile);
+        }
+    }
+    filesystem::rename(tempFile, file);
+}
+
+void writeEntryHeader(ostream& output)
+{
+    output << "line\tfile\tstatus\tlength\tdepth\tneff\tmedian_residue_neff\tvalues\terror\n";
+}
+
+void writeEntryResults(ostream& output, int line, const string& file, const NeffResults* results, const string& error,
+                       const string& format)
+{
+    if (format == "json")
+    {
+        output << "{\"line\": " << line << ", \"file\": \"" << escapeJSON(file) << "\", ";
+        if (results == nullptr)
+        {
+            output << "\"status\": \"error\", \"error\": \"" << escapeJSON(error) << "\"}\n";
+            return;
+        }
+        output << "\"status\": \"ok\", ";
+        writeJSONMembers(output, *results);
+        output << "}\n";
+        return;
+    }
+
+    output << line << '\t' << file << '\t';
+    if (results == nullptr)
+    {
+        // a message is written in one field
+        string message = error;
+        replace_if(message.begin(), message.end(), [](char c) { return c == '\t' || c == '\n' || c == '\r'; }, ' ');
+        output << "error\t\t\t\t\t\t" << message << '\n';
+        return;
+    }
+    output << "ok\t" << results->length << '\t' << results->depth << '\t';
+    if (results->hasNeff)
+    {
+        output << formatFloat(results->neff);
+    }
+    output << '\t';
+    if (!results->residueNeff.empty())
+    {
+        output << formatFloat(results->medianResidueNeff);
+    }
+    output << '\t';
+    writeFloats(output, results->weights.empty() ? results->residueNeff : results->weights, ',');
+    output << "\t\n";
+}
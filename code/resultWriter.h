@@ -0,0 +1,92 @@
+/**
+ * @file resultWriter.h
+ * @brief This file contains the declaration of functions to write NEFF results in machine-readable formats.
+ *
+ * Results (NEFF, sequence weights or per-residue NEFF) can be written as JSON, as TSV (one line for each value or list
+ * of values, as '<name>\t<values>') or as an .npy array of float32, to be loaded without parsing.
+ * NEFF of several settings of an MSA (e.g. of each depth of 'depth_curve') is written as a table: in JSON, as a list of
+ * one object for each row; in TSV, as one line for each column, as '<table>_<column>\t<values>'; as .npy, as the
+ * array of NEFF of the rows.
+ * Results of the entries of a batch are written as one line for each entry, as JSON Lines or TSV.
+ */
+
+#ifndef RESULT_WRITER_H
+#define RESULT_WRITER_H
+
+#include <vector>
+#include <string>
+#include <iostream>
+
+const std::vector<std::string> OUTPUT_FORMATS = {"text", "json", "tsv", "npy"};
+
+// NEFF of several settings of an MSA, one row for each setting
+struct ResultTable
+{
+    std::string name;                           // name of the table (e.g. depth_curve)
+    std::vector<std::string> columns;           // names of the columns identifying the setting of each row (e.g. depth)
+    std::vector<bool> textColumns;              // whether the values of each column are text (written as JSON strings)
+    std::vector<std::vector<std::string>> rows; // values of the columns of each row
+    std::vector<float> neff;                    // NEFF of each row (NaN if it is not computed)
+};
+
+// Results of computing NEFF of an MSA
+struct NeffResults
+{
+    int length;                      // length of MSA sequences
+    int depth;                       // depth of MSA
+    bool hasNeff = false;            // whether NEFF is reported
+    float neff = 0;
+    std::vector<float> weights;      // sequence weights (empty if not reported)
+    std::vector<float> residueNeff;  // per-residue NEFF (empty if not reported)
+    float medianResidueNeff = 0;
+    int window = 0;                  // window of local NEFF
+    std::vector<float> localNeff;    // per-position local NEFF (empty if not reported)
+    float medianLocalNeff = 0;
+    std::vector<ResultTable> tables; // NEFF of several settings (empty if not reported)
+};
+
+/// @brief Format a float with the shortest representation that is read back as the same float
+/// @param value
+/// @return
+std::string formatFloat(float value);
+
+/// @brief Escape a text to be written in a JSON string
+/// @param text
+/// @return
+std::string escapeJSON(const std::string& text);
+
+/// @brief Write values as a one-dimensional .npy array of little-endian float32
+/// @param output
+/// @param values
+void writeNpy(std::ostream& output, const std::vector<float>& values);
+
+/// @brief Write results in the given format in the output stream
+/// @param output
+/// @param results
+/// @param format json, tsv or npy
+void writeResults(std::ostream& output, const NeffResults& results, const std::string& format);
+
+/// @brief Write results in the given format, in the file (replaced atomically) or in the standard output if file is empty.
+/// As .npy, only the reported array is written (sequence weights, per-residue NEFF, local NEFF, NEFF of the rows of the
+/// first table or NEFF as an array of one value).
+/// @param results
+/// @param format json, tsv or npy
+/// @param file
+void writeResults(const NeffResults& results, const std::string& format, const std::string& file);
+
+/// @brief Write the header line of TSV results of the entries of a batch
+/// @param output
+void writeEntryHeader(std::ostream& output);
+
+/// @brief Write the results of an entry of a batch as one line of JSON Lines or TSV; in TSV, sequence weights or
+/// per-residue NEFF are written comma-separated in the 'values' field
+/// @param output
+/// @param line line of the entry in the batch file
+/// @param file input file(s) of the entry
+/// @param results results of the entry, or nullptr if it failed
+/// @param error message of the failure
+/// @param format json or tsv
+void writeEntryResults(std::ostream& output, int line, const std::string& file, const NeffResults* results,
+                       const std::string& error, const std::string& format);
+
+#endif
@@ -0,0 +1,291 @@
+/**
+ * @file weightState.cpp
+ * @brief This file contains the implementation of the WeightState class.
+ *
+ * File layout (little-endian):
+ *   magic "NEFFSTAT", version (uint32),
+ *   alphabet, non-standard option, is_symmetric, omit_query_gaps (uint8 each), threshold (float32),
+ *   pos_start, pos_end, depth, length (int32 each),
+ *   encoded sequences (depth x length uint8), number of homologs (depth x uint32), sequence digests (depth x uint64)
+ */
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <unordered_set>
+#include <unordered_map>
+#include "common.h"
+#include "neffCalculator.h"
+#include "weightState.h"
+#include "binaryIO.h"
+
+using namespace std;
+
+static const char STATE_MAGIC[8] = {'N', 'E', 'F', 'F', 'S', 'T', 'A', 'T'};
+static const uint32_t STATE_VERSION = 2;
+
+uint64_t WeightState::getSequenceDigest(const string& sequence)
+{
+    // FNV-1a
+    uint64_t digest = 14695981039346656037ULL;
+    for (unsigned char letter : sequence)
+    {
+        digest ^= letter;
+        digest *= 1099511628211ULL;
+    }
+    return digest;
+}
+
+void WeightState::checkCompatibility(const WeightState& other, const string& name) const
+{
+    if (alphabet != other.alphabet)
+        throw runtime_error("'alphabet' of '" + name + "' does not match.");
+    if (nonStandardOption != other.nonStandardOption)
+        throw runtime_error("'non_standard_option' of '" + name + "' does not match.");
+    if (isSymmetric != other.isSymmetric)
+        throw runtime_error("'is_symmetric' of '" + name + "' does not match.");
+    if (threshold != other.threshold)
+        throw runtime_error("'threshold' of '" + name + "' does not match.");
+    if (omitGapsInQuery != other.omitGapsInQuery)
+        throw runtime_error("'omit_query_gaps' of '" + name + "' does not match.");
+    if (posStart != other.posStart || posEnd != other.posEnd)
+        throw runtime_error("'pos_start' and 'pos_end' of '" + name + "' do not match.");
+    if (!sequences.empty() && !other.sequences.empty() && sequences[0].size() != other.sequences[0].size())
+        throw runtime_error("Length of sequences in '" + name + "' is not the same.");
+}
+
+int WeightState::append(const vector<vector<int>>& newSequences, const vector<uint64_t>& newDigests)
+{
+    if (newSequences.empty())
+    {
+        return 0;
+    }
+    if (!sequences.empty())
+    {
+        if (newSequences[0].size() != sequences[0].size())
+        {
+            throw runtime_error("Length of appended sequences (" + to_string(newSequences[0].size())
+                                + ") is not the same as the state (" + to_string(sequences[0].size()) + ").");
+        }
+        if (newSequences[0] != sequences[0])
+        {
+            throw runtime_error("Appended MSA should be aligned to the same query sequence as the state.");
+        }
+    }
+
+    unordered_set<uint64_t> existingSequences(sequenceDigests.begin(), sequenceDigests.end());
+
+    int oldDepth = sequences.size();
+
+    // keep only the sequences that are not already in the state
+    for (int i = 0; i < newSequences.size(); i++)
+    {
+        if (existingSequences.insert(newDigests[i]).second)
+        {
+            sequences.push_back(newSequences[i]);
+            sequenceDigests.push_back(newDigests[i]);
+        }
+    }
+
+    int depth = sequences.size();
+    sequenceWeights.resize(depth, 1);
+
+    if (depth > oldDepth)
+    {
+        SimilarityCalculator similarityCalculator(sequences, threshold, isSymmetric, getStandardLetters(alphabet), nonStandardOption);
+        similarityCalculator.countHomologs(oldDepth, depth, 0, depth, sequenceWeights);
+    }
+
+    return depth - oldDepth;
+}
+
+int WeightState::merge(const WeightState& other)
+{
+    int depth = sequences.size();
+    int otherDepth = other.sequences.size();
+
+    unordered_map<uint64_t, int> sequenceIndex; // index of each distinct sequence in the integrated state
+    for (int i = 0; i < depth; i++)
+    {
+        sequenceIndex.emplace(sequenceDigests[i], i);
+    }
+
+    vector<int> duplicates(depth, 0);  // number of removed sequences of the other state identical to each sequence
+    vector<int> keptWeights;           // number of homologs of kept sequences, within the other state
+    for (int t = 0; t < otherDepth; t++)
+    {
+        auto inserted = sequenceIndex.emplace(other.sequenceDigests[t], sequences.size());
+        if (inserted.second)
+        {
+            sequences.push_back(other.sequences[t]);
+            sequenceDigests.push_back(other.sequenceDigests[t]);
+            keptWeights.push_back(other.sequenceWeights[t]);
+            duplicates.push_back(0);
+        }
+        else
+        {
+            duplicates[inserted.first->second]++;
+        }
+    }
+
+    int newDepth = sequences.size();
+    if (newDepth == depth)
+    {
+        return 0;
+    }
+
+    SimilarityCalculator similarityCalculator(sequences, threshold, isSymmetric, getStandardLetters(alphabet), nonStandardOption);
+    bool similarToI, similarToJ;
+
+    // removed duplicates of kept sequences were counted as homologs within the other state
+    for (int q = depth; q < newDepth; q++)
+    {
+        if (duplicates[q] == 0)
+        {
+            continue;
+        }
+        keptWeights[q - depth] -= duplicates[q]; // identical sequences are always homologs
+        for (int k = depth; k < newDepth; k++)
+        {
+            if (k == q)
+            {
+                continue;
+            }
+            similarityCalculator.compare(k, q, similarToI, similarToJ);
+            keptWeights[k - depth] -= similarToI * duplicates[q];
+        }
+    }
+
+    // compare only the sequences of two states;
+    // removed duplicates of sequences of this state were counted as homologs within the other state
+    sequenceWeights.resize(newDepth);
+    for (int i = 0; i < depth; i++)
+    {
+        for (int k = depth; k < newDepth; k++)
+        {
+            similarityCalculator.compare(i, k, similarToI, similarToJ);
+            sequenceWeights[i] += similarToI;
+            keptWeights[k - depth] += similarToJ * (1 - duplicates[i]);
+        }
+    }
+    copy(keptWeights.begin(), keptWeights.end(), sequenceWeights.begin() + depth);
+
+    return newDepth - depth;
+}
+
+void WeightState::write(const string& file) const
+{
+    if (sequenceWeights.size() != sequences.size() || sequenceDigests.size() != sequences.size())
+    {
+        throw runtime_error("Weight state of '" + file + "' does not have a weight and a digest for each sequence.");
+    }
+
+    string tempFile = file + ".tmp";
+    {
+        ofstream output(tempFile, ios::binary);
+        if (!output)
+        {
+            throw runtime_error("Failed to create file: " + tempFile);
+        }
+
+        int depth = sequences.size();
+        int length = depth > 0 ? sequences[0].size() : 0;
+
+        output.write(STATE_MAGIC, sizeof(STATE_MAGIC));
+        writeValue<uint32_t>(output, STATE_VERSION);
+        writeValue<uint8_t>(output, alphabet);
+        writeValue<uint8_t>(output, nonStandardOption);
+        writeValue<uint8_t>(output, isSymmetric);
+        writeValue<uint8_t>(output, omitGapsInQuery);
+        writeValue<float>(output, threshold);
+        writeValue<int32_t>(output, posStart);
+        writeValue<int32_t>(output, posEnd);
+        writeValue<int32_t>(output, depth);
+        writeValue<int32_t>(output, length);
+
+        vector<uint8_t> row(length);
+        for (const auto& sequence : sequences)
+        {
+            copy(sequence.begin(), sequence.end(), row.begin());
+            output.write(reinterpret_cast<const char*>(row.data()), length);
+        }
+        for (int weight : sequenceWeights)
+        {
+            writeValue<uint32_t>(output, weight);
+        }
+        for (uint64_t digest : sequenceDigests)
+        {
+            writeValue<uint64_t>(output, digest);
+        }
+
+        if (!output)
+        {
+            throw runtime_error("Failed to write file: " + tempFile);
+        }
+    }
+    // replace the previous state only when the new one is completely written
+    filesystem::rename(tempFile, file);
+}
+
+WeightState WeightState::read(const string& file)
+{
+    ifstream input(file, ios::binary);
+    if (!input)
+    {
+        throw runtime_error("Failed to open the weight state file '" + file + "'.");
+    }
+
+    char magic[sizeof(STATE_MAGIC)];
+    if (!input.read(magic, sizeof(magic)) || memcmp(magic, STATE_MAGIC, sizeof(magic)) != 0)
+    {
+        throw runtime_error("'" + file + "' is not a weight state file.");
+    }
+    if (readValue<uint32_t>(input, file) != STATE_VERSION)
+    {
+        throw runtime_error("Unsupported version of the weight state file '" + file + "'; it should be written again "
+                            "with 'state_out'.");
+    }
+
+    WeightState state;
+    state.alphabet = static_cast<Alphabet>(readValue<uint8_t>(input, file));
+    state.nonStandardOption = static_cast<NonStandardHandler>(readValue<uint8_t>(input, file));
+    state.isSymmetric = readValue<uint8_t>(input, file);
+    state.omitGapsInQuery = readValue<uint8_t>(input, file);
+    state.threshold = readValue<float>(input, file);
+    state.posStart = readValue<int32_t>(input, file);
+    state.posEnd = readValue<int32_t>(input, file);
+    int depth = readValue<int32_t>(input, file);
+    int length = readValue<int32_t>(input, file);
+
+    vector<uint8_t> row(length);
+    state.sequences.reserve(depth);
+    for (int i = 0; i < depth; i++)
+    {
+        if (!input.read(reinterpret_cast<char*>(row.data()), length))
+        {
+            throw runtime_error("File '" + file + "' is truncated.");
+        }
+        state.sequences.emplace_back(row.begin(), row.end());
+    }
+    state.sequenceWeights.reserve(depth);
+    for (int i = 0; i < depth; i++)
+    {
+        state.sequenceWeights.push_back(readValue<uint32_t>(input, file));
+    }
+    state.sequenceDigests.reserve(depth);
+    for (int i = 0; i < depth; i++)
+    {
+        state.sequenceDigests.push_back(readValue<uint64_t>(input, file));
+    }
+    // a digest for each sequence, and nothing after them
+    if (input.peek() != char_traits<char>::eof())
+    {
+        throw runtime_error("Weight state file '" + file + "' is corrupted.");
+    }
+
+    return state;
+}
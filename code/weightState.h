@@ -0,0 +1,69 @@
+/**
+ * @file weightState.h
+ * @brief This file contains the declaration of the WeightState class.
+ *
+ * A weight state keeps the encoded sequences of an MSA together with the number of homologs of each sequence,
+ * for the set of parameters they were computed with. It can be persisted in a binary file, so that sequences found
+ * in later iterations of a search can be appended by comparing only the new sequences against all sequences.
+ */
+
+#ifndef WEIGHT_STATE_H
+#define WEIGHT_STATE_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include "common.h"
+
+class WeightState
+{
+public:
+    // parameters the number of homologs are computed with
+    Alphabet alphabet;
+    NonStandardHandler nonStandardOption;
+    bool isSymmetric;
+    float threshold;
+    bool omitGapsInQuery;
+    int posStart;
+    int posEnd;
+
+    std::vector<std::vector<int>> sequences; // encoded sequences, starting from the query sequence
+    std::vector<int> sequenceWeights;        // number of homologs of each sequence (including itself)
+    std::vector<uint64_t> sequenceDigests;   // digest of each sequence as read (after omitting query gaps)
+
+    /// @brief Compute the digest of a sequence as read, to find duplicate sequences the same way as integrating
+    /// MSA files does; different letters may have the same encoding (e.g. non-standard letters with ConsiderGap)
+    /// @param sequence
+    /// @return
+    static uint64_t getSequenceDigest(const std::string& sequence);
+
+    /// @brief Check that the given state is computed with the same parameters and sequence length as this one
+    /// @param other
+    /// @param name name of the other state (for error messages)
+    void checkCompatibility(const WeightState& other, const std::string& name) const;
+
+    /// @brief Append sequences that are not already in the state, and update the number of homologs
+    /// by comparing only the appended sequences against all sequences (new x old + new x new)
+    /// @param newSequences encoded sequences, aligned to the same query sequence as the state
+    /// @param newDigests digest of each new sequence
+    /// @return number of appended sequences
+    int append(const std::vector<std::vector<int>>& newSequences, const std::vector<uint64_t>& newDigests);
+
+    /// @brief Integrate the sequences of another state that are not already in this state (as done for multiple files),
+    /// comparing only the sequences of the two states against each other.
+    /// Number of homologs of the other state are corrected for its removed duplicate sequences.
+    /// @param other state computed with the same parameters
+    /// @return number of integrated sequences
+    int merge(const WeightState& other);
+
+    /// @brief Write the state in a binary file; the file is replaced atomically
+    /// @param file
+    void write(const std::string& file) const;
+
+    /// @brief Read a state from a binary file
+    /// @param file
+    /// @return
+    static WeightState read(const std::string& file);
+};
+
+#endif
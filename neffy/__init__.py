@@ -1 +1 @@
-from .neffy import convert_msa, Alphabet, NonStandardOption, Normalization, compute_neff, compute_multimer_neff, compute_residue_neff
+from .neffy import convert_msa, Alphabet, NonStandardOption, Normalization, compute_neff, compute_multimer_neff, compute_residue_neff, compute_depth_curve, NeffClient
@@ -3,8 +3,19 @@ import os
 from enum import Enum
 import re
 import sys
+import json
+import struct
+import tempfile
+import socket
+from array import array
 from typing import Union, List
 
+# Native extension module backed by the C++ core; computations run the executables when it is not built
+try:
+    from . import _neffy
+except ImportError:
+    _neffy = None
+
 
 # Enum for different biological alphabets
 class Alphabet(Enum):
@@ -57,8 +68,18 @@ def run_exe(args, exe_file):
 
 # To validate input parameters
 def _check_flags(params):
+    # Check that the MSA is given as either files or sequences
+    if (params.get('file') is None) == (params.get('sequences') is None):
+        raise ValueError("Either 'file' or 'sequences' should be given.")
+    if params.get('sequences') is not None and _neffy is None:
+        raise RuntimeError("The native extension module of neffy is not built; 'sequences' cannot be used.")
+    if params.get('sequences') is not None and params.get('cache_dir') is not None:
+        raise ValueError("'cache_dir' can only be used with 'file'.")
+    if params.get('sequences') is not None and (params.get('pos_start', 1) != 1 or params.get('pos_end', 'inf') != 'inf'):
+        raise ValueError("'pos_start' and 'pos_end' can only be used with 'file'.")
+
     # Check file exist
-    files = params['file'] if isinstance(params['file'], list) else [params['file']]
+    files = [] if params.get('file') is None else params['file'] if isinstance(params['file'], list) else [params['file']]
 
     for file_path in files:
         if not os.path.exists(file_path):
@@ -96,6 +117,57 @@ def _check_stoichiometry(stoichiom, chainLength):
     return is_homomer
 
 
+# Whether the MSA of the parameters can be loaded by the native extension module
+# (a single file or in-memory sequences, without the 'pos_start' and 'pos_end' range);
+# results of the cache in 'cache_dir' are read by neff
+def _uses_extension(params):
+    return _neffy is not None and not isinstance(params['file'], list) \
+        and params['pos_start'] == 1 and params['pos_end'] == 'inf' and params.get('cache_dir') is None
+
+
+# Load the MSA of the parameters with the native extension module
+def _load_msa(params):
+    source = params['file'] if params['file'] is not None else params['sequences']
+    return _neffy.MSA(source, params['format'] or None, params['alphabet'].value, params['check_validation'],
+                      params['omit_query_gaps'], params['skip_lines'])
+
+
+# Parameters of computations of the native extension module
+def _extension_params(params):
+    return {
+        'threshold': params['threshold'],
+        'is_symmetric': params['is_symmetric'],
+        'non_standard_option': params['non_standard_option'].value,
+        'gap_cutoff': params['gap_cutoff'],
+        'norm': params['norm'].value,
+        'depth': 0 if params['depth'] == 'inf' else params['depth'],
+        'threads': params['threads'],
+    }
+
+
+# Wrap float32 values (returned by the native extension module or read from the output of neff) in a NumPy array
+# without copying them, or return them as a list when NumPy is not installed
+def _as_array(values):
+    try:
+        import numpy
+    except ImportError:
+        return memoryview(values).tolist()
+    return numpy.frombuffer(values, dtype=numpy.float32)
+
+
+# Value of a float32, as computed by neff, so that results are the same whether they are computed by the native
+# extension module or parsed from the output of neff
+def _float32(value):
+    return struct.unpack('f', struct.pack('f', value))[0]
+
+
+# Median of values, as computed by neff
+def _median(values):
+    values = sorted(values)
+    middle = len(values) // 2
+    return _float32(values[middle] if len(values) % 2 == 1 else (values[middle - 1] + values[middle]) / 2)
+
+
 # Parse general result output
 # Extract sequence length and depth from output
 def parse_result(output):
@@ -104,29 +176,45 @@ def parse_result(output):
         int(re.search(r'MSA depth:\s*(\d+)', output).group(1))
     )
 
-# Parse NEFF value and optionally sequence weights
-def parse_neff(output, only_weights):
-    msa_length, msa_depth = parse_result(output)
+# Parse results written with output_format=json
+def parse_json_result(output):
+    result = json.loads(output)
+    return result['length'], result['depth'], result
 
-    if only_weights:
-        value = list(map(float, re.findall(r'Sequence weights:\n([\d\s\.]+)', output)[0].split()))
 
-    else:
-        value = float(re.search(r'NEFF:\s*([\d.]+)', output).group(1))
+# Read a one-dimensional float32 array written with output_format=npy, without parsing its values
+def read_npy(path):
+    with open(path, 'rb') as f:
+        if f.read(6) != b'\x93NUMPY':
+            raise ValueError(f"{path} is not an .npy file.")
+        major = f.read(2)[0]
+        header_size = 2 if major == 1 else 4
+        header_length = struct.unpack('<H' if major == 1 else '<I', f.read(header_size))[0]
+        f.read(header_length)
 
-    return msa_length, msa_depth, value
+        values = array('f')
+        values.frombytes(f.read())
 
+    if sys.byteorder != 'little':
+        values.byteswap()
+    return values
 
-# Parse per-residue (column-wise) NEFF results
-def parse_residue_neff(output):
-    msa_length, msa_depth = parse_result(output)
 
-    lines = output.strip().splitlines()
-    return (
-        msa_length, msa_depth,
-        list(map(float, lines[3].strip().split())),
-        float(lines[4].split(":")[1].strip())
-    )
+# Run neff with output_format=npy and return length and depth of the MSA with the values of the written array
+def run_exe_npy(args):
+    with tempfile.TemporaryDirectory() as temp_dir:
+        out_file = os.path.join(temp_dir, 'result.npy')
+        output = run_exe(args + ['--output_format=npy', f'--out={out_file}'], 'neff')
+        msa_length, msa_depth = parse_result(output)
+        return msa_length, msa_depth, _as_array(read_npy(out_file))
+
+
+# Parse NEFF values at each depth of the MSA written with output_format=json, as a dictionary of depth to NEFF
+def parse_depth_curve(output):
+    msa_length, msa_depth, result = parse_json_result(output)
+
+    neffs = {row['depth']: _float32(row['neff']) for row in result['depth_curve']}
+    return msa_length, msa_depth, neffs
 
 
 # Parse multimer NEFF results
@@ -173,7 +261,7 @@ def build_args(params):
     for key, value in params.items():
         if isinstance(value, Enum):
             args.append(f"--{key}={value.value}")  # use the enum's value directly
-        elif key in ['stoichiom', 'file']:
+        elif key in ['stoichiom', 'file', 'out', 'cache_dir']:
             args.append(f"--{key}={value}")  # do not make value lowercase
         else:
             args.append(f"--{key}={','.join(map(str, value)) if isinstance(value, list) else str(value).lower()}")
@@ -183,7 +271,7 @@ def build_args(params):
 
 # Main function to compute NEFF for a given MSA
 def compute_neff(
-        file: Union[str, List[str]],
+        file: Union[str, List[str]] = None,
         format: Union[str, List[str]] = None,
         alphabet: Alphabet = Alphabet.Protein,
         check_validation: bool = False,
@@ -197,7 +285,10 @@ def compute_neff(
         pos_start: int = 1,
         pos_end: int = 'inf',
         only_weights: bool = False,
-        skip_lines: int = 0
+        skip_lines: int = 0,
+        threads: int = 1,
+        sequences=None,
+        cache_dir: str = None
 ):
     try:
 
@@ -205,12 +296,28 @@ def compute_neff(
 
         _check_flags(params)
 
+        # Compute in the process with the native extension module, without parsing the output of neff
+        if _uses_extension(params):
+            msa = _load_msa(params)
+            if only_weights:
+                msa_length, msa_depth, weights = msa.weights(**_extension_params(params))
+                return msa_length, msa_depth, _as_array(weights)
+            msa_length, msa_depth, neff = msa.neff(**_extension_params(params))
+            return msa_length, msa_depth, _float32(neff)
+
+        params.pop('sequences')
+        if cache_dir is None:
+            params.pop('cache_dir')
         params['file'] = file if isinstance(file, str) else ",".join(file)
         args = build_args(params)
 
-        # Run neff executable
-        output = run_exe(args, 'neff')
-        return parse_neff(output, only_weights)
+        # Run neff executable; weights are read from an .npy file, without parsing them
+        if only_weights:
+            return run_exe_npy(args)
+
+        output = run_exe(args + ['--output_format=json'], 'neff')
+        msa_length, msa_depth, result = parse_json_result(output)
+        return msa_length, msa_depth, _float32(result['neff'])
     except Exception as e:
         raise RuntimeError(f"Error in 'compute_neff': {str(e)}")
 
@@ -218,7 +325,7 @@ def compute_neff(
 
 # Function to compute per-residue (column-wise) NEFF
 def compute_residue_neff(
-        file: Union[str, List[str]],
+        file: Union[str, List[str]] = None,
         format: Union[str, List[str]] = None,
         alphabet: Alphabet = Alphabet.Protein,
         check_validation: bool = False,
@@ -231,21 +338,66 @@ def compute_residue_neff(
         gap_cutoff: float = 1,
         pos_start: int = 1,
         pos_end: int = 'inf',
-        skip_lines: int = 0
+        skip_lines: int = 0,
+        threads: int = 1,
+        sequences=None,
+        cache_dir: str = None
 ):
     try:
         params = locals()
+
+        _check_flags(params)
+
+        # Compute in the process with the native extension module, without parsing the output of neff
+        if _uses_extension(params):
+            msa_length, msa_depth, residue_neff = _load_msa(params).residue_neff(**_extension_params(params))
+            return msa_length, msa_depth, _as_array(residue_neff), _median(memoryview(residue_neff).tolist())
+
+        params.pop('sequences')
+        if cache_dir is None:
+            params.pop('cache_dir')
         params['file'] = file if isinstance(file, str) else ",".join(file)
         params['residue_neff'] = True
+        args = build_args(params)
+
+        # Run neff executable
+        output = run_exe(args + ['--output_format=json'], 'neff')
+        msa_length, msa_depth, result = parse_json_result(output)
+        return msa_length, msa_depth, _as_array(array('f', result['residue_neff'])), \
+            _float32(result['median_residue_neff'])
+    except Exception as e:
+        raise RuntimeError(f"Error in 'compute_residue_neff': {str(e)}")
+
+
+# Function to compute NEFF at several depths of an MSA, in one pass over the pairs of sequences
+def compute_depth_curve(
+        file: Union[str, List[str]],
+        depth_curve: List[int],
+        format: Union[str, List[str]] = None,
+        alphabet: Alphabet = Alphabet.Protein,
+        check_validation: bool = False,
+        threshold: float = 0.8,
+        norm: Normalization = Normalization.Sqrt_Length,
+        omit_query_gaps: bool = True,
+        is_symmetric: bool = True,
+        non_standard_option: NonStandardOption = NonStandardOption.AsStandard,
+        pos_start: int = 1,
+        pos_end: int = 'inf',
+        skip_lines: int = 0
+):
+    try:
+        params = locals()
 
         _check_flags(params)
+
+        params['file'] = file if isinstance(file, str) else ",".join(file)
         args = build_args(params)
 
         # Run neff executable
-        output = run_exe(args, 'neff')
-        return parse_residue_neff(output)
+        output = run_exe(args + ['--output_format=json'], 'neff')
+        return parse_depth_curve(output)
     except Exception as e:
-        raise RuntimeError(f"Error in 'compute_residue_neff': {str(e)}")
+        raise RuntimeError(f"Error in 'compute_depth_curve': {str(e)}")
 
 
 # Function to compute NEFF for multimeric structures
@@ -282,6 +434,123 @@ def compute_multimer_neff(
         raise RuntimeError(f"Error in 'compute_multimer_neff': {str(e)}")
 
 
+# Client of a server started by 'neff --serve=<socket>'; requests are sent over one connection to the socket,
+# without starting a process for each MSA
+class NeffClient:
+    def __init__(self, socket_path: str, timeout: float = None):
+        self.connection = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        self.connection.settimeout(timeout)
+        self.connection.connect(socket_path)
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def close(self):
+        self.connection.close()
+
+    # Send a request (flags and an optional MSA) and return its response, as length-prefixed messages
+    def _request(self, args, msa=None):
+        request = "\n".join(args).encode()
+        if msa is not None:
+            request += b"\n\n" + (msa.encode() if isinstance(msa, str) else msa)
+        try:
+            self.connection.sendall(struct.pack('<I', len(request)) + request)
+        except (BrokenPipeError, ConnectionResetError) as e:
+            # a busy server answers and closes the connection without reading the request
+            try:
+                size = struct.unpack('<I', self._receive(4))[0]
+            except (OSError, RuntimeError):
+                raise e
+            return self._receive(size)
+
+        size = struct.unpack('<I', self._receive(4))[0]
+        return self._receive(size)
+
+    def _receive(self, size):
+        data = bytearray()
+        while len(data) < size:
+            chunk = self.connection.recv(size - len(data))
+            if not chunk:
+                raise RuntimeError("The connection to the neff server is closed.")
+            data += chunk
+        return bytes(data)
+
+    # Send a request of NEFF computation with the given parameters and return its parsed result
+    def _compute(self, params):
+        msa = params.pop('msa')
+        if (params['file'] is None) == (msa is None):
+            raise ValueError("Either 'file' or 'msa' should be given.")
+        if params['file'] is None:
+            params.pop('file')
+
+        response = self._request(build_args(params), msa)
+        if response.startswith(b'{"error"'):
+            raise RuntimeError(json.loads(response)['error'])
+        return response
+
+    # Compute NEFF, or sequence weights, of an MSA file or an MSA text (the content of an MSA file, with its format)
+    def compute_neff(
+            self,
+            file: str = None,
+            msa: Union[str, bytes] = None,
+            format: str = None,
+            alphabet: Alphabet = Alphabet.Protein,
+            check_validation: bool = False,
+            threshold: float = 0.8,
+            norm: Normalization = Normalization.Sqrt_Length,
+            omit_query_gaps: bool = True,
+            is_symmetric: bool = True,
+            non_standard_option: NonStandardOption = NonStandardOption.AsStandard,
+            depth: int = 'inf',
+            gap_cutoff: float = 1,
+            pos_start: int = 1,
+            pos_end: int = 'inf',
+            only_weights: bool = False,
+            skip_lines: int = 0
+    ):
+        params = locals()
+        params.pop('self')
+
+        result = json.loads(self._compute(params))
+        if only_weights:
+            return result['length'], result['depth'], _as_array(array('f', result['weights']))
+        return result['length'], result['depth'], _float32(result['neff'])
+
+    # Compute per-residue (column-wise) NEFF of an MSA file or an MSA text
+    def compute_residue_neff(
+            self,
+            file: str = None,
+            msa: Union[str, bytes] = None,
+            format: str = None,
+            alphabet: Alphabet = Alphabet.Protein,
+            check_validation: bool = False,
+            threshold: float = 0.8,
+            norm: Normalization = Normalization.Sqrt_Length,
+            omit_query_gaps: bool = True,
+            is_symmetric: bool = True,
+            non_standard_option: NonStandardOption = NonStandardOption.AsStandard,
+            depth: int = 'inf',
+            gap_cutoff: float = 1,
+            pos_start: int = 1,
+            pos_end: int = 'inf',
+            skip_lines: int = 0
+    ):
+        params = locals()
+        params.pop('self')
+        params['residue_neff'] = True
+
+        result = json.loads(self._compute(params))
+        return result['length'], result['depth'], _as_array(array('f', result['residue_neff'])), \
+            _float32(result['median_residue_neff'])
+
+    # Statistics of the server in the OpenMetrics text format
+    def stats(self):
+        return self._request(['--command=stats']).decode()
+
+
 # Function to convert MSA file formats
 def convert_msa(
         in_file: str,
@@ -1,7 +1,7 @@
 # Downloads C++ code from GitHub, compiles it using a Makefile,
 # and includes the resulting executable files in the `bin` directory of the package to be used by python methods.
 
-from setuptools import setup, find_packages
+from setuptools import setup, find_packages, Extension
 from setuptools.command.build_py import build_py
 import subprocess
 import os
@@ -84,6 +84,21 @@ class CustomBuildPyCommand(build_py):
 
 
 
+# Native extension module backed by libneffy; optional, so that the package can be installed without a compiler and
+# computations fall back to running the executables
+library_sources = ['flagHandler.cpp', 'common.cpp', 'msaReader.cpp', 'msaWriter.cpp', 'multimerHandler.cpp',
+                   'neffCalculator.cpp', 'libneffy.cpp', 'neffyModule.cpp']
+neffy_extension = Extension(
+    'neffy._neffy',
+    sources=[os.path.join('code', source) for source in library_sources],
+    include_dirs=['code'],
+    language='c++',
+    extra_compile_args=['/std:c++17', '/O2'] if os.name == 'nt' else ['-std=c++17', '-O3', '-pthread'],
+    extra_link_args=[] if os.name == 'nt' else ['-pthread'],
+    optional=True,
+)
+
+
 setup(
     name='neffy',
     version='0.1.1',
@@ -94,6 +109,7 @@ setup(
     long_description_content_type="text/markdown",
     url='https://github.com/Maryam-Haghani/NEFFy',
     packages=find_packages(),
+    ext_modules=[neffy_extension],
     include_package_data=True,
     classifiers=[
         "Programming Language :: Python :: 3",